@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_buffer.c
+ */
+
+#include "ham_buffer.h"
+#include "libhamdata.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define HAM_BUFFER_INITIAL_CAPACITY 4096
+
+size_t ham_buffer_append(ham_buffer *buffer, const void *data, size_t size) {
+    size_t position = buffer->size, capacity;
+    char *grown;
+
+    if(buffer->error != HAM_OK)
+        return position;
+
+    if(buffer->size + size > buffer->capacity) {
+        capacity = buffer->capacity > 0 ? buffer->capacity : HAM_BUFFER_INITIAL_CAPACITY;
+        while(capacity < buffer->size + size)
+            capacity *= 2;
+
+        grown = realloc(buffer->data, capacity);
+        if(grown == NULL) {
+            buffer->error = HAM_ERROR_MALLOC_FAIL;
+            return position;
+        }
+
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+
+    if(data != NULL)
+        memcpy(buffer->data + buffer->size, data, size);
+    else
+        memset(buffer->data + buffer->size, 0, size);
+
+    buffer->size += size;
+
+    return position;
+}
+
+void ham_buffer_reset(ham_buffer *buffer) {
+    buffer->size = 0;
+}
+
+void ham_buffer_free(ham_buffer *buffer) {
+    free(buffer->data);
+    memset(buffer, 0, sizeof(ham_buffer));
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_buffer.h
+ *
+ * A growing array of bytes, used to build the column snapshots and the sink batches in memory.
+ */
+
+#ifndef _HAM_BUFFER_H_
+#define _HAM_BUFFER_H_
+
+#include <stddef.h>
+
+/* A failed allocation is kept in error and ends all further appends */
+typedef struct ham_buffer {
+    char *data;
+    size_t size;
+    size_t capacity;
+    int error;
+} ham_buffer;
+
+/* Appends size bytes, or zeros when data is NULL. Returns where they start in the buffer. */
+size_t ham_buffer_append(ham_buffer *buffer, const void *data, size_t size);
+
+/* Empties the buffer but keeps its memory */
+void ham_buffer_reset(ham_buffer *buffer);
+
+void ham_buffer_free(ham_buffer *buffer);
+
+#endif /* _HAM_BUFFER_H_ */
@@ -0,0 +1,553 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_columns.c
+ */
+
+#include "ham_columns.h"
+#include "ham_map.h"
+#include "ham_value.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* More columns than any record type has; a header claiming more is not a snapshot */
+#define HAM_COLUMNS_MAX_COLUMNS 1024
+
+/* Codes narrowed to 16 bits at a time when a code column is written */
+#define HAM_COLUMNS_WRITE_BATCH 4096
+
+struct ham_fcc_columns {
+    ham_map map;
+
+    const ham_columns_header *header;
+    const ham_columns_entry *entries;
+};
+
+static uint64_t ham_columns_align(uint64_t offset) {
+    return (offset + HAM_COLUMNS_ALIGNMENT - 1) / HAM_COLUMNS_ALIGNMENT * HAM_COLUMNS_ALIGNMENT;
+}
+
+int ham_columns_builder_init(ham_columns_builder *builder, const char *types) {
+    const uint32_t start = 0;
+
+    memset(builder, 0, sizeof(ham_columns_builder));
+
+    builder->count = (int)strlen(types);
+    builder->columns = calloc(builder->count > 0 ? builder->count : 1, sizeof(ham_columns_column));
+    if(builder->columns == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    for(int i = 0; i < builder->count; i++) {
+        builder->columns[i].type = types[i];
+        ham_dict_init(&builder->columns[i].dict);
+
+        /* The offsets of a text column start with the start of the first string */
+        if(types[i] == HAM_VALUE_TEXT) {
+            ham_buffer_append(&builder->columns[i].values, &start, sizeof(start));
+
+            if(builder->columns[i].values.error != HAM_OK) {
+                ham_columns_builder_destroy(builder);
+                return HAM_ERROR_MALLOC_FAIL;
+            }
+        }
+    }
+
+    return HAM_OK;
+}
+
+void ham_columns_builder_destroy(ham_columns_builder *builder) {
+    for(int i = 0; i < builder->count && builder->columns != NULL; i++) {
+        ham_buffer_free(&builder->columns[i].values);
+        ham_buffer_free(&builder->columns[i].heap);
+        ham_dict_destroy(&builder->columns[i].dict);
+    }
+
+    free(builder->columns);
+    memset(builder, 0, sizeof(ham_columns_builder));
+}
+
+int ham_columns_builder_add(ham_columns_builder *builder, int column, const char *data,
+                            size_t length) {
+    ham_columns_column *target = &builder->columns[column];
+    INT64 number;
+    int32_t date;
+    uint32_t value = 0;
+
+    switch(target->type) {
+        case HAM_VALUE_INTEGER:
+            if(ham_parse_int64(data, length, &number) != HAM_OK)
+                number = HAM_COLUMN_NULL_INT64;
+
+            ham_buffer_append(&target->values, &number, sizeof(number));
+
+            return target->values.error;
+
+        case HAM_VALUE_DATE:
+            date = ham_parse_date(data, length, &number) == HAM_OK ? (int32_t)number : 0;
+
+            ham_buffer_append(&target->values, &date, sizeof(date));
+
+            return target->values.error;
+
+        case HAM_VALUE_CODE:
+            if(length > 0 && ham_dict_intern(&target->dict, data, length, &value) != HAM_OK)
+                return HAM_ERROR_MALLOC_FAIL;
+
+            ham_buffer_append(&target->values, &value, sizeof(value));
+
+            return target->values.error;
+
+        default:
+            if(target->heap.size + length > UINT32_MAX)
+                return HAM_ERROR_GENERIC;
+
+            ham_buffer_append(&target->heap, data, length);
+            if(target->heap.error != HAM_OK)
+                return target->heap.error;
+
+            value = (uint32_t)target->heap.size;
+
+            ham_buffer_append(&target->values, &value, sizeof(value));
+
+            return target->values.error;
+    }
+}
+
+void ham_columns_builder_end_row(ham_columns_builder *builder) {
+    builder->rows++;
+}
+
+/* Type a column is written as. A code column with too many values is written as text. */
+static uint32_t ham_columns_type(const ham_columns_column *column) {
+    switch(column->type) {
+        case HAM_VALUE_INTEGER:
+            return HAM_COLUMN_INT64;
+        case HAM_VALUE_DATE:
+            return HAM_COLUMN_DATE;
+        case HAM_VALUE_CODE:
+            return column->dict.count <= HAM_COLUMNS_MAX_CODE ? HAM_COLUMN_CODE :
+                                                                HAM_COLUMN_STRING;
+    }
+
+    return HAM_COLUMN_STRING;
+}
+
+/* The value of a code, empty for 0 */
+static const char *ham_columns_code_value(const ham_dict *dict, uint32_t code, size_t *length) {
+    if(code == 0) {
+        *length = 0;
+        return "";
+    }
+
+    return ham_dict_value(dict, code, length);
+}
+
+/* Lays out the sections of a column from offset on, and gives the offset after them */
+static uint64_t ham_columns_layout(const ham_columns_column *column, uint64_t rows,
+                                    uint64_t offset, ham_columns_entry *entry) {
+    const uint32_t *codes = (const uint32_t *)column->values.data;
+    size_t length;
+
+    memset(entry, 0, sizeof(ham_columns_entry));
+    memcpy(entry->name, column->name, sizeof(entry->name) - 1);
+    entry->type = ham_columns_type(column);
+    entry->values_offset = offset;
+
+    switch(entry->type) {
+        case HAM_COLUMN_INT64:
+            entry->values_size = rows * sizeof(INT64);
+            break;
+
+        case HAM_COLUMN_DATE:
+            entry->values_size = rows * sizeof(int32_t);
+            break;
+
+        case HAM_COLUMN_CODE:
+            entry->values_size = rows * sizeof(uint16_t);
+            entry->heap_size = column->dict.count > 0 ? column->dict.offsets[column->dict.count] :
+                                                        0;
+            entry->dictionary_count = column->dict.count;
+            break;
+
+        default:
+            entry->values_size = (rows + 1) * sizeof(uint32_t);
+
+            if(column->type != HAM_VALUE_CODE) {
+                entry->heap_size = column->heap.size;
+                break;
+            }
+
+            for(uint64_t row = 0; row < rows; row++) {
+                ham_columns_code_value(&column->dict, codes[row], &length);
+                entry->heap_size += length;
+            }
+    }
+
+    offset = ham_columns_align(offset + entry->values_size);
+
+    if(entry->type == HAM_COLUMN_STRING || entry->type == HAM_COLUMN_CODE) {
+        entry->heap_offset = offset;
+        offset = ham_columns_align(offset + entry->heap_size);
+    }
+
+    if(entry->type == HAM_COLUMN_CODE) {
+        entry->dictionary_offset = offset;
+        offset = ham_columns_align(offset + (entry->dictionary_count + 1) * sizeof(uint32_t));
+    }
+
+    return offset;
+}
+
+/* Zeros up to offset, where the next section starts */
+static int ham_columns_pad(FILE *file, uint64_t *position, uint64_t offset) {
+    static const char zeros[HAM_COLUMNS_ALIGNMENT];
+    size_t padding = (size_t)(offset - *position);
+
+    *position = offset;
+
+    return fwrite(zeros, 1, padding, file) == padding ? HAM_OK : HAM_ERROR_GENERIC;
+}
+
+static int ham_columns_put(FILE *file, uint64_t *position, const void *data, size_t size) {
+    *position += size;
+
+    return size == 0 || fwrite(data, 1, size, file) == size ? HAM_OK : HAM_ERROR_GENERIC;
+}
+
+/* Codes narrowed to 16 bits, and the dictionary offsets to 32 */
+static int ham_columns_write_codes(FILE *file, uint64_t *position,
+                                    const ham_columns_column *column, uint64_t rows,
+                                    const ham_columns_entry *entry) {
+    const uint32_t *codes = (const uint32_t *)column->values.data;
+    uint16_t narrow[HAM_COLUMNS_WRITE_BATCH];
+    uint32_t offset;
+    size_t batch;
+    int error = HAM_OK;
+
+    for(uint64_t row = 0; row < rows && error == HAM_OK; row += batch) {
+        batch = rows - row < HAM_COLUMNS_WRITE_BATCH ? (size_t)(rows - row) :
+                                                        HAM_COLUMNS_WRITE_BATCH;
+
+        for(size_t i = 0; i < batch; i++)
+            narrow[i] = (uint16_t)codes[row + i];
+
+        error = ham_columns_put(file, position, narrow, batch * sizeof(uint16_t));
+    }
+
+    if(error == HAM_OK)
+        error = ham_columns_pad(file, position, entry->heap_offset);
+
+    if(error == HAM_OK)
+        error = ham_columns_put(file, position, column->dict.strings, (size_t)entry->heap_size);
+
+    if(error == HAM_OK)
+        error = ham_columns_pad(file, position, entry->dictionary_offset);
+
+    for(uint32_t code = 0; code <= column->dict.count && error == HAM_OK; code++) {
+        offset = code > 0 ? (uint32_t)column->dict.offsets[code] : 0;
+        error = ham_columns_put(file, position, &offset, sizeof(offset));
+    }
+
+    return error;
+}
+
+/* A code column with more values than the codes can hold, written out as text */
+static int ham_columns_write_expanded(FILE *file, uint64_t *position,
+                                        const ham_columns_column *column, uint64_t rows,
+                                        const ham_columns_entry *entry) {
+    const uint32_t *codes = (const uint32_t *)column->values.data;
+    const char *value;
+    uint32_t offset = 0;
+    size_t length;
+    int error;
+
+    error = ham_columns_put(file, position, &offset, sizeof(offset));
+
+    for(uint64_t row = 0; row < rows && error == HAM_OK; row++) {
+        ham_columns_code_value(&column->dict, codes[row], &length);
+        offset += (uint32_t)length;
+        error = ham_columns_put(file, position, &offset, sizeof(offset));
+    }
+
+    if(error == HAM_OK)
+        error = ham_columns_pad(file, position, entry->heap_offset);
+
+    for(uint64_t row = 0; row < rows && error == HAM_OK; row++) {
+        value = ham_columns_code_value(&column->dict, codes[row], &length);
+        error = ham_columns_put(file, position, value, length);
+    }
+
+    return error;
+}
+
+int ham_columns_write(const ham_columns_builder *builder, const char *path) {
+    ham_columns_header header;
+    ham_columns_entry *entries;
+    const ham_columns_column *column;
+    uint64_t offset, position = 0;
+    FILE *file;
+    int error = HAM_OK;
+
+    entries = calloc(builder->count > 0 ? builder->count : 1, sizeof(ham_columns_entry));
+    if(entries == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HAM_COLUMNS_MAGIC, sizeof(HAM_COLUMNS_MAGIC));
+    header.version = HAM_COLUMNS_VERSION;
+    header.byte_order = HAM_COLUMNS_BYTE_ORDER;
+    header.rows = builder->rows;
+    header.columns = (uint32_t)builder->count;
+
+    offset = ham_columns_align(sizeof(header) + builder->count * sizeof(ham_columns_entry));
+
+    for(int i = 0; i < builder->count; i++) {
+        offset = ham_columns_layout(&builder->columns[i], builder->rows, offset, &entries[i]);
+
+        if(entries[i].heap_size > UINT32_MAX)
+            error = HAM_ERROR_GENERIC;
+    }
+
+    file = error == HAM_OK ? fopen(path, "wb") : NULL;
+    if(error == HAM_OK && file == NULL)
+        error = HAM_ERROR_OPEN_FILE;
+
+    if(error == HAM_OK)
+        error = ham_columns_put(file, &position, &header, sizeof(header));
+
+    if(error == HAM_OK)
+        error = ham_columns_put(file, &position, entries,
+                                builder->count * sizeof(ham_columns_entry));
+
+    for(int i = 0; i < builder->count && error == HAM_OK; i++) {
+        column = &builder->columns[i];
+
+        error = ham_columns_pad(file, &position, entries[i].values_offset);
+        if(error != HAM_OK)
+            break;
+
+        if(entries[i].type == HAM_COLUMN_CODE) {
+            error = ham_columns_write_codes(file, &position, column, builder->rows, &entries[i]);
+        } else if(column->type == HAM_VALUE_CODE) {
+            error = ham_columns_write_expanded(file, &position, column, builder->rows,
+                                                &entries[i]);
+        } else {
+            error = ham_columns_put(file, &position, column->values.data, column->values.size);
+
+            if(error == HAM_OK && entries[i].type == HAM_COLUMN_STRING)
+                error = ham_columns_pad(file, &position, entries[i].heap_offset);
+
+            if(error == HAM_OK && entries[i].type == HAM_COLUMN_STRING)
+                error = ham_columns_put(file, &position, column->heap.data, column->heap.size);
+        }
+    }
+
+    /* The file ends on the alignment too, so the last section's padding is there */
+    if(error == HAM_OK)
+        error = ham_columns_pad(file, &position, offset);
+
+    if(file != NULL && fclose(file) && error == HAM_OK)
+        error = HAM_ERROR_GENERIC;
+
+    free(entries);
+
+    return error;
+}
+
+/* Whether a section lies inside the file and starts on the alignment */
+static int ham_columns_fits(const ham_fcc_columns *columns, uint64_t offset, uint64_t size) {
+    return offset % HAM_COLUMNS_ALIGNMENT == 0 && offset <= columns->map.size
+            && size <= columns->map.size - offset;
+}
+
+/* Checks the directory against the file, so the reader can trust the sections it points to */
+static int ham_columns_check(const ham_fcc_columns *columns) {
+    const ham_columns_header *header = (const ham_columns_header *)columns->map.data;
+    const ham_columns_entry *entry;
+    const uint32_t *offsets;
+    uint64_t rows;
+
+    if(columns->map.size < sizeof(ham_columns_header)
+            || memcmp(header->magic, HAM_COLUMNS_MAGIC, sizeof(HAM_COLUMNS_MAGIC))
+            || header->version != HAM_COLUMNS_VERSION
+            || header->byte_order != HAM_COLUMNS_BYTE_ORDER
+            || header->columns > HAM_COLUMNS_MAX_COLUMNS
+            || columns->map.size < sizeof(ham_columns_header)
+                                + header->columns * sizeof(ham_columns_entry)
+            || header->rows > columns->map.size)
+        return HAM_ERROR_BAD_COLUMNS;
+
+    rows = header->rows;
+
+    for(uint32_t i = 0; i < header->columns; i++) {
+        entry = (const ham_columns_entry *)(columns->map.data + sizeof(ham_columns_header)) + i;
+
+        if(entry->name[HAM_COLUMNS_NAME_SIZE - 1] != '\0'
+                || !ham_columns_fits(columns, entry->values_offset, entry->values_size))
+            return HAM_ERROR_BAD_COLUMNS;
+
+        switch(entry->type) {
+            case HAM_COLUMN_INT64:
+                if(entry->values_size != rows * sizeof(INT64))
+                    return HAM_ERROR_BAD_COLUMNS;
+                break;
+
+            case HAM_COLUMN_DATE:
+                if(entry->values_size != rows * sizeof(int32_t))
+                    return HAM_ERROR_BAD_COLUMNS;
+                break;
+
+            case HAM_COLUMN_STRING:
+                offsets = (const uint32_t *)(columns->map.data + entry->values_offset);
+
+                if(entry->values_size != (rows + 1) * sizeof(uint32_t)
+                        || !ham_columns_fits(columns, entry->heap_offset, entry->heap_size)
+                        || offsets[rows] > entry->heap_size)
+                    return HAM_ERROR_BAD_COLUMNS;
+                break;
+
+            case HAM_COLUMN_CODE:
+                offsets = (const uint32_t *)(columns->map.data + entry->dictionary_offset);
+
+                if(entry->values_size != rows * sizeof(uint16_t)
+                        || entry->dictionary_count > HAM_COLUMNS_MAX_CODE
+                        || !ham_columns_fits(columns, entry->heap_offset, entry->heap_size)
+                        || !ham_columns_fits(columns, entry->dictionary_offset,
+                                                (entry->dictionary_count + 1) * sizeof(uint32_t))
+                        || offsets[entry->dictionary_count] > entry->heap_size)
+                    return HAM_ERROR_BAD_COLUMNS;
+                break;
+
+            default:
+                return HAM_ERROR_BAD_COLUMNS;
+        }
+    }
+
+    return HAM_OK;
+}
+
+LIBHAMDATA_API int ham_fcc_columns_open(ham_fcc_columns **columns, const char *path) {
+    int error;
+
+    *columns = calloc(1, sizeof(ham_fcc_columns));
+    if(*columns == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    /* An empty or unreadable file is not a valid one */
+    error = ham_map_open(&(*columns)->map, path);
+    if(error == HAM_ERROR_GENERIC)
+        error = HAM_ERROR_BAD_COLUMNS;
+
+    if(error != HAM_OK) {
+        free(*columns);
+        *columns = NULL;
+        return error;
+    }
+
+    error = ham_columns_check(*columns);
+    if(error != HAM_OK) {
+        ham_fcc_columns_close(*columns);
+        *columns = NULL;
+        return error;
+    }
+
+    (*columns)->header = (const ham_columns_header *)(*columns)->map.data;
+    (*columns)->entries = (const ham_columns_entry *)((*columns)->map.data +
+                                                        sizeof(ham_columns_header));
+
+    return HAM_OK;
+}
+
+LIBHAMDATA_API uint64_t ham_fcc_columns_rows(const ham_fcc_columns *columns) {
+    return columns->header->rows;
+}
+
+LIBHAMDATA_API int ham_fcc_columns_count(const ham_fcc_columns *columns) {
+    return (int)columns->header->columns;
+}
+
+LIBHAMDATA_API int ham_fcc_columns_get(const ham_fcc_columns *columns, int index,
+                                        ham_fcc_column *column) {
+    const ham_columns_entry *entry;
+
+    if(index < 0 || (uint32_t)index >= columns->header->columns)
+        return HAM_ERROR_NOT_FOUND;
+
+    entry = &columns->entries[index];
+
+    memset(column, 0, sizeof(ham_fcc_column));
+    column->name = entry->name;
+    column->type = (int)entry->type;
+    column->rows = columns->header->rows;
+    column->values = columns->map.data + entry->values_offset;
+
+    if(entry->type == HAM_COLUMN_STRING || entry->type == HAM_COLUMN_CODE) {
+        column->heap = columns->map.data + entry->heap_offset;
+        column->heap_size = entry->heap_size;
+    }
+
+    if(entry->type == HAM_COLUMN_CODE) {
+        column->dictionary = (const uint32_t *)(columns->map.data + entry->dictionary_offset);
+        column->dictionary_count = entry->dictionary_count;
+    }
+
+    return HAM_OK;
+}
+
+LIBHAMDATA_API int ham_fcc_columns_find(const ham_fcc_columns *columns, const char *name,
+                                        ham_fcc_column *column) {
+    for(uint32_t i = 0; i < columns->header->columns; i++) {
+        if(!strcmp(columns->entries[i].name, name))
+            return ham_fcc_columns_get(columns, (int)i, column);
+    }
+
+    return HAM_ERROR_NOT_FOUND;
+}
+
+LIBHAMDATA_API const char *ham_fcc_column_string(const ham_fcc_column *column, uint64_t row,
+                                                    size_t *length) {
+    const uint32_t *offsets = column->values;
+
+    if(column->type != HAM_COLUMN_STRING || row >= column->rows
+            || offsets[row] > offsets[row + 1] || offsets[row + 1] > column->heap_size)
+        return NULL;
+
+    *length = offsets[row + 1] - offsets[row];
+
+    return column->heap + offsets[row];
+}
+
+LIBHAMDATA_API const char *ham_fcc_column_code(const ham_fcc_column *column, uint32_t code,
+                                                size_t *length) {
+    const uint32_t *offsets = column->dictionary;
+
+    if(column->type != HAM_COLUMN_CODE || code > column->dictionary_count)
+        return NULL;
+
+    if(code == 0) {
+        *length = 0;
+        return "";
+    }
+
+    if(offsets[code - 1] > offsets[code] || offsets[code] > column->heap_size)
+        return NULL;
+
+    *length = offsets[code] - offsets[code - 1];
+
+    return column->heap + offsets[code - 1];
+}
+
+LIBHAMDATA_API void ham_fcc_columns_close(ham_fcc_columns *columns) {
+    if(columns == NULL)
+        return;
+
+    ham_map_close(&columns->map);
+
+    free(columns);
+}
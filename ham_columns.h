@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_columns.h
+ *
+ * Columnar snapshot of one record type. Every field of the file is a column stored on its own, so
+ * a scan of a few columns reads only those. Numbers and dates are fixed width arrays, text is an
+ * array of offsets into a heap of the strings, and code columns are an array of 16 bit codes with
+ * a dictionary of their values. The file is used in place, memory mapped where the platform allows.
+ *
+ * The builder keeps the columns of the whole file in memory, one growing array each, and writes
+ * them out one after the other at the end.
+ */
+
+#ifndef _HAM_COLUMNS_H_
+#define _HAM_COLUMNS_H_
+
+#include "libhamdata.h"
+#include "ham_buffer.h"
+#include "ham_dict.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Snapshot files are named after their table, e.g. amateurs.hamcol */
+#define HAM_COLUMNS_EXTENSION ".hamcol"
+
+#define HAM_COLUMNS_MAGIC "HAMCOLS"
+#define HAM_COLUMNS_VERSION 1
+
+/* Written as 0x01020304 so a file from a machine of the other byte order is refused */
+#define HAM_COLUMNS_BYTE_ORDER 0x01020304u
+
+/* Every section of the file starts on a multiple of this */
+#define HAM_COLUMNS_ALIGNMENT 64
+
+#define HAM_COLUMNS_NAME_SIZE 32
+
+/* Codes that do not fit in a code column's 16 bits make it a string column instead */
+#define HAM_COLUMNS_MAX_CODE 0xffffu
+
+/* Start of the file. The column directory follows it, then the sections of each column. */
+typedef struct ham_columns_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t rows;
+    uint32_t columns;
+    uint32_t reserved;
+} ham_columns_header;
+
+/* Where a column's sections are. Offsets are from the start of the file. */
+typedef struct ham_columns_entry {
+    char name[HAM_COLUMNS_NAME_SIZE];
+    uint32_t type;
+    uint32_t dictionary_count;
+    uint64_t values_offset;
+    uint64_t values_size;
+    uint64_t heap_offset;
+    uint64_t heap_size;
+    uint64_t dictionary_offset;
+} ham_columns_entry;
+
+typedef struct ham_columns_column {
+    char name[HAM_COLUMNS_NAME_SIZE];
+
+    /* HAM_VALUE_* letter of the field */
+    char type;
+
+    /* Fixed width values, string offsets or codes; the heap of a text column's strings */
+    ham_buffer values;
+    ham_buffer heap;
+
+    /* Values of a code column. The codes are kept 32 bits wide until the file is written. */
+    ham_dict dict;
+} ham_columns_column;
+
+typedef struct ham_columns_builder {
+    ham_columns_column *columns;
+    int count;
+    uint64_t rows;
+} ham_columns_builder;
+
+/* One column per letter of types, the column type map of the file. Names are filled in after. */
+int ham_columns_builder_init(ham_columns_builder *builder, const char *types);
+void ham_columns_builder_destroy(ham_columns_builder *builder);
+
+/*
+ * Adds the value of a column to the current row. Every column gets one value per row, in order;
+ * ham_columns_builder_end_row then starts the next row.
+ */
+int ham_columns_builder_add(ham_columns_builder *builder, int column, const char *data,
+                            size_t length);
+void ham_columns_builder_end_row(ham_columns_builder *builder);
+
+/* Writes the file, replacing it if it exists */
+int ham_columns_write(const ham_columns_builder *builder, const char *path);
+
+#endif /* _HAM_COLUMNS_H_ */
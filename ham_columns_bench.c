@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_columns_bench.c
+ *
+ * Microbenchmark of scans over a columnar snapshot: licenses by operator class, entities by state
+ * and licenses by the month they expire. Run it on the directory the snapshot was written to, e.g.
+ * ham_columns_bench snapshot
+ */
+
+#include "libhamdata.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_ROUNDS 20
+
+/* Months from 1900 to 2099 */
+#define BENCH_FIRST_YEAR 1900
+#define BENCH_MONTHS (200 * 12)
+
+static double seconds(void) {
+    struct timespec now;
+
+    timespec_get(&now, TIME_UTC);
+
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static ham_fcc_columns *open_table(const char *directory, const char *table) {
+    ham_fcc_columns *columns;
+    char path[512];
+    double start = seconds();
+    int error;
+
+    snprintf(path, sizeof(path), "%s/%s.hamcol", directory, table);
+
+    error = ham_fcc_columns_open(&columns, path);
+    if(error != HAM_OK) {
+        printf("Error (%d): failed to open %s\n", error, path);
+        return NULL;
+    }
+
+    printf("%s: opened in %.1f us, %llu rows\n", path, (seconds() - start) * 1e6,
+            (unsigned long long)ham_fcc_columns_rows(columns));
+
+    return columns;
+}
+
+/* Rows per code of a code column, printed with the values of the codes */
+static void bench_codes(const ham_fcc_columns *columns, const char *name) {
+    ham_fcc_column column;
+    unsigned long *counts;
+    const uint16_t *codes;
+    const char *value;
+    size_t length;
+    double start, elapsed;
+
+    if(ham_fcc_columns_find(columns, name, &column) != HAM_OK
+            || column.type != HAM_COLUMN_CODE) {
+        printf("No code column %s\n", name);
+        return;
+    }
+
+    counts = calloc(column.dictionary_count + 1, sizeof(unsigned long));
+    if(counts == NULL)
+        return;
+
+    codes = column.values;
+    start = seconds();
+
+    for(int round = 0; round < BENCH_ROUNDS; round++) {
+        memset(counts, 0, (column.dictionary_count + 1) * sizeof(unsigned long));
+
+        for(uint64_t row = 0; row < column.rows; row++)
+            counts[codes[row]]++;
+    }
+
+    elapsed = (seconds() - start) / BENCH_ROUNDS;
+    printf("count by %s: %.3f ms\n", name, elapsed * 1e3);
+
+    for(uint32_t code = 0; code <= column.dictionary_count && code < 8; code++) {
+        value = ham_fcc_column_code(&column, code, &length);
+        printf("  %-6.*s %lu\n", (int)length, value, counts[code]);
+    }
+
+    free(counts);
+}
+
+/* Licenses per month of expiry */
+static void bench_months(const ham_fcc_columns *columns) {
+    static unsigned long counts[BENCH_MONTHS];
+    ham_fcc_column column;
+    const int32_t *dates;
+    int month, busiest = 0;
+    double start, elapsed;
+
+    if(ham_fcc_columns_find(columns, "expired_date", &column) != HAM_OK
+            || column.type != HAM_COLUMN_DATE) {
+        printf("No date column expired_date\n");
+        return;
+    }
+
+    dates = column.values;
+    start = seconds();
+
+    for(int round = 0; round < BENCH_ROUNDS; round++) {
+        memset(counts, 0, sizeof(counts));
+
+        for(uint64_t row = 0; row < column.rows; row++) {
+            month = (dates[row] / 10000 - BENCH_FIRST_YEAR) * 12 + dates[row] / 100 % 100 - 1;
+            if(dates[row] != 0 && month >= 0 && month < BENCH_MONTHS)
+                counts[month]++;
+        }
+    }
+
+    elapsed = (seconds() - start) / BENCH_ROUNDS;
+
+    for(int i = 1; i < BENCH_MONTHS; i++) {
+        if(counts[i] > counts[busiest])
+            busiest = i;
+    }
+
+    printf("count by month of expired_date: %.3f ms (busiest %04d-%02d, %lu)\n", elapsed * 1e3,
+            BENCH_FIRST_YEAR + busiest / 12, busiest % 12 + 1, counts[busiest]);
+}
+
+int main(int argc, char **argv) {
+    ham_fcc_columns *amateurs, *entities, *headers;
+
+    if(argc < 2) {
+        printf("Usage: %s <snapshot directory>\n", argv[0]);
+        return 1;
+    }
+
+    amateurs = open_table(argv[1], "amateurs");
+    entities = open_table(argv[1], "entities");
+    headers = open_table(argv[1], "headers");
+
+    if(amateurs != NULL)
+        bench_codes(amateurs, "operator_class");
+
+    if(entities != NULL)
+        bench_codes(entities, "state");
+
+    if(headers != NULL)
+        bench_months(headers);
+
+    ham_fcc_columns_close(amateurs);
+    ham_fcc_columns_close(entities);
+    ham_fcc_columns_close(headers);
+
+    return 0;
+}
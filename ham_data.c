@@ -12,32 +12,207 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "libhamdata.h"
 
+#if defined(OS_WIN)
+    #include <fcntl.h>
+    #include <io.h>
+#endif
+
+static void usage(void) {
+    printf("Usage: ham_data [options] [output file] [directory of FCC files, FCC zip or -]\n\n"
+           "With - the FCC files are read from standard input, as a tar archive or one after\n"
+           "the other.\n\n"
+           "Options:\n"
+           "  --threads <n>        number of threads to use (default: one per processor)\n"
+           "  --parallel-tables    convert each record type into its own database at the same\n"
+           "                       time and merge them at the end\n"
+           "  --update             apply a daily transaction file to an existing output file,\n"
+           "                       replacing every license it holds\n"
+           "  --no-indexes         do not build the lookup indexes after loading\n"
+           "  --encode             store code columns as integers with lookup tables and\n"
+           "                       decoding views\n"
+           "  --compact            no AUTOINCREMENT ids or per row timestamps; the import time\n"
+           "                       is kept once in the ham_metadata table\n"
+           "  --clustered          WITHOUT ROWID tables keyed by unique_system_identifier, so\n"
+           "                       the rows of a license are stored together\n"
+           "  --licenses           build a licenses table with one row per license, joined out\n"
+           "                       of the AM, EN and HD files\n"
+           "  --callsign-index <file>\n"
+           "                       write a callsign index file for ham_fcc_index_open\n"
+           "  --callsign-parts     split the callsigns into prefix, call area and suffix for\n"
+           "                       prefix and pattern searches\n"
+           "  --name-search        build a full text index over the names and addresses of\n"
+           "                       the entities\n"
+           "  --in-memory          build the database in memory and write it out in one pass\n"
+           "                       at the end\n"
+           "\nTuning (defaults in parentheses):\n"
+           "  --page-size <bytes>  page size of a new database (4096)\n"
+           "  --cache-size <KiB>   page cache while loading (65536)\n"
+           "  --index-cache-size <KiB>\n"
+           "                       page cache while building the indexes (262144)\n"
+           "  --mmap-size <MiB>    database file SQLite may memory map (0)\n"
+           "  --temp-store <default|file|memory>\n"
+           "                       where temporary tables and sorts are kept (default)\n"
+           "  --journal-mode <mode>\n"
+           "                       delete, truncate, persist, memory, wal or off (memory)\n"
+           "  --synchronous <level>\n"
+           "                       off, normal, full or extra (off)\n"
+           "  --chunk-size <KiB>   bytes handed to a parser thread at a time (256)\n"
+           "  --commit-rows <n>    commit the load every n records (0, one transaction)\n"
+           "  --commit-size <MiB>  commit the load every MiB of records (0, one transaction)\n"
+           "  --resume             continue a load with --commit-rows or --commit-size that\n"
+           "                       died, from the last commit of each file\n"
+           "  --memory-budget <MiB>\n"
+           "                       memory the conversion may use, at least 16 (0, no limit)\n"
+           "  --columns            write a columnar snapshot of each record type into the\n"
+           "                       output directory instead of a SQLite file\n"
+           "  --arrow              write an Arrow IPC stream of each record type into the\n"
+           "                       output directory instead of a SQLite file\n"
+           "  --pgcopy             write a PostgreSQL binary COPY file of each record type and\n"
+           "                       a load.sql for psql into the output directory instead of a\n"
+           "                       SQLite file\n");
+}
+
 int main (int argc, char **argv) {
     ham_fcc_database *fccdb;
+    ham_fcc_convert_options options;
+    ham_fcc_sink sink;
 
     char *filename = NULL;
     char *directory = NULL;
+    size_t length;
+    int positional = 0;
+    int columns = HAM_BOOL_NO;
+    int arrow = HAM_BOOL_NO;
+    int pgcopy = HAM_BOOL_NO;
+    int error;
 
-    if(argc > 1) {
-        filename = argv[1];
+    ham_fcc_convert_options_init(&options);
+
+    for(int i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        } else if(!strcmp(argv[i], "--parallel-tables")) {
+            options.parallel_tables = HAM_BOOL_YES;
+        } else if(!strcmp(argv[i], "--update")) {
+            options.update = HAM_BOOL_YES;
+        } else if(!strcmp(argv[i], "--no-indexes")) {
+            options.indexes = HAM_BOOL_NO;
+        } else if(!strcmp(argv[i], "--encode")) {
+            options.encode = HAM_BOOL_YES;
+        } else if(!strcmp(argv[i], "--compact")) {
+            options.compact = HAM_BOOL_YES;
+        } else if(!strcmp(argv[i], "--clustered")) {
+            options.clustered = HAM_BOOL_YES;
+        } else if(!strcmp(argv[i], "--licenses")) {
+            options.licenses = HAM_BOOL_YES;
+        } else if(!strcmp(argv[i], "--callsign-index") && i + 1 < argc) {
+            options.callsign_index = argv[++i];
+        } else if(!strcmp(argv[i], "--callsign-parts")) {
+            options.callsign_parts = HAM_BOOL_YES;
+        } else if(!strcmp(argv[i], "--name-search")) {
+            options.name_search = HAM_BOOL_YES;
+        } else if(!strcmp(argv[i], "--in-memory")) {
+            options.in_memory = HAM_BOOL_YES;
+        } else if(!strcmp(argv[i], "--page-size") && i + 1 < argc) {
+            options.page_size = atoi(argv[++i]);
+        } else if(!strcmp(argv[i], "--cache-size") && i + 1 < argc) {
+            options.cache_size = atoi(argv[++i]);
+        } else if(!strcmp(argv[i], "--index-cache-size") && i + 1 < argc) {
+            options.index_cache_size = atoi(argv[++i]);
+        } else if(!strcmp(argv[i], "--mmap-size") && i + 1 < argc) {
+            options.mmap_size = (INT64)atoi(argv[++i]) * 1024 * 1024;
+        } else if(!strcmp(argv[i], "--temp-store") && i + 1 < argc) {
+            i++;
+            if(!strcmp(argv[i], "file"))
+                options.temp_store = HAM_TEMP_STORE_FILE;
+            else if(!strcmp(argv[i], "memory"))
+                options.temp_store = HAM_TEMP_STORE_MEMORY;
+            else
+                options.temp_store = HAM_TEMP_STORE_DEFAULT;
+        } else if(!strcmp(argv[i], "--journal-mode") && i + 1 < argc) {
+            options.journal_mode = argv[++i];
+        } else if(!strcmp(argv[i], "--synchronous") && i + 1 < argc) {
+            options.synchronous = argv[++i];
+        } else if(!strcmp(argv[i], "--chunk-size") && i + 1 < argc) {
+            options.chunk_size = (size_t)atoi(argv[++i]) * 1024;
+        } else if(!strcmp(argv[i], "--commit-rows") && i + 1 < argc) {
+            options.commit_rows = (INT64)atoll(argv[++i]);
+        } else if(!strcmp(argv[i], "--commit-size") && i + 1 < argc) {
+            options.commit_bytes = (INT64)atoi(argv[++i]) * 1024 * 1024;
+        } else if(!strcmp(argv[i], "--resume")) {
+            options.resume = HAM_BOOL_YES;
+        } else if(!strcmp(argv[i], "--memory-budget") && i + 1 < argc) {
+            options.memory_budget = (INT64)atoi(argv[++i]) * 1024 * 1024;
+        } else if(!strcmp(argv[i], "--columns")) {
+            columns = HAM_BOOL_YES;
+        } else if(!strcmp(argv[i], "--arrow")) {
+            arrow = HAM_BOOL_YES;
+        } else if(!strcmp(argv[i], "--pgcopy")) {
+            pgcopy = HAM_BOOL_YES;
+        } else if(!strcmp(argv[i], "--help") || !strncmp(argv[i], "--", 2)) {
+            usage();
+            return 1;
+        } else if(positional == 0) {
+            filename = argv[i];
+            positional++;
+        } else if(positional == 1) {
+            directory = argv[i];
+            positional++;
+        }
     }
 
-    if(argc > 2) {
-        directory = argv[2];
+    /* Everything in one stream, e.g. curl ... | funzip | ham_data out.sqlite3 - */
+    if(directory != NULL && !strcmp(directory, "-")) {
+        if(columns == HAM_BOOL_YES || arrow == HAM_BOOL_YES || pgcopy == HAM_BOOL_YES) {
+            printf("Error: --columns, --arrow and --pgcopy read files, not a stream\n");
+            return 1;
+        }
+
+#if defined(OS_WIN)
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        error = ham_fcc_stream_to_sqlite(ham_fcc_read_file, stdin, filename, &options);
+        if(error)
+            printf("Conversion failed: %d\n", error);
+
+        return 0;
     }
 
-    if(ham_fcc_database_init(&fccdb, directory)) {
+    /* A zip archive is read in place instead of from a directory of extracted files */
+    length = directory != NULL ? strlen(directory) : 0;
+    if(length > 4 && !strcmp(directory + length - 4, ".zip"))
+        error = ham_fcc_database_init_zip(&fccdb, directory);
+    else
+        error = ham_fcc_database_init(&fccdb, directory);
+
+    if(error) {
         printf("Error: failed to open files...\n\n"
                "Options paramaters:\n"
                "1: name of output file.\n"
-               "2: directory of FCC files.\n");
+               "2: directory of FCC files, or the FCC zip archive.\n");
 
         return 1;
     }
-    int error = ham_fcc_to_sqlite(fccdb, filename);
+    if(columns == HAM_BOOL_YES) {
+        error = ham_fcc_to_columns(fccdb, filename);
+    } else if(arrow == HAM_BOOL_YES || pgcopy == HAM_BOOL_YES) {
+        if(arrow == HAM_BOOL_YES)
+            error = ham_fcc_arrow_sink_open(&sink, filename);
+        else
+            error = ham_fcc_pgcopy_sink_open(&sink, filename);
+
+        if(error == HAM_OK)
+            error = ham_fcc_to_sink(fccdb, &sink, &options);
+
+        ham_fcc_sink_close(&sink);
+    } else {
+        error = ham_fcc_to_sqlite_ex(fccdb, filename, &options);
+    }
 
     if(error)
         printf("Conversion failed: %d\n", error);
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_dict.c
+ */
+
+#include "ham_dict.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define HAM_DICT_INITIAL_SLOTS 64
+#define HAM_DICT_INITIAL_STRINGS 1024
+
+/* FNV-1a. The values are a few bytes long, so anything fancier would not pay off. */
+static uint32_t ham_dict_hash(const char *data, size_t length) {
+    uint32_t hash = 2166136261u;
+
+    for(size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/* Slot holding the value, or the empty slot it would go in */
+static size_t ham_dict_find(const ham_dict *dict, const char *data, size_t length) {
+    size_t slot = ham_dict_hash(data, length) & dict->mask;
+    const char *value;
+    size_t value_length;
+
+    while(dict->slots[slot] != 0) {
+        value = ham_dict_value(dict, dict->slots[slot], &value_length);
+        if(value_length == length && memcmp(value, data, length) == 0)
+            break;
+
+        slot = (slot + 1) & dict->mask;
+    }
+
+    return slot;
+}
+
+/* Doubles the slots and the code table, keeping the table at most half full */
+static int ham_dict_grow(ham_dict *dict) {
+    uint32_t capacity = dict->capacity ? dict->capacity * 2 : HAM_DICT_INITIAL_SLOTS / 2;
+    size_t *offsets;
+    const char *value;
+    size_t length;
+
+    offsets = realloc(dict->offsets, sizeof(size_t) * (capacity + 1));
+    if(offsets == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    dict->offsets = offsets;
+    dict->offsets[0] = 0;
+
+    free(dict->slots);
+    dict->slots = calloc((size_t)capacity * 2, sizeof(uint32_t));
+    if(dict->slots == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    dict->mask = (size_t)capacity * 2 - 1;
+    dict->capacity = capacity;
+
+    for(uint32_t code = 1; code <= dict->count; code++) {
+        value = ham_dict_value(dict, code, &length);
+        dict->slots[ham_dict_find(dict, value, length)] = code;
+    }
+
+    return HAM_OK;
+}
+
+void ham_dict_init(ham_dict *dict) {
+    memset(dict, 0, sizeof(ham_dict));
+}
+
+void ham_dict_destroy(ham_dict *dict) {
+    free(dict->slots);
+    free(dict->offsets);
+    free(dict->strings);
+
+    ham_dict_init(dict);
+}
+
+int ham_dict_intern(ham_dict *dict, const char *data, size_t length, uint32_t *code) {
+    size_t slot, capacity;
+    char *strings;
+
+    if(dict->count == dict->capacity && ham_dict_grow(dict) != HAM_OK)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    slot = ham_dict_find(dict, data, length);
+    if(dict->slots[slot] != 0) {
+        *code = dict->slots[slot];
+        return HAM_OK;
+    }
+
+    if(dict->strings_size + length > dict->strings_capacity) {
+        capacity = dict->strings_capacity ? dict->strings_capacity : HAM_DICT_INITIAL_STRINGS;
+        while(dict->strings_size + length > capacity)
+            capacity *= 2;
+
+        strings = realloc(dict->strings, capacity);
+        if(strings == NULL)
+            return HAM_ERROR_MALLOC_FAIL;
+
+        dict->strings = strings;
+        dict->strings_capacity = capacity;
+    }
+
+    memcpy(dict->strings + dict->strings_size, data, length);
+    dict->strings_size += length;
+
+    dict->count++;
+    dict->offsets[dict->count] = dict->strings_size;
+    dict->slots[slot] = dict->count;
+
+    *code = dict->count;
+
+    return HAM_OK;
+}
+
+const char *ham_dict_value(const ham_dict *dict, uint32_t code, size_t *length) {
+    *length = dict->offsets[code] - dict->offsets[code - 1];
+
+    return dict->strings + dict->offsets[code - 1];
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_dict.h
+ *
+ * Interns the values of a column into small integer codes. The values are copied into one growing
+ * buffer and found through an open addressing hash table, so nothing is allocated for a value that
+ * was seen before.
+ */
+
+#ifndef _HAM_DICT_H_
+#define _HAM_DICT_H_
+
+#include "libhamdata.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct ham_dict {
+    /* Code of the value in each slot, 0 for an empty one */
+    uint32_t *slots;
+    size_t mask;
+
+    /* Value of code c is strings[offsets[c - 1]] up to strings[offsets[c]] */
+    size_t *offsets;
+    char *strings;
+    size_t strings_size;
+    size_t strings_capacity;
+
+    /* Number of values; the codes are 1 to count, in the order the values were first seen */
+    uint32_t count;
+    uint32_t capacity;
+} ham_dict;
+
+void ham_dict_init(ham_dict *dict);
+void ham_dict_destroy(ham_dict *dict);
+
+/* Gives the code of a value, adding it if it is new. HAM_ERROR_MALLOC_FAIL if it cannot grow. */
+int ham_dict_intern(ham_dict *dict, const char *data, size_t length, uint32_t *code);
+
+/* The value of a code from 1 to count. It is not null terminated. */
+const char *ham_dict_value(const ham_dict *dict, uint32_t code, size_t *length);
+
+#endif /* _HAM_DICT_H_ */
@@ -0,0 +1,368 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_index.c
+ */
+
+#include "ham_index.h"
+#include "ham_map.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Average number of callsigns in a bucket. Each bucket costs the file one displacement. */
+#define HAM_INDEX_BUCKET_SIZE 4
+
+/* Displacements tried for a bucket before the build starts over with another seed */
+#define HAM_INDEX_MAX_DISPLACEMENT (1u << 24)
+#define HAM_INDEX_MAX_SEEDS 8
+
+#define HAM_INDEX_INITIAL_CAPACITY 1024
+
+#define HAM_INDEX_GOLDEN 0x9e3779b97f4a7c15ull
+
+struct ham_fcc_index {
+    ham_map map;
+
+    const ham_index_header *header;
+    const uint32_t *displacements;
+    const ham_index_slot *slots;
+};
+
+/* The finalizer of splitmix64 */
+static uint64_t ham_index_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+
+    return x;
+}
+
+/* Hash of a padded callsign. It is two words, so there is no loop over the characters. */
+static uint64_t ham_index_hash(const char *callsign, uint64_t seed) {
+    uint64_t words[2];
+
+    memcpy(words, callsign, sizeof(words));
+
+    return ham_index_mix(ham_index_mix(words[0] ^ seed) ^ words[1]);
+}
+
+/* Multiplies instead of dividing to bring 32 bits of the hash into [0, range) */
+static uint32_t ham_index_reduce(uint64_t bits, uint32_t range) {
+    return (uint32_t)(((bits & 0xffffffffu) * range) >> 32);
+}
+
+static uint32_t ham_index_bucket(uint64_t hash, uint32_t buckets) {
+    return ham_index_reduce(hash >> 32, buckets);
+}
+
+static uint32_t ham_index_position(uint64_t hash, uint32_t displacement, uint32_t count) {
+    return ham_index_reduce(ham_index_mix(hash + displacement * HAM_INDEX_GOLDEN), count);
+}
+
+/* Upper cases and pads the callsign. HAM_ERROR_GENERIC if it is empty or too long. */
+static int ham_index_key(char *key, const char *callsign, size_t length) {
+    if(length == 0 || length >= HAM_INDEX_CALLSIGN_SIZE)
+        return HAM_ERROR_GENERIC;
+
+    memset(key, 0, HAM_INDEX_CALLSIGN_SIZE);
+
+    for(size_t i = 0; i < length; i++)
+        key[i] = (char)toupper((unsigned char)callsign[i]);
+
+    return HAM_OK;
+}
+
+/* Offset of the slots in the file */
+static size_t ham_index_slots_offset(uint32_t buckets) {
+    size_t offset = sizeof(ham_index_header) + buckets * sizeof(uint32_t);
+
+    return (offset + sizeof(ham_index_slot) - 1) / sizeof(ham_index_slot) * sizeof(ham_index_slot);
+}
+
+void ham_index_builder_init(ham_index_builder *builder) {
+    memset(builder, 0, sizeof(ham_index_builder));
+}
+
+void ham_index_builder_destroy(ham_index_builder *builder) {
+    free(builder->slots);
+    memset(builder, 0, sizeof(ham_index_builder));
+}
+
+int ham_index_builder_add(ham_index_builder *builder, const char *callsign, size_t length,
+                            const ham_index_slot *record) {
+    ham_index_slot *slot;
+
+    if(builder->count == builder->capacity) {
+        uint32_t capacity = builder->capacity > 0 ? builder->capacity * 2 :
+                                HAM_INDEX_INITIAL_CAPACITY;
+        ham_index_slot *slots = realloc(builder->slots, capacity * sizeof(ham_index_slot));
+
+        if(slots == NULL)
+            return HAM_ERROR_MALLOC_FAIL;
+
+        builder->slots = slots;
+        builder->capacity = capacity;
+    }
+
+    slot = &builder->slots[builder->count];
+    *slot = *record;
+
+    if(ham_index_key(slot->callsign, callsign, length) != HAM_OK)
+        return HAM_ERROR_GENERIC;
+
+    builder->count++;
+
+    return HAM_OK;
+}
+
+/*
+ * Gives every bucket its displacement and every callsign its position. HAM_ERROR_GENERIC if a
+ * bucket cannot be placed with this seed, e.g. because two callsigns have the same hash.
+ */
+static int ham_index_place(const ham_index_builder *builder, uint64_t seed, uint32_t buckets,
+                            uint32_t *displacements, uint32_t *positions) {
+    uint32_t count = builder->count;
+    uint64_t *hashes = malloc(count * sizeof(uint64_t));
+    uint32_t *sizes = calloc(buckets + 1, sizeof(uint32_t));
+    uint32_t *members = malloc(count * sizeof(uint32_t));
+    uint32_t *order = malloc(buckets * sizeof(uint32_t));
+    unsigned char *taken = calloc(count, 1);
+    uint32_t *starts = NULL, *by_size = NULL;
+    uint32_t largest = 0;
+    int error = HAM_OK;
+
+    if(hashes == NULL || sizes == NULL || members == NULL || order == NULL || taken == NULL)
+        error = HAM_ERROR_MALLOC_FAIL;
+
+    /* Group the callsigns by bucket */
+    if(error == HAM_OK) {
+        for(uint32_t i = 0; i < count; i++) {
+            hashes[i] = ham_index_hash(builder->slots[i].callsign, seed);
+            sizes[ham_index_bucket(hashes[i], buckets) + 1]++;
+        }
+
+        for(uint32_t b = 0; b < buckets; b++) {
+            if(sizes[b + 1] > largest)
+                largest = sizes[b + 1];
+            sizes[b + 1] += sizes[b];
+        }
+
+        starts = malloc((buckets + 1) * sizeof(uint32_t));
+        by_size = calloc(largest + 2, sizeof(uint32_t));
+        if(starts == NULL || by_size == NULL)
+            error = HAM_ERROR_MALLOC_FAIL;
+    }
+
+    if(error == HAM_OK) {
+        memcpy(starts, sizes, (buckets + 1) * sizeof(uint32_t));
+
+        for(uint32_t i = 0; i < count; i++)
+            members[starts[ham_index_bucket(hashes[i], buckets)]++] = i;
+
+        /* Largest buckets first */
+        for(uint32_t b = 0; b < buckets; b++)
+            by_size[largest - (sizes[b + 1] - sizes[b]) + 1]++;
+
+        for(uint32_t s = 0; s <= largest; s++)
+            by_size[s + 1] += by_size[s];
+
+        for(uint32_t b = 0; b < buckets; b++)
+            order[by_size[largest - (sizes[b + 1] - sizes[b])]++] = b;
+    }
+
+    for(uint32_t o = 0; o < buckets && error == HAM_OK; o++) {
+        uint32_t b = order[o];
+        uint32_t first = sizes[b], last = sizes[b + 1];
+        uint32_t d;
+
+        displacements[b] = 0;
+
+        for(d = 0; first < last && d < HAM_INDEX_MAX_DISPLACEMENT; d++) {
+            uint32_t m;
+
+            for(m = first; m < last; m++) {
+                uint32_t position = ham_index_position(hashes[members[m]], d, count);
+                uint32_t k;
+
+                if(taken[position])
+                    break;
+
+                /* Two callsigns of the bucket in the same slot */
+                for(k = first; k < m && positions[members[k]] != position; k++)
+                    ;
+                if(k < m)
+                    break;
+
+                positions[members[m]] = position;
+            }
+
+            if(m == last)
+                break;
+        }
+
+        if(first < last && d == HAM_INDEX_MAX_DISPLACEMENT) {
+            error = HAM_ERROR_GENERIC;
+            break;
+        }
+
+        displacements[b] = d;
+        for(uint32_t m = first; m < last; m++)
+            taken[positions[members[m]]] = 1;
+    }
+
+    free(hashes);
+    free(sizes);
+    free(members);
+    free(order);
+    free(taken);
+    free(starts);
+    free(by_size);
+
+    return error;
+}
+
+int ham_index_write(const ham_index_builder *builder, const char *path) {
+    static const char zeros[sizeof(ham_index_slot)];
+    ham_index_header header;
+    uint32_t buckets = (builder->count + HAM_INDEX_BUCKET_SIZE - 1) / HAM_INDEX_BUCKET_SIZE;
+    uint32_t *displacements, *positions;
+    ham_index_slot *slots;
+    size_t padding;
+    FILE *file;
+    int error = HAM_ERROR_GENERIC;
+
+    if(buckets == 0)
+        buckets = 1;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HAM_INDEX_MAGIC, sizeof(header.magic));
+    header.version = HAM_INDEX_VERSION;
+    header.byte_order = HAM_INDEX_BYTE_ORDER;
+    header.count = builder->count;
+    header.buckets = buckets;
+
+    displacements = calloc(buckets, sizeof(uint32_t));
+    positions = malloc((builder->count + 1) * sizeof(uint32_t));
+    slots = calloc(builder->count + 1, sizeof(ham_index_slot));
+
+    if(displacements == NULL || positions == NULL || slots == NULL)
+        error = HAM_ERROR_MALLOC_FAIL;
+
+    for(int attempt = 0; error == HAM_ERROR_GENERIC && attempt < HAM_INDEX_MAX_SEEDS; attempt++) {
+        header.seed = ham_index_mix(HAM_INDEX_GOLDEN * (uint64_t)(attempt + 1));
+        error = ham_index_place(builder, header.seed, buckets, displacements, positions);
+    }
+
+    if(error == HAM_OK) {
+        for(uint32_t i = 0; i < builder->count; i++)
+            slots[positions[i]] = builder->slots[i];
+
+        file = fopen(path, "wb");
+        if(file == NULL) {
+            error = HAM_ERROR_OPEN_FILE;
+        } else {
+            padding = ham_index_slots_offset(buckets) - sizeof(header) - buckets * sizeof(uint32_t);
+
+            if(fwrite(&header, sizeof(header), 1, file) != 1
+                    || fwrite(displacements, sizeof(uint32_t), buckets, file) != buckets
+                    || fwrite(zeros, 1, padding, file) != padding
+                    || fwrite(slots, sizeof(ham_index_slot), builder->count, file)
+                        != builder->count)
+                error = HAM_ERROR_GENERIC;
+
+            if(fclose(file) && error == HAM_OK)
+                error = HAM_ERROR_GENERIC;
+        }
+    }
+
+    free(displacements);
+    free(positions);
+    free(slots);
+
+    return error;
+}
+
+LIBHAMDATA_API int ham_fcc_index_open(ham_fcc_index **index, const char *path) {
+    const ham_index_header *header;
+    int error;
+
+    *index = calloc(1, sizeof(ham_fcc_index));
+    if(*index == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    /* An empty or unreadable file is not a valid one */
+    error = ham_map_open(&(*index)->map, path);
+    if(error == HAM_ERROR_GENERIC)
+        error = HAM_ERROR_BAD_INDEX;
+
+    if(error != HAM_OK) {
+        free(*index);
+        *index = NULL;
+        return error;
+    }
+
+    header = (const ham_index_header *)(*index)->map.data;
+
+    if((*index)->map.size < sizeof(ham_index_header)
+            || memcmp(header->magic, HAM_INDEX_MAGIC, sizeof(header->magic))
+            || header->version != HAM_INDEX_VERSION || header->byte_order != HAM_INDEX_BYTE_ORDER
+            || header->buckets == 0
+            || (*index)->map.size != ham_index_slots_offset(header->buckets)
+                                    + (size_t)header->count * sizeof(ham_index_slot)) {
+        ham_fcc_index_close(*index);
+        *index = NULL;
+        return HAM_ERROR_BAD_INDEX;
+    }
+
+    (*index)->header = header;
+    (*index)->displacements = (const uint32_t *)((*index)->map.data + sizeof(ham_index_header));
+    (*index)->slots = (const ham_index_slot *)((*index)->map.data +
+                                                ham_index_slots_offset(header->buckets));
+
+    return HAM_OK;
+}
+
+LIBHAMDATA_API int ham_fcc_index_lookup(const ham_fcc_index *index, const char *callsign,
+                                        ham_fcc_index_record *record) {
+    const ham_index_header *header = index->header;
+    const ham_index_slot *slot;
+    char key[HAM_INDEX_CALLSIGN_SIZE];
+    uint64_t hash;
+
+    if(header->count == 0 || ham_index_key(key, callsign, strlen(callsign)) != HAM_OK)
+        return HAM_ERROR_NOT_FOUND;
+
+    hash = ham_index_hash(key, header->seed);
+    slot = &index->slots[ham_index_position(hash,
+                            index->displacements[ham_index_bucket(hash, header->buckets)],
+                            header->count)];
+
+    /* Any callsign lands on some slot; only the one stored there is in the index */
+    if(memcmp(slot->callsign, key, HAM_INDEX_CALLSIGN_SIZE))
+        return HAM_ERROR_NOT_FOUND;
+
+    record->unique_system_identifier = slot->unique_system_identifier;
+    record->expired_date = slot->expired_date;
+    record->operator_class = slot->operator_class;
+    record->license_status = slot->license_status;
+
+    return HAM_OK;
+}
+
+LIBHAMDATA_API void ham_fcc_index_close(ham_fcc_index *index) {
+    if(index == NULL)
+        return;
+
+    ham_map_close(&index->map);
+
+    free(index);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_index.h
+ *
+ * Callsign index file. A minimal perfect hash sends every callsign to its own fixed width slot,
+ * so a lookup hashes the callsign once, reads one displacement and one slot, and compares the
+ * callsign stored there. The file is used in place, memory mapped where the platform allows it.
+ *
+ * The hash is hash and displace: the callsigns are split into buckets of a few each, and every
+ * bucket is given the smallest displacement that sends all of its callsigns to free slots. The
+ * largest buckets are placed first, while most of the slots are still free.
+ */
+
+#ifndef _HAM_INDEX_H_
+#define _HAM_INDEX_H_
+
+#include "libhamdata.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HAM_INDEX_MAGIC "HAMINDEX"
+#define HAM_INDEX_VERSION 1
+
+/* Written as 0x01020304 so a file from a machine of the other byte order is refused */
+#define HAM_INDEX_BYTE_ORDER 0x01020304u
+
+/* Longest callsign the index holds, plus room for the padding */
+#define HAM_INDEX_CALLSIGN_SIZE 16
+
+/*
+ * Start of the file. The bucket displacements follow it, then the slots, which start on a multiple
+ * of the slot size. Everything is in the byte order of the machine that wrote it.
+ */
+typedef struct ham_index_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t count;
+    uint32_t buckets;
+    uint64_t seed;
+} ham_index_header;
+
+/* One callsign and its record. The callsign is upper case and padded with zeros. */
+typedef struct ham_index_slot {
+    char callsign[HAM_INDEX_CALLSIGN_SIZE];
+    INT64 unique_system_identifier;
+    int32_t expired_date;
+    char operator_class;
+    char license_status;
+    char reserved[2];
+} ham_index_slot;
+
+/* Slots collected for the index, in any order. Each callsign must be added only once. */
+typedef struct ham_index_builder {
+    ham_index_slot *slots;
+    uint32_t count;
+    uint32_t capacity;
+} ham_index_builder;
+
+void ham_index_builder_init(ham_index_builder *builder);
+void ham_index_builder_destroy(ham_index_builder *builder);
+
+/*
+ * Adds a callsign. It is upper cased. HAM_ERROR_GENERIC if it is empty or too long for the
+ * index, HAM_ERROR_MALLOC_FAIL if the builder cannot grow.
+ */
+int ham_index_builder_add(ham_index_builder *builder, const char *callsign, size_t length,
+                            const ham_index_slot *record);
+
+/* Builds the hash and writes the file, replacing it if it exists */
+int ham_index_write(const ham_index_builder *builder, const char *path);
+
+#endif /* _HAM_INDEX_H_ */
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_index_bench.c
+ *
+ * Microbenchmark of the callsign index. It looks up every callsign of an HD file, and the same
+ * callsigns with a letter added, which are not in the index. Run it on the index and the file it
+ * was built from, e.g. ham_index_bench callsigns.idx HD.dat
+ */
+
+#include "libhamdata.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_ROUNDS 5
+
+/* Field of the callsign in an HD record, and room for it with a letter added */
+#define BENCH_CALLSIGN_FIELD 4
+#define BENCH_CALLSIGN_SIZE 20
+
+static double seconds(void) {
+    struct timespec now;
+
+    timespec_get(&now, TIME_UTC);
+
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/* The callsigns of the file, one after the other in fixed size entries */
+static char *load_callsigns(const char *path, size_t *count) {
+    FILE *file = fopen(path, "rb");
+    char line[4096];
+    char *callsigns = NULL, *grown;
+    size_t capacity = 0;
+
+    *count = 0;
+
+    if(file == NULL)
+        return NULL;
+
+    while(fgets(line, sizeof(line), file) != NULL) {
+        char *field = line;
+        size_t length;
+
+        for(int i = 0; i < BENCH_CALLSIGN_FIELD && field != NULL; i++) {
+            field = strchr(field, '|');
+            if(field != NULL)
+                field++;
+        }
+
+        if(field == NULL || (length = strcspn(field, "|")) == 0
+                || length >= BENCH_CALLSIGN_SIZE - 1)
+            continue;
+
+        if(*count == capacity) {
+            capacity = capacity > 0 ? capacity * 2 : 1024;
+            grown = realloc(callsigns, capacity * BENCH_CALLSIGN_SIZE);
+            if(grown == NULL)
+                break;
+            callsigns = grown;
+        }
+
+        memcpy(callsigns + *count * BENCH_CALLSIGN_SIZE, field, length);
+        callsigns[*count * BENCH_CALLSIGN_SIZE + length] = '\0';
+        (*count)++;
+    }
+
+    fclose(file);
+    return callsigns;
+}
+
+static void bench_lookups(const char *name, const ham_fcc_index *index, const char *callsigns,
+                            size_t count) {
+    ham_fcc_index_record record;
+    unsigned long found = 0;
+    INT64 checksum = 0;
+    double start = seconds(), elapsed;
+
+    for(int round = 0; round < BENCH_ROUNDS; round++) {
+        for(size_t i = 0; i < count; i++) {
+            const char *callsign = callsigns + i * BENCH_CALLSIGN_SIZE;
+
+            if(ham_fcc_index_lookup(index, callsign, &record) == HAM_OK) {
+                checksum += record.unique_system_identifier;
+                found++;
+            }
+        }
+    }
+
+    elapsed = seconds() - start;
+    printf("%-8s %8.1f ns/lookup  (%lu of %lu found, checksum %lld)\n", name,
+            elapsed * 1e9 / ((double)count * BENCH_ROUNDS), found,
+            (unsigned long)count * BENCH_ROUNDS, (long long)checksum);
+}
+
+int main(int argc, char **argv) {
+    ham_fcc_index *index;
+    char *callsigns;
+    size_t count;
+    double start;
+    int error;
+
+    if(argc < 3) {
+        printf("Usage: %s <callsign index> <HD.dat>\n", argv[0]);
+        return 1;
+    }
+
+    callsigns = load_callsigns(argv[2], &count);
+    if(callsigns == NULL) {
+        printf("Error: failed to read %s\n", argv[2]);
+        return 1;
+    }
+
+    start = seconds();
+    error = ham_fcc_index_open(&index, argv[1]);
+    if(error != HAM_OK) {
+        printf("Error (%d): failed to open %s\n", error, argv[1]);
+        free(callsigns);
+        return 1;
+    }
+
+    printf("%s: opened in %.1f us, %zu callsigns, %d rounds\n", argv[1],
+            (seconds() - start) * 1e6, count, BENCH_ROUNDS);
+
+    bench_lookups("hits", index, callsigns, count);
+
+    /* A letter on the end makes callsigns that are not licensed */
+    for(size_t i = 0; i < count; i++)
+        strcat(callsigns + i * BENCH_CALLSIGN_SIZE, "Q");
+
+    bench_lookups("misses", index, callsigns, count);
+
+    ham_fcc_index_close(index);
+    free(callsigns);
+    return 0;
+}
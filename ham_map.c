@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_map.c
+ */
+
+#include "ham_map.h"
+#include "libhamdata.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(OS_GENERIC)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+int ham_map_stream(ham_map *map, FILE *file) {
+#if defined(OS_GENERIC)
+    struct stat info;
+    void *data;
+    int fd = fileno(file);
+
+    if(fstat(fd, &info) || !S_ISREG(info.st_mode) || info.st_size <= 0)
+        return HAM_ERROR_GENERIC;
+
+    data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED)
+        return HAM_ERROR_GENERIC;
+
+    map->data = data;
+    map->size = (size_t)info.st_size;
+    map->mapped = HAM_BOOL_YES;
+
+    return HAM_OK;
+#else
+    (void)map;
+    (void)file;
+
+    return HAM_ERROR_GENERIC;
+#endif
+}
+
+int ham_map_open(ham_map *map, const char *path) {
+    FILE *file = fopen(path, "rb");
+    char *data;
+    long size;
+
+    memset(map, 0, sizeof(ham_map));
+
+    if(file == NULL)
+        return HAM_ERROR_OPEN_FILE;
+
+    if(ham_map_stream(map, file) == HAM_OK) {
+        fclose(file);
+        return HAM_OK;
+    }
+
+    if(fseek(file, 0, SEEK_END) || (size = ftell(file)) <= 0 || fseek(file, 0, SEEK_SET)) {
+        fclose(file);
+        return HAM_ERROR_GENERIC;
+    }
+
+    data = malloc((size_t)size);
+    if(data == NULL) {
+        fclose(file);
+        return HAM_ERROR_MALLOC_FAIL;
+    }
+
+    if(fread(data, 1, (size_t)size, file) != (size_t)size) {
+        free(data);
+        fclose(file);
+        return HAM_ERROR_GENERIC;
+    }
+
+    fclose(file);
+
+    map->data = data;
+    map->size = (size_t)size;
+    map->mapped = HAM_BOOL_NO;
+
+    return HAM_OK;
+}
+
+void ham_map_close(ham_map *map) {
+#if defined(OS_GENERIC)
+    if(map->mapped == HAM_BOOL_YES)
+        munmap((void *)map->data, map->size);
+    else
+#endif
+        free((void *)map->data);
+
+    memset(map, 0, sizeof(ham_map));
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_map.h
+ *
+ * Read only views of whole files. A file is memory mapped where the platform allows it and read
+ * into memory where it does not, so the callers see the same bytes either way.
+ */
+
+#ifndef _HAM_MAP_H_
+#define _HAM_MAP_H_
+
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct ham_map {
+    const char *data;
+    size_t size;
+
+    /* HAM_BOOL_YES when data is a mapping, HAM_BOOL_NO when it was read into memory */
+    int mapped;
+} ham_map;
+
+/*
+ * Maps an open file. HAM_ERROR_GENERIC for pipes, empty files and platforms without mmap, which
+ * leaves the file where it was.
+ */
+int ham_map_stream(ham_map *map, FILE *file);
+
+/*
+ * Maps the file at path, or reads it all where it cannot be mapped. HAM_ERROR_OPEN_FILE if it
+ * cannot be opened and HAM_ERROR_GENERIC if it is empty or cannot be read.
+ */
+int ham_map_open(ham_map *map, const char *path);
+
+void ham_map_close(ham_map *map);
+
+#endif /* _HAM_MAP_H_ */
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_ring.c
+ */
+
+#include "ham_ring.h"
+#include "ham_thread.h"
+
+#include <stdlib.h>
+
+/* Spins and yields before a blocked side starts sleeping */
+#define HAM_RING_SPINS 64
+#define HAM_RING_YIELDS 64
+#define HAM_RING_SLEEP 50
+
+/*
+ * The producer publishes a slot with a release store of head, and the consumer gives it back with a
+ * release store of tail. The matching acquire loads make the slot contents visible to the other
+ * side.
+ */
+#if defined(_MSC_VER)
+    #define ham_ring_load(p) (*(p))
+    #define ham_ring_store(p, v) do { MemoryBarrier(); *(p) = (v); } while(0)
+    #define ham_ring_aborted(p) (*(p))
+    #define ham_ring_set(p) do { MemoryBarrier(); *(p) = 1; } while(0)
+#else
+    #define ham_ring_load(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define ham_ring_store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+    #define ham_ring_aborted(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+    #define ham_ring_set(p) __atomic_store_n((p), 1, __ATOMIC_RELAXED)
+#endif
+
+static void ham_ring_backoff(unsigned *attempt) {
+    if(*attempt >= HAM_RING_SPINS + HAM_RING_YIELDS) {
+        ham_thread_sleep(HAM_RING_SLEEP);
+        return;
+    }
+
+    if(*attempt >= HAM_RING_SPINS)
+        ham_thread_yield();
+
+    (*attempt)++;
+}
+
+int ham_ring_init(ham_ring *ring, size_t capacity) {
+    size_t size = 1;
+
+    while(size < capacity)
+        size <<= 1;
+
+    ring->slots = calloc(size, sizeof(void *));
+    if(ring->slots == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+
+    return HAM_OK;
+}
+
+void ham_ring_destroy(ham_ring *ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+int ham_ring_push(ham_ring *ring, void *item, volatile int *abort) {
+    size_t head = ring->head;
+    unsigned attempt = 0;
+
+    while(head - ham_ring_load(&ring->tail) > ring->mask) {
+        if(ham_ring_aborted(abort))
+            return HAM_ERROR_GENERIC;
+
+        ham_ring_backoff(&attempt);
+    }
+
+    ring->slots[head & ring->mask] = item;
+    ham_ring_store(&ring->head, head + 1);
+
+    return HAM_OK;
+}
+
+void *ham_ring_pop(ham_ring *ring, volatile int *abort) {
+    size_t tail = ring->tail;
+    unsigned attempt = 0;
+    void *item;
+
+    while(ham_ring_load(&ring->head) == tail) {
+        if(ham_ring_aborted(abort))
+            return NULL;
+
+        ham_ring_backoff(&attempt);
+    }
+
+    item = ring->slots[tail & ring->mask];
+    ham_ring_store(&ring->tail, tail + 1);
+
+    return item;
+}
+
+void ham_ring_abort(volatile int *abort) {
+    ham_ring_set(abort);
+}
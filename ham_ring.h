@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_ring.h
+ *
+ * Bounded single producer, single consumer ring of pointers. Each index is only written by one
+ * side, so no locks are needed. A side that finds the ring full or empty backs off: it spins, then
+ * yields, then sleeps, so a stalled stage does not eat a processor.
+ */
+
+#ifndef _HAM_RING_H_
+#define _HAM_RING_H_
+
+#include <stddef.h>
+
+typedef struct ham_ring {
+    void **slots;
+    size_t mask;
+
+    /* Written by the producer and consumer respectively */
+    volatile size_t head;
+    volatile size_t tail;
+} ham_ring;
+
+/* Capacity is rounded up to a power of two */
+int ham_ring_init(ham_ring *ring, size_t capacity);
+void ham_ring_destroy(ham_ring *ring);
+
+/*
+ * Blocking push and pop. They give up and return HAM_ERROR_GENERIC or NULL once *abort is set,
+ * which lets any stage stop the others.
+ */
+int ham_ring_push(ham_ring *ring, void *item, volatile int *abort);
+void *ham_ring_pop(ham_ring *ring, volatile int *abort);
+
+/* Sets an abort flag shared by the rings of a pipeline */
+void ham_ring_abort(volatile int *abort);
+
+#endif /* _HAM_RING_H_ */
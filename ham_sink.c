@@ -0,0 +1,812 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_sink.c
+ *
+ * The Arrow IPC stream and PostgreSQL binary COPY sinks. Both convert the field views as they come
+ * and write them out a batch at a time, so neither holds more than a batch of a table in memory.
+ */
+
+#include "libhamdata.h"
+#include "ham_buffer.h"
+#include "ham_value.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HAM_SINK_PATH_SIZE 512
+
+/* Arrow metadata version V5, and the message header and type union members used here */
+#define HAM_ARROW_VERSION 4
+#define HAM_ARROW_HEADER_SCHEMA 1
+#define HAM_ARROW_HEADER_RECORD_BATCH 3
+#define HAM_ARROW_TYPE_INT 2
+#define HAM_ARROW_TYPE_UTF8 5
+#define HAM_ARROW_TYPE_DATE 8
+#define HAM_ARROW_DATE_DAY 0
+#define HAM_ARROW_CONTINUATION 0xffffffffu
+
+/* Arrow body buffers start on a multiple of this */
+#define HAM_ARROW_ALIGNMENT 8
+
+/* Days from 1970-01-01, where Arrow counts dates from, to 2000-01-01, where PostgreSQL does */
+#define HAM_PGCOPY_EPOCH_DAYS 10957
+
+static const char HAM_PGCOPY_SIGNATURE[11] = "PGCOPY\n\377\r\n\0";
+
+typedef struct ham_arrow_column {
+    int type;
+
+    /* Validity bitmap, the int64, date32 or offset values, and the bytes of a utf8 column */
+    ham_buffer validity;
+    ham_buffer values;
+    ham_buffer data;
+
+    INT64 null_count;
+} ham_arrow_column;
+
+typedef struct ham_arrow_sink {
+    char directory[HAM_SINK_PATH_SIZE];
+    FILE *file;
+
+    ham_arrow_column *columns;
+    int num_columns;
+
+    /* Rows of the record batch being built */
+    int rows;
+
+    /* Flatbuffer of the message being written */
+    ham_buffer message;
+} ham_arrow_sink;
+
+typedef struct ham_pgcopy_sink {
+    char directory[HAM_SINK_PATH_SIZE];
+    FILE *file;
+    FILE *load;
+
+    int *types;
+    int num_columns;
+
+    /* Tuples of the batch being written */
+    ham_buffer tuples;
+} ham_pgcopy_sink;
+
+static void ham_sink_pad(ham_buffer *buffer, size_t alignment) {
+    size_t padding = (alignment - buffer->size % alignment) % alignment;
+
+    ham_buffer_append(buffer, NULL, padding);
+}
+
+static void ham_sink_set(ham_buffer *buffer, size_t position, const void *data, size_t size) {
+    if(buffer->error == HAM_OK)
+        memcpy(buffer->data + position, data, size);
+}
+
+/* Whether the bytes are well formed UTF-8: no overlong forms, surrogates or values over 10FFFF */
+static int ham_sink_utf8(const unsigned char *data, size_t length) {
+    size_t i = 0, count;
+    uint32_t code;
+
+    while(i < length) {
+        if(data[i] < 0x80) {
+            i++;
+            continue;
+        }
+
+        /* Continuation bytes after the lead byte */
+        if(data[i] >= 0xc2 && data[i] <= 0xdf)
+            count = 1;
+        else if(data[i] >= 0xe0 && data[i] <= 0xef)
+            count = 2;
+        else if(data[i] >= 0xf0 && data[i] <= 0xf4)
+            count = 3;
+        else
+            return HAM_BOOL_NO;
+
+        code = data[i] & (0x3f >> count);
+
+        if(length - i <= count)
+            return HAM_BOOL_NO;
+
+        for(size_t j = 1; j <= count; j++) {
+            if((data[i + j] & 0xc0) != 0x80)
+                return HAM_BOOL_NO;
+
+            code = code << 6 | (data[i + j] & 0x3f);
+        }
+
+        if((count == 2 && (code < 0x800 || (code >= 0xd800 && code <= 0xdfff)))
+                || (count == 3 && (code < 0x10000 || code > 0x10ffff)))
+            return HAM_BOOL_NO;
+
+        i += count + 1;
+    }
+
+    return HAM_BOOL_YES;
+}
+
+/*
+ * Appends a text field as UTF-8, which both Arrow's utf8 and PostgreSQL's text expect. The files
+ * are ASCII but for the odd accented letter in a name or address, which is Latin-1; a field that is
+ * not already UTF-8 is taken to be Latin-1 and converted. Returns the bytes appended.
+ */
+static size_t ham_sink_text(ham_buffer *buffer, const char *data, size_t length) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    unsigned char pair[2];
+    size_t size = buffer->size;
+
+    if(ham_sink_utf8(bytes, length) == HAM_BOOL_YES) {
+        ham_buffer_append(buffer, data, length);
+        return length;
+    }
+
+    for(size_t i = 0; i < length; i++) {
+        if(bytes[i] < 0x80) {
+            ham_buffer_append(buffer, &bytes[i], 1);
+        } else {
+            pair[0] = (unsigned char)(0xc0 | bytes[i] >> 6);
+            pair[1] = (unsigned char)(0x80 | (bytes[i] & 0x3f));
+            ham_buffer_append(buffer, pair, sizeof(pair));
+        }
+    }
+
+    return buffer->size - size;
+}
+
+static int ham_sink_path(char *path, size_t size, const char *directory, const char *name) {
+    if((size_t)snprintf(path, size, "%s/%s", directory, name) >= size)
+        return HAM_ERROR_DIR_TOO_LONG;
+
+    return HAM_OK;
+}
+
+static int ham_sink_directory(char *destination, const char *directory) {
+    if(directory == NULL)
+        directory = ".";
+
+    if(strlen(directory) + 1 > HAM_SINK_PATH_SIZE)
+        return HAM_ERROR_DIR_TOO_LONG;
+
+    strcpy(destination, directory);
+
+    return HAM_OK;
+}
+
+static int ham_sink_close_file(FILE **file) {
+    int error = HAM_OK;
+
+    if(*file != NULL && fclose(*file))
+        error = HAM_ERROR_GENERIC;
+
+    *file = NULL;
+
+    return error;
+}
+
+/*
+ * Flatbuffers, written front to back. A table is preceded by its vtable, and every offset field
+ * is linked once the object it points to has been written after it, which keeps the offsets
+ * forward as the format needs.
+ */
+
+/* A table of size bytes whose fields are at the slots' positions, 0 for a field left out */
+static size_t ham_flatbuffer_table(ham_buffer *buffer, const uint16_t *slots, int count,
+                                    uint16_t size) {
+    uint16_t header[2] = {(uint16_t)(4 + 2 * count), size};
+    size_t vtable, table;
+    int32_t distance;
+
+    ham_sink_pad(buffer, 2);
+    vtable = ham_buffer_append(buffer, header, sizeof(header));
+    ham_buffer_append(buffer, slots, count * sizeof(uint16_t));
+
+    ham_sink_pad(buffer, 8);
+    table = ham_buffer_append(buffer, NULL, size);
+
+    distance = (int32_t)(table - vtable);
+    ham_sink_set(buffer, table, &distance, sizeof(distance));
+
+    return table;
+}
+
+/* A vector of count elements, zeroed, with the elements on the alignment */
+static size_t ham_flatbuffer_vector(ham_buffer *buffer, uint32_t count, size_t element_size,
+                                    size_t alignment) {
+    size_t vector;
+
+    ham_sink_pad(buffer, 4);
+    while((buffer->size + 4) % alignment != 0)
+        ham_buffer_append(buffer, NULL, 4);
+
+    vector = ham_buffer_append(buffer, &count, sizeof(count));
+    ham_buffer_append(buffer, NULL, count * element_size);
+
+    return vector;
+}
+
+static size_t ham_flatbuffer_string(ham_buffer *buffer, const char *string) {
+    uint32_t length = (uint32_t)strlen(string);
+    size_t position;
+
+    ham_sink_pad(buffer, 4);
+    position = ham_buffer_append(buffer, &length, sizeof(length));
+    ham_buffer_append(buffer, string, length + 1);
+
+    return position;
+}
+
+/* Points the offset field at position to the object at target */
+static void ham_flatbuffer_link(ham_buffer *buffer, size_t position, size_t target) {
+    uint32_t offset = (uint32_t)(target - position);
+
+    ham_sink_set(buffer, position, &offset, sizeof(offset));
+}
+
+/* Message: header at 4, bodyLength at 8, version at 16 and header_type at 18 */
+static const uint16_t HAM_ARROW_MESSAGE_SLOTS[4] = {16, 18, 4, 8};
+
+/* Starts a message with the root offset and the message table. Returns the header field. */
+static size_t ham_arrow_message(ham_buffer *buffer, uint8_t header_type, INT64 body_length) {
+    int16_t version = HAM_ARROW_VERSION;
+    size_t root, message;
+
+    ham_buffer_reset(buffer);
+
+    root = ham_buffer_append(buffer, NULL, sizeof(uint32_t));
+    message = ham_flatbuffer_table(buffer, HAM_ARROW_MESSAGE_SLOTS, 4, 20);
+    ham_flatbuffer_link(buffer, root, message);
+
+    ham_sink_set(buffer, message + 8, &body_length, sizeof(body_length));
+    ham_sink_set(buffer, message + 16, &version, sizeof(version));
+    ham_sink_set(buffer, message + 18, &header_type, sizeof(header_type));
+
+    return message + 4;
+}
+
+/* The encapsulated message: continuation, metadata length, metadata padded out to 8 bytes */
+static int ham_arrow_write_message(ham_arrow_sink *arrow) {
+    uint32_t prefix[2];
+
+    ham_sink_pad(&arrow->message, HAM_ARROW_ALIGNMENT);
+    if(arrow->message.error != HAM_OK)
+        return arrow->message.error;
+
+    prefix[0] = HAM_ARROW_CONTINUATION;
+    prefix[1] = (uint32_t)arrow->message.size;
+
+    if(fwrite(prefix, sizeof(prefix), 1, arrow->file) != 1
+            || fwrite(arrow->message.data, arrow->message.size, 1, arrow->file) != 1)
+        return HAM_ERROR_GENERIC;
+
+    return HAM_OK;
+}
+
+/* Schema: fields at 4, endianness at 8 */
+static const uint16_t HAM_ARROW_SCHEMA_SLOTS[2] = {8, 4};
+
+/* Field: name at 4, nullable at 16, type_type at 17, type at 8, no dictionary, children at 12 */
+static const uint16_t HAM_ARROW_FIELD_SLOTS[6] = {4, 16, 17, 8, 0, 12};
+
+/* Int: bitWidth at 4, is_signed at 8. Date: unit at 4. */
+static const uint16_t HAM_ARROW_INT_SLOTS[2] = {4, 8};
+static const uint16_t HAM_ARROW_DATE_SLOTS[1] = {4};
+
+static size_t ham_arrow_type(ham_buffer *buffer, int type, uint8_t *type_type) {
+    int32_t bit_width = 64;
+    int16_t unit = HAM_ARROW_DATE_DAY;
+    uint8_t is_signed = 1;
+    size_t table;
+
+    switch(type) {
+        case HAM_COLUMN_INT64:
+            *type_type = HAM_ARROW_TYPE_INT;
+            table = ham_flatbuffer_table(buffer, HAM_ARROW_INT_SLOTS, 2, 12);
+            ham_sink_set(buffer, table + 4, &bit_width, sizeof(bit_width));
+            ham_sink_set(buffer, table + 8, &is_signed, sizeof(is_signed));
+            return table;
+
+        case HAM_COLUMN_DATE:
+            *type_type = HAM_ARROW_TYPE_DATE;
+            table = ham_flatbuffer_table(buffer, HAM_ARROW_DATE_SLOTS, 1, 8);
+            ham_sink_set(buffer, table + 4, &unit, sizeof(unit));
+            return table;
+
+        default:
+            *type_type = HAM_ARROW_TYPE_UTF8;
+            return ham_flatbuffer_table(buffer, NULL, 0, 4);
+    }
+}
+
+static int ham_arrow_write_schema(ham_arrow_sink *arrow, const ham_fcc_sink_table *table) {
+    ham_buffer *buffer = &arrow->message;
+    const uint16_t probe = 1;
+    int16_t endianness = *(const uint8_t *)&probe == 1 ? 0 : 1;
+    uint8_t nullable = 1, type_type;
+    size_t header, schema, fields, field, position;
+
+    header = ham_arrow_message(buffer, HAM_ARROW_HEADER_SCHEMA, 0);
+
+    schema = ham_flatbuffer_table(buffer, HAM_ARROW_SCHEMA_SLOTS, 2, 12);
+    ham_flatbuffer_link(buffer, header, schema);
+    ham_sink_set(buffer, schema + 8, &endianness, sizeof(endianness));
+
+    fields = ham_flatbuffer_vector(buffer, (uint32_t)table->num_columns, sizeof(uint32_t), 4);
+    ham_flatbuffer_link(buffer, schema + 4, fields);
+
+    for(int i = 0; i < table->num_columns; i++) {
+        field = ham_flatbuffer_table(buffer, HAM_ARROW_FIELD_SLOTS, 6, 20);
+        ham_flatbuffer_link(buffer, fields + 4 + 4 * i, field);
+        ham_sink_set(buffer, field + 16, &nullable, sizeof(nullable));
+
+        position = ham_flatbuffer_string(buffer, table->column_names[i]);
+        ham_flatbuffer_link(buffer, field + 4, position);
+
+        position = ham_arrow_type(buffer, table->column_types[i], &type_type);
+        ham_flatbuffer_link(buffer, field + 8, position);
+        ham_sink_set(buffer, field + 17, &type_type, sizeof(type_type));
+
+        /* Readers expect the children even when there are none */
+        position = ham_flatbuffer_vector(buffer, 0, sizeof(uint32_t), 4);
+        ham_flatbuffer_link(buffer, field + 12, position);
+    }
+
+    return ham_arrow_write_message(arrow);
+}
+
+/* Clears the batch. Utf8 columns start with the offset of their first value. */
+static void ham_arrow_start_batch(ham_arrow_sink *arrow) {
+    const int32_t zero = 0;
+    ham_arrow_column *column;
+
+    arrow->rows = 0;
+
+    for(int i = 0; i < arrow->num_columns; i++) {
+        column = &arrow->columns[i];
+
+        ham_buffer_reset(&column->validity);
+        ham_buffer_reset(&column->values);
+        ham_buffer_reset(&column->data);
+        column->null_count = 0;
+
+        if(column->type != HAM_COLUMN_INT64 && column->type != HAM_COLUMN_DATE)
+            ham_buffer_append(&column->values, &zero, sizeof(zero));
+    }
+}
+
+static void ham_arrow_add(ham_arrow_column *column, int row, const ham_field *field) {
+    INT64 value = 0;
+    int32_t offset, days = 0;
+    int valid;
+
+    switch(column->type) {
+        case HAM_COLUMN_INT64:
+            valid = ham_parse_int64(field->data, field->length, &value) == HAM_OK;
+            ham_buffer_append(&column->values, &value, sizeof(value));
+            break;
+
+        case HAM_COLUMN_DATE:
+            valid = ham_parse_date(field->data, field->length, &value) == HAM_OK;
+            if(valid)
+                days = (int32_t)ham_date_days(value);
+
+            ham_buffer_append(&column->values, &days, sizeof(days));
+            break;
+
+        default:
+            valid = field->length > 0;
+            ham_sink_text(&column->data, field->data, field->length);
+
+            offset = (int32_t)column->data.size;
+            ham_buffer_append(&column->values, &offset, sizeof(offset));
+            break;
+    }
+
+    if(row % 8 == 0)
+        ham_buffer_append(&column->validity, NULL, 1);
+
+    if(!valid)
+        column->null_count++;
+    else if(column->validity.error == HAM_OK)
+        ((unsigned char *)column->validity.data)[row / 8] |= (unsigned char)(1 << (row % 8));
+}
+
+/* The body buffers of a column in order: validity, values, and the data of a utf8 column */
+static int ham_arrow_buffers(const ham_arrow_column *column, const ham_buffer **buffers) {
+    buffers[0] = &column->validity;
+    buffers[1] = &column->values;
+    buffers[2] = &column->data;
+
+    return column->type == HAM_COLUMN_INT64 || column->type == HAM_COLUMN_DATE ? 2 : 3;
+}
+
+/* RecordBatch: length at 16, nodes at 4, buffers at 8 */
+static const uint16_t HAM_ARROW_RECORD_BATCH_SLOTS[3] = {16, 4, 8};
+
+static int ham_arrow_write_batch(ham_arrow_sink *arrow) {
+    static const char padding[HAM_ARROW_ALIGNMENT];
+    ham_buffer *buffer = &arrow->message;
+    const ham_buffer *buffers[3];
+    uint32_t num_buffers = 0;
+    INT64 body_length = 0, length = arrow->rows, node[2], region[2];
+    size_t header, batch, nodes, regions, padded;
+    int count, error, index = 0;
+
+    for(int i = 0; i < arrow->num_columns; i++) {
+        count = ham_arrow_buffers(&arrow->columns[i], buffers);
+
+        for(int j = 0; j < count; j++) {
+            if(buffers[j]->error != HAM_OK)
+                return buffers[j]->error;
+
+            body_length += (buffers[j]->size + HAM_ARROW_ALIGNMENT - 1) / HAM_ARROW_ALIGNMENT
+                            * HAM_ARROW_ALIGNMENT;
+            num_buffers++;
+        }
+    }
+
+    header = ham_arrow_message(buffer, HAM_ARROW_HEADER_RECORD_BATCH, body_length);
+
+    batch = ham_flatbuffer_table(buffer, HAM_ARROW_RECORD_BATCH_SLOTS, 3, 24);
+    ham_flatbuffer_link(buffer, header, batch);
+    ham_sink_set(buffer, batch + 16, &length, sizeof(length));
+
+    nodes = ham_flatbuffer_vector(buffer, (uint32_t)arrow->num_columns, sizeof(node), 8);
+    ham_flatbuffer_link(buffer, batch + 4, nodes);
+
+    regions = ham_flatbuffer_vector(buffer, num_buffers, sizeof(region), 8);
+    ham_flatbuffer_link(buffer, batch + 8, regions);
+
+    region[0] = 0;
+
+    for(int i = 0; i < arrow->num_columns; i++) {
+        node[0] = length;
+        node[1] = arrow->columns[i].null_count;
+        ham_sink_set(buffer, nodes + 4 + i * sizeof(node), node, sizeof(node));
+
+        count = ham_arrow_buffers(&arrow->columns[i], buffers);
+
+        for(int j = 0; j < count; j++, index++) {
+            region[1] = (INT64)buffers[j]->size;
+            ham_sink_set(buffer, regions + 4 + index * sizeof(region), region, sizeof(region));
+
+            region[0] += (region[1] + HAM_ARROW_ALIGNMENT - 1) / HAM_ARROW_ALIGNMENT
+                            * HAM_ARROW_ALIGNMENT;
+        }
+    }
+
+    error = ham_arrow_write_message(arrow);
+
+    for(int i = 0; i < arrow->num_columns && error == HAM_OK; i++) {
+        count = ham_arrow_buffers(&arrow->columns[i], buffers);
+
+        for(int j = 0; j < count && error == HAM_OK; j++) {
+            padded = (HAM_ARROW_ALIGNMENT - buffers[j]->size % HAM_ARROW_ALIGNMENT)
+                        % HAM_ARROW_ALIGNMENT;
+
+            if((buffers[j]->size > 0
+                    && fwrite(buffers[j]->data, buffers[j]->size, 1, arrow->file) != 1)
+                    || (padded > 0 && fwrite(padding, padded, 1, arrow->file) != 1))
+                error = HAM_ERROR_GENERIC;
+        }
+    }
+
+    ham_arrow_start_batch(arrow);
+
+    return error;
+}
+
+static void ham_arrow_free_columns(ham_arrow_sink *arrow) {
+    for(int i = 0; i < arrow->num_columns; i++) {
+        ham_buffer_free(&arrow->columns[i].validity);
+        ham_buffer_free(&arrow->columns[i].values);
+        ham_buffer_free(&arrow->columns[i].data);
+    }
+
+    free(arrow->columns);
+    arrow->columns = NULL;
+    arrow->num_columns = 0;
+}
+
+static int ham_arrow_begin_table(void *context, const ham_fcc_sink_table *table) {
+    ham_arrow_sink *arrow = context;
+    char name[HAM_SINK_PATH_SIZE], path[HAM_SINK_PATH_SIZE];
+    int error;
+
+    snprintf(name, sizeof(name), "%s.arrows", table->name);
+
+    error = ham_sink_path(path, sizeof(path), arrow->directory, name);
+    if(error != HAM_OK)
+        return error;
+
+    arrow->columns = calloc(table->num_columns, sizeof(ham_arrow_column));
+    if(arrow->columns == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    arrow->num_columns = table->num_columns;
+    for(int i = 0; i < table->num_columns; i++)
+        arrow->columns[i].type = table->column_types[i];
+
+    arrow->file = fopen(path, "wb");
+    if(arrow->file == NULL)
+        return HAM_ERROR_OPEN_FILE;
+
+    ham_arrow_start_batch(arrow);
+
+    return ham_arrow_write_schema(arrow, table);
+}
+
+static int ham_arrow_append_rows(void *context, const ham_field *fields, int rows) {
+    ham_arrow_sink *arrow = context;
+    int error = HAM_OK;
+
+    for(int row = 0; row < rows && error == HAM_OK; row++) {
+        for(int i = 0; i < arrow->num_columns; i++)
+            ham_arrow_add(&arrow->columns[i], arrow->rows, &fields[row * arrow->num_columns + i]);
+
+        if(++arrow->rows == HAM_ARROW_BATCH_ROWS)
+            error = ham_arrow_write_batch(arrow);
+    }
+
+    return error;
+}
+
+/* The last partial batch, then the end of stream marker: a continuation and a length of 0 */
+static int ham_arrow_end_table(void *context) {
+    ham_arrow_sink *arrow = context;
+    uint32_t end[2] = {HAM_ARROW_CONTINUATION, 0};
+    int error = HAM_OK;
+
+    if(arrow->rows > 0)
+        error = ham_arrow_write_batch(arrow);
+
+    if(error == HAM_OK && fwrite(end, sizeof(end), 1, arrow->file) != 1)
+        error = HAM_ERROR_GENERIC;
+
+    if(ham_sink_close_file(&arrow->file) != HAM_OK && error == HAM_OK)
+        error = HAM_ERROR_GENERIC;
+
+    ham_arrow_free_columns(arrow);
+
+    return error;
+}
+
+static void ham_arrow_close(void *context) {
+    ham_arrow_sink *arrow = context;
+
+    ham_sink_close_file(&arrow->file);
+    ham_arrow_free_columns(arrow);
+    ham_buffer_free(&arrow->message);
+    free(arrow);
+}
+
+LIBHAMDATA_API int ham_fcc_arrow_sink_open(ham_fcc_sink *sink, const char *directory) {
+    ham_arrow_sink *arrow;
+    int error;
+
+    memset(sink, 0, sizeof(ham_fcc_sink));
+
+    arrow = calloc(1, sizeof(ham_arrow_sink));
+    if(arrow == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    error = ham_sink_directory(arrow->directory, directory);
+    if(error != HAM_OK) {
+        free(arrow);
+        return error;
+    }
+
+    sink->context = arrow;
+    sink->begin_table = ham_arrow_begin_table;
+    sink->append_rows = ham_arrow_append_rows;
+    sink->end_table = ham_arrow_end_table;
+    sink->close = ham_arrow_close;
+
+    return HAM_OK;
+}
+
+/* COPY's binary format is in network byte order */
+static void ham_pgcopy_put(ham_buffer *buffer, uint64_t value, int size) {
+    unsigned char bytes[8];
+
+    for(int i = 0; i < size; i++)
+        bytes[i] = (unsigned char)(value >> (8 * (size - 1 - i)));
+
+    ham_buffer_append(buffer, bytes, size);
+}
+
+static void ham_pgcopy_add(ham_buffer *buffer, int type, const ham_field *field) {
+    unsigned char length[4];
+    size_t position, size;
+    INT64 value;
+
+    switch(type) {
+        case HAM_COLUMN_INT64:
+            if(ham_parse_int64(field->data, field->length, &value) != HAM_OK)
+                break;
+
+            ham_pgcopy_put(buffer, 8, 4);
+            ham_pgcopy_put(buffer, (uint64_t)value, 8);
+            return;
+
+        case HAM_COLUMN_DATE:
+            if(ham_parse_date(field->data, field->length, &value) != HAM_OK)
+                break;
+
+            ham_pgcopy_put(buffer, 4, 4);
+            ham_pgcopy_put(buffer, (uint32_t)(ham_date_days(value) - HAM_PGCOPY_EPOCH_DAYS), 4);
+            return;
+
+        default:
+            if(field->length == 0)
+                break;
+
+            /* The length goes in front once the converted text is known */
+            position = ham_buffer_append(buffer, NULL, sizeof(length));
+            size = ham_sink_text(buffer, field->data, field->length);
+
+            for(int i = 0; i < 4; i++)
+                length[i] = (unsigned char)(size >> (8 * (3 - i)));
+
+            ham_sink_set(buffer, position, length, sizeof(length));
+            return;
+    }
+
+    /* A length of -1 is NULL */
+    ham_pgcopy_put(buffer, 0xffffffffu, 4);
+}
+
+static const char *ham_pgcopy_type(int type) {
+    switch(type) {
+        case HAM_COLUMN_INT64:
+            return "bigint";
+
+        case HAM_COLUMN_DATE:
+            return "date";
+
+        default:
+            return "text";
+    }
+}
+
+/* Recreates the table and copies the file in */
+static int ham_pgcopy_write_load(FILE *load, const ham_fcc_sink_table *table) {
+    fprintf(load, "DROP TABLE IF EXISTS \"%s\";\nCREATE TABLE \"%s\" (\n", table->name,
+            table->name);
+
+    for(int i = 0; i < table->num_columns; i++)
+        fprintf(load, "    \"%s\" %s%s\n", table->column_names[i],
+                ham_pgcopy_type(table->column_types[i]), i + 1 < table->num_columns ? "," : "");
+
+    fprintf(load, ");\n\\copy \"%s\" FROM '%s.pgcopy' WITH (FORMAT binary)\n\n", table->name,
+            table->name);
+
+    return ferror(load) ? HAM_ERROR_GENERIC : HAM_OK;
+}
+
+static int ham_pgcopy_begin_table(void *context, const ham_fcc_sink_table *table) {
+    ham_pgcopy_sink *pgcopy = context;
+    char name[HAM_SINK_PATH_SIZE], path[HAM_SINK_PATH_SIZE];
+    uint32_t header[2] = {0, 0};
+    int error;
+
+    snprintf(name, sizeof(name), "%s.pgcopy", table->name);
+
+    error = ham_sink_path(path, sizeof(path), pgcopy->directory, name);
+    if(error != HAM_OK)
+        return error;
+
+    pgcopy->types = malloc(table->num_columns * sizeof(int));
+    if(pgcopy->types == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    memcpy(pgcopy->types, table->column_types, table->num_columns * sizeof(int));
+    pgcopy->num_columns = table->num_columns;
+
+    pgcopy->file = fopen(path, "wb");
+    if(pgcopy->file == NULL)
+        return HAM_ERROR_OPEN_FILE;
+
+    /* The signature, then no flags and no header extension */
+    if(fwrite(HAM_PGCOPY_SIGNATURE, sizeof(HAM_PGCOPY_SIGNATURE), 1, pgcopy->file) != 1
+            || fwrite(header, sizeof(header), 1, pgcopy->file) != 1)
+        return HAM_ERROR_GENERIC;
+
+    return ham_pgcopy_write_load(pgcopy->load, table);
+}
+
+static int ham_pgcopy_append_rows(void *context, const ham_field *fields, int rows) {
+    ham_pgcopy_sink *pgcopy = context;
+    ham_buffer *tuples = &pgcopy->tuples;
+
+    ham_buffer_reset(tuples);
+
+    for(int row = 0; row < rows; row++) {
+        ham_pgcopy_put(tuples, (uint16_t)pgcopy->num_columns, 2);
+
+        for(int i = 0; i < pgcopy->num_columns; i++)
+            ham_pgcopy_add(tuples, pgcopy->types[i], &fields[row * pgcopy->num_columns + i]);
+    }
+
+    if(tuples->error != HAM_OK)
+        return tuples->error;
+
+    if(tuples->size > 0 && fwrite(tuples->data, tuples->size, 1, pgcopy->file) != 1)
+        return HAM_ERROR_GENERIC;
+
+    return HAM_OK;
+}
+
+/* The trailer is a field count of -1 */
+static int ham_pgcopy_end_table(void *context) {
+    ham_pgcopy_sink *pgcopy = context;
+    const unsigned char trailer[2] = {0xff, 0xff};
+    int error = HAM_OK;
+
+    if(fwrite(trailer, sizeof(trailer), 1, pgcopy->file) != 1 || fflush(pgcopy->load))
+        error = HAM_ERROR_GENERIC;
+
+    if(ham_sink_close_file(&pgcopy->file) != HAM_OK && error == HAM_OK)
+        error = HAM_ERROR_GENERIC;
+
+    free(pgcopy->types);
+    pgcopy->types = NULL;
+
+    return error;
+}
+
+static void ham_pgcopy_close(void *context) {
+    ham_pgcopy_sink *pgcopy = context;
+
+    ham_sink_close_file(&pgcopy->file);
+    ham_sink_close_file(&pgcopy->load);
+    ham_buffer_free(&pgcopy->tuples);
+    free(pgcopy->types);
+    free(pgcopy);
+}
+
+LIBHAMDATA_API int ham_fcc_pgcopy_sink_open(ham_fcc_sink *sink, const char *directory) {
+    ham_pgcopy_sink *pgcopy;
+    char path[HAM_SINK_PATH_SIZE];
+    int error;
+
+    memset(sink, 0, sizeof(ham_fcc_sink));
+
+    pgcopy = calloc(1, sizeof(ham_pgcopy_sink));
+    if(pgcopy == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    error = ham_sink_directory(pgcopy->directory, directory);
+    if(error == HAM_OK)
+        error = ham_sink_path(path, sizeof(path), pgcopy->directory, "load.sql");
+
+    if(error == HAM_OK) {
+        pgcopy->load = fopen(path, "w");
+        if(pgcopy->load == NULL)
+            error = HAM_ERROR_OPEN_FILE;
+    }
+
+    if(error != HAM_OK) {
+        free(pgcopy);
+        return error;
+    }
+
+    sink->context = pgcopy;
+    sink->begin_table = ham_pgcopy_begin_table;
+    sink->append_rows = ham_pgcopy_append_rows;
+    sink->end_table = ham_pgcopy_end_table;
+    sink->close = ham_pgcopy_close;
+
+    return HAM_OK;
+}
+
+LIBHAMDATA_API void ham_fcc_sink_close(ham_fcc_sink *sink) {
+    if(sink->close != NULL)
+        sink->close(sink->context);
+
+    memset(sink, 0, sizeof(ham_fcc_sink));
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_split.c
+ */
+
+#include "ham_split.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define HAM_SPLIT_X86
+    #include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+    #define HAM_TARGET_AVX2
+
+static int ham_ctz(uint32_t value) {
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return (int)index;
+}
+#else
+    #define HAM_TARGET_AVX2 __attribute__((target("avx2")))
+    #define ham_ctz(value) __builtin_ctz(value)
+#endif
+
+typedef const char *(*ham_split_function)(const char *, const char *, const char, ham_record *);
+
+/* Records the delimiter as the end of a field */
+static void ham_split_field(ham_record *record, const char *delimiter) {
+    if(record->num_fields < HAM_SPLIT_MAX_FIELDS)
+        record->starts[record->num_fields] = (uint32_t)(delimiter - record->line + 1);
+
+    record->num_fields++;
+}
+
+/* Closes the record at line_end, dropping the carriage return of a DOS line ending */
+static const char *ham_split_finish(ham_record *record, const char *line_end, const char *next) {
+    size_t length = line_end - record->line;
+    int stored = record->num_fields;
+
+    if(length > 0 && record->line[length - 1] == '\r')
+        length--;
+
+    if(stored > HAM_SPLIT_MAX_FIELDS)
+        stored = HAM_SPLIT_MAX_FIELDS;
+
+    record->length = length;
+    record->starts[stored] = (uint32_t)(length + 1);
+
+    return next;
+}
+
+static const char *ham_split_scalar(const char *p, const char *end, const char delimiter,
+                                    ham_record *record) {
+    for(; p < end; p++) {
+        if(*p == '\n')
+            return ham_split_finish(record, p, p + 1);
+
+        if(*p == delimiter)
+            ham_split_field(record, p);
+    }
+
+    return ham_split_finish(record, end, NULL);
+}
+
+#if defined(HAM_SPLIT_X86)
+
+/*
+ * The vector versions compare a whole block against both the delimiter and the new line, then walk
+ * the set bits of the masks. Delimiters past the first new line in the block belong to the next
+ * record and are masked off.
+ */
+static const char *ham_split_sse2(const char *p, const char *end, const char delimiter,
+                                    ham_record *record) {
+    const __m128i delimiters = _mm_set1_epi8(delimiter);
+    const __m128i newlines = _mm_set1_epi8('\n');
+
+    for(; end - p >= 16; p += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)p);
+        uint32_t newline = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newlines));
+        uint32_t fields = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, delimiters));
+
+        if(newline != 0)
+            fields &= (1u << ham_ctz(newline)) - 1;
+
+        while(fields != 0) {
+            ham_split_field(record, p + ham_ctz(fields));
+            fields &= fields - 1;
+        }
+
+        if(newline != 0)
+            return ham_split_finish(record, p + ham_ctz(newline), p + ham_ctz(newline) + 1);
+    }
+
+    return ham_split_scalar(p, end, delimiter, record);
+}
+
+HAM_TARGET_AVX2
+static const char *ham_split_avx2(const char *p, const char *end, const char delimiter,
+                                    ham_record *record) {
+    const __m256i delimiters = _mm256_set1_epi8(delimiter);
+    const __m256i newlines = _mm256_set1_epi8('\n');
+
+    for(; end - p >= 32; p += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)p);
+        uint32_t newline = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newlines));
+        uint32_t fields = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, delimiters));
+
+        if(newline != 0)
+            fields &= (1u << ham_ctz(newline)) - 1;
+
+        while(fields != 0) {
+            ham_split_field(record, p + ham_ctz(fields));
+            fields &= fields - 1;
+        }
+
+        if(newline != 0)
+            return ham_split_finish(record, p + ham_ctz(newline), p + ham_ctz(newline) + 1);
+    }
+
+    return ham_split_sse2(p, end, delimiter, record);
+}
+
+static int ham_cpu_has_avx2(void) {
+#if defined(_MSC_VER)
+    int info[4];
+
+    /* AVX2 also needs the OS to save the YMM registers */
+    __cpuid(info, 1);
+    if(!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6)
+        return 0;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif /* HAM_SPLIT_X86 */
+
+static ham_split_function ham_split_selected = NULL;
+static const char *ham_split_selected_name = "scalar";
+
+static void ham_split_select(void) {
+#if defined(HAM_SPLIT_X86)
+    if(ham_cpu_has_avx2()) {
+        ham_split_selected_name = "avx2";
+        ham_split_selected = ham_split_avx2;
+    } else {
+        ham_split_selected_name = "sse2";
+        ham_split_selected = ham_split_sse2;
+    }
+#else
+    ham_split_selected_name = "scalar";
+    ham_split_selected = ham_split_scalar;
+#endif
+}
+
+const char *ham_split_record(const char *begin, const char *end, const char delimiter,
+                                ham_record *record) {
+    if(ham_split_selected == NULL)
+        ham_split_select();
+
+    record->line = begin;
+    record->num_fields = 1;
+    record->starts[0] = 0;
+
+    return ham_split_selected(begin, end, delimiter, record);
+}
+
+const char *ham_split_implementation(void) {
+    if(ham_split_selected == NULL)
+        ham_split_select();
+
+    return ham_split_selected_name;
+}
+
+int ham_split_force_implementation(const char *name) {
+    if(!strcmp(name, "scalar")) {
+        ham_split_selected_name = "scalar";
+        ham_split_selected = ham_split_scalar;
+
+        return 0;
+    }
+
+#if defined(HAM_SPLIT_X86)
+    if(!strcmp(name, "sse2")) {
+        ham_split_selected_name = "sse2";
+        ham_split_selected = ham_split_sse2;
+
+        return 0;
+    }
+
+    if(!strcmp(name, "avx2") && ham_cpu_has_avx2()) {
+        ham_split_selected_name = "avx2";
+        ham_split_selected = ham_split_avx2;
+
+        return 0;
+    }
+#endif
+
+    return -1;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_split.h
+ *
+ * Finds the record and field boundaries of the FCC files. The scan looks for the delimiter and the
+ * new line at the same time so a record is only passed over once.
+ */
+
+#ifndef _HAM_SPLIT_H_
+#define _HAM_SPLIT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* More than any FCC record has; HD has 50 */
+#define HAM_SPLIT_MAX_FIELDS 64
+
+/*
+ * A single record. Field i starts at line + starts[i] and is starts[i + 1] - starts[i] - 1 bytes
+ * long. The line does not include its line ending.
+ */
+typedef struct ham_record {
+    const char *line;
+    size_t length;
+
+    /* Number of fields found in the line, which may be more than the starts table holds */
+    int num_fields;
+    uint32_t starts[HAM_SPLIT_MAX_FIELDS + 1];
+} ham_record;
+
+/*
+ * Splits the record at begin. Returns the start of the next record, or NULL when no new line was
+ * found before end; in that case the record holds everything up to end.
+ */
+const char *ham_split_record(const char *begin, const char *end, const char delimiter,
+                                ham_record *record);
+
+/* Field helpers */
+#define ham_record_field(record, i) ((record)->line + (record)->starts[(i)])
+#define ham_record_field_length(record, i) \
+    ((size_t)((record)->starts[(i) + 1] - (record)->starts[(i)] - 1))
+
+/* Name of the implementation picked for this CPU, for diagnostics */
+const char *ham_split_implementation(void);
+
+/* Overrides the CPU dispatch ("scalar", "sse2" or "avx2"). Returns -1 if it is not available. */
+int ham_split_force_implementation(const char *name);
+
+#endif /* _HAM_SPLIT_H_ */
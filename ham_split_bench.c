@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_split_bench.c
+ *
+ * Microbenchmark of the record splitter against the old strpbrk based parser. Run it on one of the
+ * FCC files, e.g. ham_split_bench HD.dat 50
+ */
+
+#include "ham_split.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_BUFFER_SIZE 4096
+#define BENCH_ROUNDS 5
+
+/* The parser as it was before the splitter, kept here as the baseline */
+static int legacy_parse_line_with_delimiter(char **fields, const char *line, const int num_fields,
+                                            const char *delimiter) {
+    const char *begin, *end;
+    char buffer[BENCH_BUFFER_SIZE];
+    int field = 0, ctr = 0;
+
+    for(int i = 0; i < num_fields; i++)
+        memset(fields[i], '\0', BENCH_BUFFER_SIZE);
+
+    begin = line;
+
+    while(!ctr && field < num_fields) {
+        memset(buffer, '\0', sizeof(char) * BENCH_BUFFER_SIZE);
+
+        end = strpbrk(begin, delimiter);
+
+        if(end == NULL) {
+            strncpy(buffer, begin, strlen(begin));
+
+            ctr++;
+        } else {
+            strncpy(buffer, begin, (end - begin));
+            begin = end + 1;
+        }
+
+        if(strlen(buffer) == 0)
+            fields[field][0] = '\0';
+        else
+            strncpy(fields[field], buffer, strlen(buffer));
+
+        field++;
+    }
+
+    return 0;
+}
+
+static double seconds(void) {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static char *load(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    char *data;
+
+    if(file == NULL)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    *size = (size_t)ftell(file);
+    rewind(file);
+
+    data = malloc(*size + 1);
+    if(data != NULL && fread(data, 1, *size, file) != *size) {
+        free(data);
+        data = NULL;
+    }
+
+    fclose(file);
+    return data;
+}
+
+static void report(const char *name, double elapsed, size_t size, unsigned long fields) {
+    printf("%-8s %8.1f MB/s  (%lu fields)\n", name,
+            (double)size * BENCH_ROUNDS / elapsed / (1024 * 1024), fields);
+}
+
+static void bench_legacy(const char *data, size_t size, int num_fields) {
+    char **fields = malloc(sizeof(char *) * num_fields);
+    char *lines = malloc(size + 1);
+    unsigned long count = 0;
+    double start;
+
+    for(int i = 0; i < num_fields; i++)
+        fields[i] = malloc(BENCH_BUFFER_SIZE);
+
+    /* The old reader handed the parser null terminated lines; do that split outside the timing */
+    memcpy(lines, data, size);
+    lines[size] = '\0';
+    for(char *p = lines; (p = strchr(p, '\n')) != NULL; p++)
+        *p = '\0';
+
+    start = seconds();
+    for(int round = 0; round < BENCH_ROUNDS; round++) {
+        for(char *line = lines; line < lines + size; line += strlen(line) + 1) {
+            legacy_parse_line_with_delimiter(fields, line, num_fields, "|");
+            count += num_fields;
+        }
+    }
+    report("legacy", seconds() - start, size, count);
+
+    for(int i = 0; i < num_fields; i++)
+        free(fields[i]);
+    free(fields);
+    free(lines);
+}
+
+static void bench_split(const char *name, const char *data, size_t size) {
+    ham_record record;
+    const char *next;
+    unsigned long count = 0;
+    double start;
+
+    if(ham_split_force_implementation(name))
+        return;
+
+    start = seconds();
+    for(int round = 0; round < BENCH_ROUNDS; round++) {
+        for(next = data; next != NULL && next < data + size; ) {
+            next = ham_split_record(next, data + size, '|', &record);
+            count += record.num_fields;
+        }
+    }
+    report(name, seconds() - start, size, count);
+}
+
+int main(int argc, char **argv) {
+    size_t size;
+    char *data;
+    int num_fields;
+
+    if(argc < 3) {
+        printf("Usage: %s <FCC .dat file> <fields per record>\n", argv[0]);
+        return 1;
+    }
+
+    data = load(argv[1], &size);
+    if(data == NULL) {
+        printf("Error: failed to read %s\n", argv[1]);
+        return 1;
+    }
+
+    num_fields = atoi(argv[2]);
+    if(num_fields <= 0 || num_fields > HAM_SPLIT_MAX_FIELDS) {
+        printf("Error: fields per record must be between 1 and %d\n", HAM_SPLIT_MAX_FIELDS);
+        return 1;
+    }
+
+    printf("%s: %zu bytes, %d rounds, dispatch picks %s\n", argv[1], size, BENCH_ROUNDS,
+            ham_split_implementation());
+
+    bench_legacy(data, size, num_fields);
+    bench_split("scalar", data, size);
+    bench_split("sse2", data, size);
+    bench_split("avx2", data, size);
+
+    free(data);
+    return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_tar.c
+ */
+
+#include "ham_tar.h"
+
+#include <string.h>
+
+/* Header fields */
+#define HAM_TAR_NAME 0
+#define HAM_TAR_NAME_SIZE 100
+#define HAM_TAR_SIZE 124
+#define HAM_TAR_SIZE_SIZE 12
+#define HAM_TAR_TYPE 156
+#define HAM_TAR_MAGIC 257
+
+/* Entry types that hold a file's data */
+#define HAM_TAR_TYPE_FILE '0'
+#define HAM_TAR_TYPE_OLD_FILE '\0'
+
+/* Reads exactly size bytes unless the stream ends; returns the count or -1 */
+static INT64 ham_tar_fill(ham_tar *tar, char *buffer, size_t size) {
+    size_t total = 0;
+    INT64 count;
+
+    if(tar->peek_begin < tar->peek_end) {
+        total = tar->peek_end - tar->peek_begin < size ? tar->peek_end - tar->peek_begin : size;
+        memcpy(buffer, tar->peek + tar->peek_begin, total);
+        tar->peek_begin += total;
+    }
+
+    while(total < size) {
+        count = tar->read(tar->context, buffer + total, size - total);
+        if(count < 0)
+            return -1;
+        if(count == 0)
+            break;
+
+        total += (size_t)count;
+    }
+
+    return (INT64)total;
+}
+
+/* Octal, or base 256 with the high bit set for sizes that do not fit in 11 octal digits */
+static INT64 ham_tar_size(const unsigned char *field) {
+    INT64 size = 0;
+
+    if(field[0] & 0x80) {
+        for(int i = 1; i < HAM_TAR_SIZE_SIZE; i++)
+            size = size << 8 | field[i];
+
+        return size;
+    }
+
+    for(int i = 0; i < HAM_TAR_SIZE_SIZE && field[i] >= '0' && field[i] <= '7'; i++)
+        size = size * 8 + (field[i] - '0');
+
+    return size;
+}
+
+static int ham_tar_skip(ham_tar *tar, INT64 bytes) {
+    char buffer[HAM_TAR_BLOCK];
+
+    while(bytes > 0) {
+        size_t length = bytes < HAM_TAR_BLOCK ? (size_t)bytes : HAM_TAR_BLOCK;
+
+        if(ham_tar_fill(tar, buffer, length) != (INT64)length)
+            return HAM_ERROR_BAD_ARCHIVE;
+
+        bytes -= length;
+    }
+
+    return HAM_OK;
+}
+
+void ham_tar_init(ham_tar *tar, ham_fcc_read_callback read, void *context) {
+    memset(tar, 0, sizeof(ham_tar));
+
+    tar->read = read;
+    tar->context = context;
+}
+
+int ham_tar_detect(ham_tar *tar, int *is_tar) {
+    INT64 count = ham_tar_fill(tar, tar->peek, HAM_TAR_BLOCK);
+
+    if(count < 0)
+        return HAM_ERROR_GENERIC;
+
+    tar->peek_begin = 0;
+    tar->peek_end = (size_t)count;
+
+    *is_tar = count == HAM_TAR_BLOCK && !memcmp(tar->peek + HAM_TAR_MAGIC, "ustar", 5);
+
+    return HAM_OK;
+}
+
+int ham_tar_next(ham_tar *tar, char *name, const size_t name_size, INT64 *size) {
+    unsigned char header[HAM_TAR_BLOCK];
+    const char *base;
+    char path[HAM_TAR_NAME_SIZE + 1];
+    int error;
+
+    name[0] = '\0';
+    *size = 0;
+
+    for(;;) {
+        error = ham_tar_skip(tar, tar->remaining + tar->padding);
+        if(error != HAM_OK)
+            return error;
+
+        tar->remaining = 0;
+        tar->padding = 0;
+
+        /* A stream that just stops is taken as the end too */
+        if(ham_tar_fill(tar, (char *)header, HAM_TAR_BLOCK) != HAM_TAR_BLOCK)
+            return HAM_OK;
+
+        /* The archive ends with zero blocks */
+        if(header[HAM_TAR_NAME] == '\0')
+            return HAM_OK;
+
+        tar->remaining = ham_tar_size(header + HAM_TAR_SIZE);
+        tar->padding = (HAM_TAR_BLOCK - tar->remaining % HAM_TAR_BLOCK) % HAM_TAR_BLOCK;
+
+        /* Directories, links and extended headers are passed over */
+        if(header[HAM_TAR_TYPE] != HAM_TAR_TYPE_FILE
+                && header[HAM_TAR_TYPE] != HAM_TAR_TYPE_OLD_FILE)
+            continue;
+
+        memcpy(path, header + HAM_TAR_NAME, HAM_TAR_NAME_SIZE);
+        path[HAM_TAR_NAME_SIZE] = '\0';
+
+        base = strrchr(path, '/');
+        base = base != NULL ? base + 1 : path;
+
+        strncpy(name, base, name_size - 1);
+        name[name_size - 1] = '\0';
+        *size = tar->remaining;
+
+        return HAM_OK;
+    }
+}
+
+INT64 ham_tar_read_entry(void *argument, char *buffer, size_t size) {
+    ham_tar *tar = argument;
+    INT64 count;
+
+    if((INT64)size > tar->remaining)
+        size = (size_t)tar->remaining;
+
+    if(size == 0)
+        return 0;
+
+    count = ham_tar_fill(tar, buffer, size);
+    if(count != (INT64)size)
+        return -1;
+
+    tar->remaining -= count;
+
+    return count;
+}
+
+INT64 ham_tar_read_stream(void *argument, char *buffer, size_t size) {
+    return ham_tar_fill(argument, buffer, size);
+}
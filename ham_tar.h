@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_tar.h
+ *
+ * Reads a tar archive front to back from a read callback, so the FCC files can be converted as
+ * they come out of a pipe. Nothing is seeked and only one block is held at a time.
+ */
+
+#ifndef _HAM_TAR_H_
+#define _HAM_TAR_H_
+
+#include "libhamdata.h"
+
+#define HAM_TAR_BLOCK 512
+
+typedef struct ham_tar {
+    ham_fcc_read_callback read;
+    void *context;
+
+    /* Bytes read ahead to tell whether the stream is a tar archive; handed out again first */
+    char peek[HAM_TAR_BLOCK];
+    size_t peek_begin;
+    size_t peek_end;
+
+    /* Data bytes of the current entry not read yet, and the padding after them */
+    INT64 remaining;
+    INT64 padding;
+} ham_tar;
+
+void ham_tar_init(ham_tar *tar, ham_fcc_read_callback read, void *context);
+
+/* Reads the first block and checks for the ustar magic. The block is not lost either way. */
+int ham_tar_detect(ham_tar *tar, int *is_tar);
+
+/*
+ * Skips whatever is left of the current entry and reads the next header. Only the file name is
+ * kept, without its directory. At the end of the archive name is set to the empty string.
+ */
+int ham_tar_next(ham_tar *tar, char *name, const size_t name_size, INT64 *size);
+
+/* ham_fcc_read_callback over the data of the current entry */
+INT64 ham_tar_read_entry(void *tar, char *buffer, size_t size);
+
+/* ham_fcc_read_callback over the whole stream, for input that turned out not to be tar */
+INT64 ham_tar_read_stream(void *tar, char *buffer, size_t size);
+
+#endif /* _HAM_TAR_H_ */
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_thread.c
+ */
+
+#include "ham_thread.h"
+
+#include <stdlib.h>
+
+#if defined(OS_WIN)
+    #include <process.h>
+#else
+    #include <sched.h>
+    #include <time.h>
+    #include <unistd.h>
+#endif
+
+/* The platform thread signatures differ, so every thread starts in this trampoline */
+typedef struct ham_thread_start {
+    ham_thread_function function;
+    void *argument;
+} ham_thread_start;
+
+#if defined(OS_WIN)
+static unsigned __stdcall ham_thread_main(void *data) {
+#else
+static void *ham_thread_main(void *data) {
+#endif
+    ham_thread_start start = *(ham_thread_start *)data;
+
+    free(data);
+    start.function(start.argument);
+
+    return 0;
+}
+
+int ham_thread_create(ham_thread *thread, ham_thread_function function, void *argument) {
+    ham_thread_start *start = malloc(sizeof(ham_thread_start));
+    if(start == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    start->function = function;
+    start->argument = argument;
+
+#if defined(OS_WIN)
+    *thread = (HANDLE)_beginthreadex(NULL, 0, ham_thread_main, start, 0, NULL);
+    if(*thread == 0) {
+#else
+    if(pthread_create(thread, NULL, ham_thread_main, start)) {
+#endif
+        free(start);
+        return HAM_ERROR_GENERIC;
+    }
+
+    return HAM_OK;
+}
+
+void ham_thread_join(ham_thread thread) {
+#if defined(OS_WIN)
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+void ham_mutex_init(ham_mutex *mutex) {
+#if defined(OS_WIN)
+    InitializeCriticalSection(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+void ham_mutex_destroy(ham_mutex *mutex) {
+#if defined(OS_WIN)
+    DeleteCriticalSection(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+void ham_mutex_lock(ham_mutex *mutex) {
+#if defined(OS_WIN)
+    EnterCriticalSection(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+void ham_mutex_unlock(ham_mutex *mutex) {
+#if defined(OS_WIN)
+    LeaveCriticalSection(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+void ham_thread_yield(void) {
+#if defined(OS_WIN)
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+void ham_thread_sleep(unsigned int microseconds) {
+#if defined(OS_WIN)
+    Sleep(microseconds < 1000 ? 1 : microseconds / 1000);
+#else
+    struct timespec delay;
+
+    delay.tv_sec = microseconds / 1000000;
+    delay.tv_nsec = (long)(microseconds % 1000000) * 1000;
+    nanosleep(&delay, NULL);
+#endif
+}
+
+int ham_cpu_count(void) {
+#if defined(OS_WIN)
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return count > 0 ? (int)count : 1;
+#endif
+}
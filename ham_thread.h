@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_thread.h
+ *
+ * Thin wrappers over the platform threads so the conversion code does not need to care whether it
+ * runs on pthreads or Windows.
+ */
+
+#ifndef _HAM_THREAD_H_
+#define _HAM_THREAD_H_
+
+#include "libhamdata.h"
+
+#if defined(OS_WIN)
+    #include <windows.h>
+
+    typedef HANDLE ham_thread;
+    typedef CRITICAL_SECTION ham_mutex;
+#else
+    #include <pthread.h>
+
+    typedef pthread_t ham_thread;
+    typedef pthread_mutex_t ham_mutex;
+#endif
+
+typedef void (*ham_thread_function)(void *argument);
+
+/* Returns HAM_OK or HAM_ERROR_GENERIC if the thread could not be started */
+int ham_thread_create(ham_thread *thread, ham_thread_function function, void *argument);
+void ham_thread_join(ham_thread thread);
+
+void ham_mutex_init(ham_mutex *mutex);
+void ham_mutex_destroy(ham_mutex *mutex);
+void ham_mutex_lock(ham_mutex *mutex);
+void ham_mutex_unlock(ham_mutex *mutex);
+
+/* Gives up the rest of the time slice, or sleeps for a number of microseconds */
+void ham_thread_yield(void);
+void ham_thread_sleep(unsigned int microseconds);
+
+/* Number of online processors, at least 1 */
+int ham_cpu_count(void);
+
+#endif /* _HAM_THREAD_H_ */
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_value.c
+ */
+
+#include "ham_value.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define HAM_VALUE_MAX_DIGITS 18
+
+/*
+ * Eight characters as a word, the first one in the lowest byte whatever the byte order. Compilers
+ * turn this into a single load on little endian machines.
+ */
+static uint64_t ham_value_load8(const char *data) {
+    uint64_t word = 0;
+
+    for(int i = 0; i < 8; i++)
+        word |= (uint64_t)(unsigned char)data[i] << (8 * i);
+
+    return word;
+}
+
+/* Whether all eight bytes are '0' to '9': the high nibbles are 3, and adding 6 does not carry */
+static int ham_value_digits8(const uint64_t word) {
+    return ((word & 0xF0F0F0F0F0F0F0F0ULL)
+            | (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+            == 0x3333333333333333ULL;
+}
+
+/* Converts eight digits by combining neighbouring pairs, then pairs of pairs, and so on */
+static uint32_t ham_value_parse8(uint64_t word) {
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 100 + (1000000ULL << 32);
+    const uint64_t mul2 = 1 + (10000ULL << 32);
+
+    word -= 0x3030303030303030ULL;
+    word = (word * 10) + (word >> 8);
+    word = (((word & mask) * mul1) + (((word >> 16) & mask) * mul2)) >> 32;
+
+    return (uint32_t)word;
+}
+
+int ham_parse_int64(const char *data, size_t length, INT64 *value) {
+    char digits[24];
+    size_t padded;
+    uint64_t word;
+    INT64 result = 0;
+
+    if(length == 0 || length > HAM_VALUE_MAX_DIGITS)
+        return HAM_ERROR_GENERIC;
+
+    /* Zeros in front make the digits a whole number of words */
+    padded = (length + 7) & ~(size_t)7;
+    memset(digits, '0', padded - length);
+    memcpy(digits + padded - length, data, length);
+
+    for(size_t i = 0; i < padded; i += 8) {
+        word = ham_value_load8(digits + i);
+        if(!ham_value_digits8(word))
+            return HAM_ERROR_GENERIC;
+
+        result = result * 100000000 + ham_value_parse8(word);
+    }
+
+    *value = result;
+
+    return HAM_OK;
+}
+
+int ham_parse_date(const char *data, size_t length, INT64 *value) {
+    char digits[8];
+    uint64_t word;
+    uint32_t date, month, day;
+
+    if(length != 10 || data[2] != '/' || data[5] != '/')
+        return HAM_ERROR_GENERIC;
+
+    /* Reordered to YYYYMMDD, so one conversion gives the sortable value */
+    memcpy(digits, data + 6, 4);
+    memcpy(digits + 4, data, 2);
+    memcpy(digits + 6, data + 3, 2);
+
+    word = ham_value_load8(digits);
+    if(!ham_value_digits8(word))
+        return HAM_ERROR_GENERIC;
+
+    date = ham_value_parse8(word);
+    month = date / 100 % 100;
+    day = date % 100;
+
+    if(month < 1 || month > 12 || day < 1 || day > 31)
+        return HAM_ERROR_GENERIC;
+
+    *value = date;
+
+    return HAM_OK;
+}
+
+/*
+ * Counts from a year that starts in March, so the leap day is the last day of its year, and in
+ * 400 year eras, which all have the same number of days.
+ */
+INT64 ham_date_days(INT64 date) {
+    INT64 year = date / 10000, month = date / 100 % 100, day = date % 100;
+    INT64 era, year_of_era, day_of_year;
+
+    if(month <= 2)
+        year--;
+
+    era = (year >= 0 ? year : year - 399) / 400;
+    year_of_era = year - era * 400;
+    day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+
+    return era * 146097 + year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year
+            - 719468;
+}
+
+int ham_parse_callsign(const char *data, size_t length, ham_callsign *callsign) {
+    size_t prefix = 0, suffix;
+
+    while(prefix < length && data[prefix] >= 'A' && data[prefix] <= 'Z')
+        prefix++;
+
+    if(prefix < 1 || prefix > 2 || prefix == length || data[prefix] < '0' || data[prefix] > '9')
+        return HAM_ERROR_GENERIC;
+
+    suffix = length - prefix - 1;
+    if(suffix < 1 || suffix > 3)
+        return HAM_ERROR_GENERIC;
+
+    for(size_t i = prefix + 1; i < length; i++) {
+        if(data[i] < 'A' || data[i] > 'Z')
+            return HAM_ERROR_GENERIC;
+    }
+
+    callsign->prefix_length = prefix;
+    callsign->area = data[prefix] - '0';
+    callsign->suffix_offset = prefix + 1;
+    callsign->suffix_length = suffix;
+
+    return HAM_OK;
+}
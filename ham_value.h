@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_value.h
+ *
+ * Parsers for the typed columns of the FCC files. Digits are checked and converted eight at a time
+ * in a 64 bit word instead of one character at a time.
+ */
+
+#ifndef _HAM_VALUE_H_
+#define _HAM_VALUE_H_
+
+#include "libhamdata.h"
+
+#include <stddef.h>
+
+/* Column types, one letter per field in the column type maps */
+#define HAM_VALUE_TEXT 'T'
+#define HAM_VALUE_INTEGER 'I'
+#define HAM_VALUE_DATE 'D'
+#define HAM_VALUE_CODE 'C'
+
+/* Parses up to 18 decimal digits. HAM_ERROR_GENERIC if the field is anything else. */
+int ham_parse_int64(const char *data, size_t length, INT64 *value);
+
+/*
+ * Parses an FCC date, MM/DD/YYYY, into the integer YYYYMMDD, which sorts the same way as the date.
+ * HAM_ERROR_GENERIC if the field is not a valid date.
+ */
+int ham_parse_date(const char *data, size_t length, INT64 *value);
+
+/* Days from 1970-01-01 to a YYYYMMDD date, negative for dates before it */
+INT64 ham_date_days(INT64 date);
+
+/* A callsign split into its prefix letters, call area digit and suffix letters */
+typedef struct ham_callsign {
+    size_t prefix_length;
+    int area;
+    size_t suffix_offset;
+    size_t suffix_length;
+} ham_callsign;
+
+/*
+ * Splits a callsign of the US pattern, one or two letters, a digit and one to three letters, e.g.
+ * KH6ABC into KH, 6 and ABC. HAM_ERROR_GENERIC for any other callsign.
+ */
+int ham_parse_callsign(const char *data, size_t length, ham_callsign *callsign);
+
+#endif /* _HAM_VALUE_H_ */
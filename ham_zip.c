@@ -0,0 +1,465 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_zip.c
+ */
+
+#include "ham_zip.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAM_HAVE_ZLIB)
+    #include <zlib.h>
+#endif
+
+#if defined(OS_WIN)
+    #define ham_zip_seek _fseeki64
+    #define ham_zip_tell _ftelli64
+#else
+    #define ham_zip_seek fseeko
+    #define ham_zip_tell ftello
+#endif
+
+/* Record signatures */
+#define HAM_ZIP_LOCAL_HEADER 0x04034b50
+#define HAM_ZIP_CENTRAL_HEADER 0x02014b50
+#define HAM_ZIP_END_OF_DIRECTORY 0x06054b50
+
+/* Fixed part of each record */
+#define HAM_ZIP_LOCAL_HEADER_SIZE 30
+#define HAM_ZIP_CENTRAL_HEADER_SIZE 46
+#define HAM_ZIP_END_OF_DIRECTORY_SIZE 22
+
+/* The end of directory record can be followed by a comment of up to 64KB */
+#define HAM_ZIP_MAX_COMMENT 0xffff
+
+/* Extra field holding the real sizes and offset when they do not fit in 32 bits */
+#define HAM_ZIP_ZIP64_EXTRA 0x0001
+#define HAM_ZIP_ZIP64_MARKER 0xffffffff
+
+/* Compressed bytes read from the archive at a time */
+#define HAM_ZIP_INPUT_SIZE (256 * 1024)
+
+struct ham_zip_stream {
+    FILE *file;
+    ham_zip_member member;
+
+    /* Offset of the member's data, past the local header */
+    INT64 data_offset;
+
+    /* Compressed bytes not read from the archive yet */
+    INT64 remaining;
+
+    uint32_t crc;
+    int done;
+
+    /* Set for deflated members */
+    int inflating;
+
+#if defined(HAM_HAVE_ZLIB)
+    z_stream inflate;
+    unsigned char *input;
+#endif
+};
+
+static uint16_t ham_zip_u16(const unsigned char *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t ham_zip_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t ham_zip_u64(const unsigned char *p) {
+    return (uint64_t)ham_zip_u32(p) | (uint64_t)ham_zip_u32(p + 4) << 32;
+}
+
+/* Replaces the sizes and offset that were too large for the header with the zip64 values */
+static void ham_zip_read_zip64(ham_zip_member *member, const unsigned char *extra, size_t length) {
+    size_t id, size, field = 0;
+
+    while(length >= 4) {
+        id = ham_zip_u16(extra);
+        size = ham_zip_u16(extra + 2);
+        if(size > length - 4)
+            return;
+
+        if(id == HAM_ZIP_ZIP64_EXTRA) {
+            /* Only the values marked in the header are present, in this order */
+            if(member->size == HAM_ZIP_ZIP64_MARKER && field + 8 <= size) {
+                member->size = (INT64)ham_zip_u64(extra + 4 + field);
+                field += 8;
+            }
+            if(member->compressed_size == HAM_ZIP_ZIP64_MARKER && field + 8 <= size) {
+                member->compressed_size = (INT64)ham_zip_u64(extra + 4 + field);
+                field += 8;
+            }
+            if(member->offset == HAM_ZIP_ZIP64_MARKER && field + 8 <= size)
+                member->offset = (INT64)ham_zip_u64(extra + 4 + field);
+
+            return;
+        }
+
+        extra += 4 + size;
+        length -= 4 + size;
+    }
+}
+
+/* Finds the end of directory record, which is at the end of the file ahead of the comment */
+static int ham_zip_find_end(FILE *file, unsigned char *record) {
+    unsigned char *tail;
+    INT64 size, length;
+    int error = HAM_ERROR_BAD_ARCHIVE;
+
+    if(ham_zip_seek(file, 0, SEEK_END))
+        return HAM_ERROR_BAD_ARCHIVE;
+
+    size = ham_zip_tell(file);
+    if(size < HAM_ZIP_END_OF_DIRECTORY_SIZE)
+        return HAM_ERROR_BAD_ARCHIVE;
+
+    length = size < HAM_ZIP_END_OF_DIRECTORY_SIZE + HAM_ZIP_MAX_COMMENT ?
+                size : HAM_ZIP_END_OF_DIRECTORY_SIZE + HAM_ZIP_MAX_COMMENT;
+
+    tail = malloc((size_t)length);
+    if(tail == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    if(ham_zip_seek(file, size - length, SEEK_SET)
+            || fread(tail, 1, (size_t)length, file) != (size_t)length) {
+        free(tail);
+        return HAM_ERROR_BAD_ARCHIVE;
+    }
+
+    for(INT64 i = length - HAM_ZIP_END_OF_DIRECTORY_SIZE; i >= 0; i--) {
+        if(ham_zip_u32(tail + i) == HAM_ZIP_END_OF_DIRECTORY) {
+            memcpy(record, tail + i, HAM_ZIP_END_OF_DIRECTORY_SIZE);
+            error = HAM_OK;
+            break;
+        }
+    }
+
+    free(tail);
+    return error;
+}
+
+/* Fills in the members from the central directory */
+static int ham_zip_read_directory(ham_zip *zip, const unsigned char *entry, size_t remaining,
+                                    const int count) {
+    size_t name_length, extra_length, comment_length, length;
+
+    for(int i = 0; i < count; i++) {
+        ham_zip_member *member = &zip->members[zip->num_members];
+
+        if(remaining < HAM_ZIP_CENTRAL_HEADER_SIZE || ham_zip_u32(entry) != HAM_ZIP_CENTRAL_HEADER)
+            return HAM_ERROR_BAD_ARCHIVE;
+
+        name_length = ham_zip_u16(entry + 28);
+        extra_length = ham_zip_u16(entry + 30);
+        comment_length = ham_zip_u16(entry + 32);
+        length = HAM_ZIP_CENTRAL_HEADER_SIZE + name_length + extra_length + comment_length;
+
+        if(remaining < length)
+            return HAM_ERROR_BAD_ARCHIVE;
+
+        member->method = ham_zip_u16(entry + 10);
+        member->crc = ham_zip_u32(entry + 16);
+        member->compressed_size = ham_zip_u32(entry + 20);
+        member->size = ham_zip_u32(entry + 24);
+        member->offset = ham_zip_u32(entry + 42);
+
+        ham_zip_read_zip64(member, entry + HAM_ZIP_CENTRAL_HEADER_SIZE + name_length,
+                            extra_length);
+
+        /* Names that do not fit cannot be one of ours; skip them */
+        if(name_length < HAM_ZIP_NAME_SIZE) {
+            memcpy(member->name, entry + HAM_ZIP_CENTRAL_HEADER_SIZE, name_length);
+            member->name[name_length] = '\0';
+            zip->num_members++;
+        }
+
+        entry += length;
+        remaining -= length;
+    }
+
+    return HAM_OK;
+}
+
+int ham_zip_open(ham_zip *zip, const char *path) {
+    unsigned char end[HAM_ZIP_END_OF_DIRECTORY_SIZE];
+    unsigned char *directory;
+    size_t directory_size;
+    int count, error;
+    FILE *file;
+
+    memset(zip, 0, sizeof(ham_zip));
+
+    file = fopen(path, "rb");
+    if(file == NULL)
+        return HAM_ERROR_OPEN_FILE;
+
+    error = ham_zip_find_end(file, end);
+    if(error != HAM_OK) {
+        fclose(file);
+        return error;
+    }
+
+    count = ham_zip_u16(end + 10);
+    directory_size = ham_zip_u32(end + 12);
+
+    directory = malloc(directory_size ? directory_size : 1);
+    zip->members = calloc(count ? count : 1, sizeof(ham_zip_member));
+
+    if(directory == NULL || zip->members == NULL)
+        error = HAM_ERROR_MALLOC_FAIL;
+    else if(ham_zip_seek(file, (INT64)ham_zip_u32(end + 16), SEEK_SET)
+            || fread(directory, 1, directory_size, file) != directory_size)
+        error = HAM_ERROR_BAD_ARCHIVE;
+    else
+        error = ham_zip_read_directory(zip, directory, directory_size, count);
+
+    free(directory);
+    fclose(file);
+
+    if(error != HAM_OK)
+        ham_zip_close(zip);
+
+    return error;
+}
+
+void ham_zip_close(ham_zip *zip) {
+    free(zip->members);
+    zip->members = NULL;
+    zip->num_members = 0;
+}
+
+const ham_zip_member *ham_zip_find(const ham_zip *zip, const char *name) {
+    for(int i = 0; i < zip->num_members; i++) {
+        const char *base = zip->members[i].name;
+        const char *slash = strrchr(base, '/');
+        size_t j;
+
+        if(slash != NULL)
+            base = slash + 1;
+
+        for(j = 0; name[j] != '\0' && tolower((unsigned char)name[j]) ==
+                tolower((unsigned char)base[j]); j++)
+            ;
+
+        if(name[j] == '\0' && base[j] == '\0')
+            return &zip->members[i];
+    }
+
+    return NULL;
+}
+
+int ham_zip_stream_open(ham_zip_stream **stream, const char *path, const ham_zip_member *member) {
+    unsigned char header[HAM_ZIP_LOCAL_HEADER_SIZE];
+    ham_zip_stream *result;
+
+#if !defined(HAM_HAVE_ZLIB)
+    /* Without zlib only stored members can be read */
+    if(member->method != HAM_ZIP_STORED)
+        return HAM_ERROR_BAD_ARCHIVE;
+#else
+    if(member->method != HAM_ZIP_STORED && member->method != HAM_ZIP_DEFLATED)
+        return HAM_ERROR_BAD_ARCHIVE;
+#endif
+
+    result = calloc(1, sizeof(ham_zip_stream));
+    if(result == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    result->member = *member;
+
+    result->file = fopen(path, "rb");
+    if(result->file == NULL) {
+        free(result);
+        return HAM_ERROR_OPEN_FILE;
+    }
+
+    /* The local header repeats the name but may have a different extra field */
+    if(ham_zip_seek(result->file, member->offset, SEEK_SET)
+            || fread(header, 1, HAM_ZIP_LOCAL_HEADER_SIZE, result->file) != sizeof(header)
+            || ham_zip_u32(header) != HAM_ZIP_LOCAL_HEADER) {
+        ham_zip_stream_close(result);
+        return HAM_ERROR_BAD_ARCHIVE;
+    }
+
+    result->data_offset = member->offset + HAM_ZIP_LOCAL_HEADER_SIZE + ham_zip_u16(header + 26)
+                            + ham_zip_u16(header + 28);
+
+#if defined(HAM_HAVE_ZLIB)
+    if(member->method == HAM_ZIP_DEFLATED) {
+        result->input = malloc(HAM_ZIP_INPUT_SIZE);
+        if(result->input == NULL) {
+            ham_zip_stream_close(result);
+            return HAM_ERROR_MALLOC_FAIL;
+        }
+
+        /* Raw deflate; zip has its own headers */
+        if(inflateInit2(&result->inflate, -MAX_WBITS) != Z_OK) {
+            ham_zip_stream_close(result);
+            return HAM_ERROR_MALLOC_FAIL;
+        }
+
+        result->inflating = HAM_BOOL_YES;
+    }
+#endif
+
+    if(ham_zip_stream_rewind(result) != HAM_OK) {
+        ham_zip_stream_close(result);
+        return HAM_ERROR_BAD_ARCHIVE;
+    }
+
+    *stream = result;
+
+    return HAM_OK;
+}
+
+void ham_zip_stream_close(ham_zip_stream *stream) {
+    if(stream == NULL)
+        return;
+
+#if defined(HAM_HAVE_ZLIB)
+    if(stream->inflating == HAM_BOOL_YES)
+        inflateEnd(&stream->inflate);
+    free(stream->input);
+#endif
+
+    if(stream->file != NULL)
+        fclose(stream->file);
+
+    free(stream);
+}
+
+int ham_zip_stream_rewind(ham_zip_stream *stream) {
+    if(ham_zip_seek(stream->file, stream->data_offset, SEEK_SET))
+        return HAM_ERROR_GENERIC;
+
+    stream->remaining = stream->member.compressed_size;
+    stream->crc = 0;
+    stream->done = HAM_BOOL_NO;
+
+#if defined(HAM_HAVE_ZLIB)
+    if(stream->inflating == HAM_BOOL_YES) {
+        if(inflateReset(&stream->inflate) != Z_OK)
+            return HAM_ERROR_GENERIC;
+
+        stream->inflate.next_in = stream->input;
+        stream->inflate.avail_in = 0;
+    }
+#endif
+
+    return HAM_OK;
+}
+
+static uint32_t ham_zip_crc(uint32_t crc, const char *data, size_t size) {
+#if defined(HAM_HAVE_ZLIB)
+    while(size > 0) {
+        uInt length = size > 0x40000000 ? 0x40000000 : (uInt)size;
+
+        crc = (uint32_t)crc32(crc, (const Bytef *)data, length);
+        data += length;
+        size -= length;
+    }
+#else
+    /* Plain bitwise CRC-32; slow, but only stored members get here */
+    crc = ~crc;
+    for(size_t i = 0; i < size; i++) {
+        crc ^= (unsigned char)data[i];
+        for(int bit = 0; bit < 8; bit++)
+            crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+    }
+    crc = ~crc;
+#endif
+
+    return crc;
+}
+
+static int ham_zip_read_stored(ham_zip_stream *stream, char *buffer, size_t size, size_t *read) {
+    if((INT64)size > stream->remaining)
+        size = (size_t)stream->remaining;
+
+    *read = fread(buffer, 1, size, stream->file);
+    stream->remaining -= *read;
+
+    return *read == size ? HAM_OK : HAM_ERROR_BAD_ARCHIVE;
+}
+
+#if defined(HAM_HAVE_ZLIB)
+static int ham_zip_read_deflated(ham_zip_stream *stream, char *buffer, size_t size,
+                                    size_t *read) {
+    z_stream *inflate_stream = &stream->inflate;
+    int rc;
+
+    *read = 0;
+
+    while(*read < size) {
+        if(inflate_stream->avail_in == 0 && stream->remaining > 0) {
+            size_t length = stream->remaining < HAM_ZIP_INPUT_SIZE ?
+                                (size_t)stream->remaining : HAM_ZIP_INPUT_SIZE;
+
+            if(fread(stream->input, 1, length, stream->file) != length)
+                return HAM_ERROR_BAD_ARCHIVE;
+
+            stream->remaining -= length;
+            inflate_stream->next_in = stream->input;
+            inflate_stream->avail_in = (uInt)length;
+        }
+
+        inflate_stream->next_out = (Bytef *)buffer + *read;
+        inflate_stream->avail_out = size - *read > 0x40000000 ? 0x40000000 : (uInt)(size - *read);
+
+        rc = inflate(inflate_stream, Z_NO_FLUSH);
+        *read = (size_t)((char *)inflate_stream->next_out - buffer);
+
+        if(rc == Z_STREAM_END) {
+            stream->done = HAM_BOOL_YES;
+            break;
+        }
+
+        /* Including Z_BUF_ERROR, which here means the member ended early */
+        if(rc != Z_OK)
+            return HAM_ERROR_BAD_ARCHIVE;
+    }
+
+    return HAM_OK;
+}
+#endif
+
+int ham_zip_stream_read(ham_zip_stream *stream, char *buffer, size_t size, size_t *read) {
+    int error;
+
+    *read = 0;
+
+    if(stream->done == HAM_BOOL_YES)
+        return HAM_OK;
+
+#if defined(HAM_HAVE_ZLIB)
+    if(stream->inflating == HAM_BOOL_YES)
+        error = ham_zip_read_deflated(stream, buffer, size, read);
+    else
+#endif
+    error = ham_zip_read_stored(stream, buffer, size, read);
+
+    if(error != HAM_OK)
+        return error;
+
+    stream->crc = ham_zip_crc(stream->crc, buffer, *read);
+
+    if(stream->inflating != HAM_BOOL_YES && stream->remaining == 0)
+        stream->done = HAM_BOOL_YES;
+
+    if(stream->done == HAM_BOOL_YES && stream->crc != stream->member.crc)
+        return HAM_ERROR_BAD_ARCHIVE;
+
+    return HAM_OK;
+}
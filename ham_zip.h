@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2016 Kevin Cotugno
+ * All rights reserved
+ *
+ * Distributed under the terms of the MIT software license. See the
+ * accompanying LICENSE file or http://www.opensource.org/licenses/MIT.
+ *
+ * libhamdata: ham_zip.h
+ *
+ * Just enough of the zip format to read the FCC archives in place. The central directory is read to
+ * find the members, and each member is inflated as it is read, so nothing is extracted to disk.
+ */
+
+#ifndef _HAM_ZIP_H_
+#define _HAM_ZIP_H_
+
+#include "libhamdata.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HAM_ZIP_NAME_SIZE 256
+
+/* Compression methods we can read */
+#define HAM_ZIP_STORED 0
+#define HAM_ZIP_DEFLATED 8
+
+typedef struct ham_zip_member {
+    char name[HAM_ZIP_NAME_SIZE];
+    int method;
+    uint32_t crc;
+
+    /* Offset of the member's local header in the archive */
+    INT64 offset;
+
+    INT64 compressed_size;
+    INT64 size;
+} ham_zip_member;
+
+typedef struct ham_zip {
+    int num_members;
+    ham_zip_member *members;
+} ham_zip;
+
+/* A member being read. Each has its own handle on the archive, so several can be read at once. */
+typedef struct ham_zip_stream ham_zip_stream;
+
+/* Reads the central directory. HAM_ERROR_BAD_ARCHIVE means it is not a zip we can read. */
+int ham_zip_open(ham_zip *zip, const char *path);
+void ham_zip_close(ham_zip *zip);
+
+/* Finds a member by name, ignoring case and any directory in the archive. NULL if it is missing. */
+const ham_zip_member *ham_zip_find(const ham_zip *zip, const char *name);
+
+int ham_zip_stream_open(ham_zip_stream **stream, const char *path, const ham_zip_member *member);
+void ham_zip_stream_close(ham_zip_stream *stream);
+
+/*
+ * Reads up to size bytes of the member. Fewer are only returned at the end of the member, where the
+ * checksum is also verified.
+ */
+int ham_zip_stream_read(ham_zip_stream *stream, char *buffer, size_t size, size_t *read);
+
+/* Starts the member over from the beginning */
+int ham_zip_stream_rewind(ham_zip_stream *stream);
+
+#endif /* _HAM_ZIP_H_ */
@@ -12,20 +12,73 @@
  */
 
 #include "libhamdata.h"
+#include "ham_columns.h"
+#include "ham_dict.h"
+#include "ham_index.h"
+#include "ham_map.h"
+#include "ham_ring.h"
+#include "ham_split.h"
+#include "ham_tar.h"
+#include "ham_thread.h"
+#include "ham_value.h"
+#include "ham_zip.h"
 #include "sqlite3.h"
 
+#include <ctype.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 #include <time.h>
 
+#if defined(OS_GENERIC)
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#if defined(OS_WIN)
+#include <psapi.h>
+#endif
+
 /* FCC row delimiter */
-#define HAM_DELIMITER "|"
+#define HAM_DELIMITER '|'
 
 #define HAM_NULL_CHAR '\0'
 
-#define HAM_BUFFER_SIZE 4096
+/* Size of the read buffer used when a file cannot be memory mapped */
+#define HAM_READ_BUFFER_SIZE (1024 * 1024)
+
+/* Bytes the pipeline reader hands a parser at a time, unless the options say otherwise */
+#define HAM_CHUNK_SIZE (256 * 1024)
+
+/* Smallest chunk the options may ask for */
+#define HAM_MIN_CHUNK_SIZE (4 * 1024)
+
+/* Chunks each parser may have in flight; the reader blocks once they are all taken */
+#define HAM_PIPELINE_DEPTH 4
+
+/* Page cache in KiB while the indexes are built, so the sorts stay in memory */
+#define HAM_INDEX_CACHE_SIZE (256 * 1024)
+
+/* Defaults of the SQLite settings in the conversion options */
+#define HAM_PAGE_SIZE 4096
+#define HAM_CACHE_SIZE (64 * 1024)
+#define HAM_MMAP_SIZE 0
+#define HAM_JOURNAL_MODE "MEMORY"
+#define HAM_SYNCHRONOUS "OFF"
+
+/*
+ * Shares of a memory budget, in eighths. The page cache while loading, and while the indexes are
+ * built, when the sorts take as much again; SQLite starts freeing pages at the soft heap limit
+ * and fails at the hard one. The rest is for the pipeline, the pages of the input in use and the
+ * program itself.
+ */
+#define HAM_BUDGET_CACHE 2
+#define HAM_BUDGET_INDEX_CACHE 2
+#define HAM_BUDGET_SOFT_HEAP 4
+#define HAM_BUDGET_HARD_HEAP 6
 
 /* FCC file identifiers */
 #define HAM_FCC_FILE_AM 1
@@ -37,6 +90,11 @@
 #define HAM_FCC_FILE_SC 7
 #define HAM_FCC_FILE_SF 8
 
+#define HAM_FCC_FILE_COUNT 8
+
+/* Longest file name taken from a tar header */
+#define HAM_FCC_NAME_SIZE 256
+
 /* FCC file field count */
 #define HAM_FCC_AM_FIELDS 18
 #define HAM_FCC_EN_FIELDS 27
@@ -54,6 +112,28 @@
 const static char *FCC_FILENAMES[9] = {"unused", "AM.dat", "EN.dat", "HD.dat", "HS.dat", "CO.dat",
                                         "LA.dat", "SC.dat", "SF.dat"};
 
+/* The same for the name of the table each file is converted into */
+const static char *HAM_SQLITE_TABLE_NAMES[9] = {"unused", "amateurs", "entities", "headers",
+                                                "histories", "comments", "license_attachments",
+                                                "special_conditions",
+                                                "license_free_form_special_conditions"};
+
+/*
+ * Type of each field of each file, one letter per field: T text, I integer, D date, which is
+ * stored as the integer YYYYMMDD, and C a code column of a few distinct values, which is text
+ * unless the conversion encodes them. A value that does not parse as its type is stored as text.
+ */
+const static char *HAM_FCC_COLUMN_TYPES[9] = {"",
+                                                /* AM */ "TITTTCCITCCCCCCTCT",
+                                                /* EN */ "TITTTCTTTTTTTTTTTCTTTTTCTCD",
+                                                /* HD */ "TITTTCCDDDTCCCCCCCCCCCCCCCCCCC"
+                                                         "TTTTTCCCCCCCDDICCCCC",
+                                                /* HS */ "TITTDC",
+                                                /* CO */ "TITTDTCD",
+                                                /* LA */ "TITCTDTC",
+                                                /* SC */ "TITTTCICD",
+                                                /* SF */ "TITTTCIITCD"};
+
 const static char *HAM_SQLITE_TABLE_FCC_AM = "CREATE TABLE IF NOT EXISTS amateurs ("
                                                 "id INTEGER PRIMARY KEY AUTOINCREMENT,"
                                                 "record_type TEXT NOT NULL,"
@@ -105,7 +185,7 @@ const static char *HAM_SQLITE_TABLE_FCC_EN = "CREATE TABLE IF NOT EXISTS entitie
                                                 "applicant_type_code TEXT,"
                                                 "applicant_type_other TEXT,"
                                                 "status_code TEXT,"
-                                                "status_date DATETIME,"
+                                                "status_date INTEGER,"
                                                 "created_at DATETIME,"
                                                 "updated_at DATETIME);";
 
@@ -118,9 +198,9 @@ const static char *HAM_SQLITE_TABLE_FCC_HD = "CREATE TABLE IF NOT EXISTS headers
                                                 "call_sign TEXT,"
                                                 "license_status TEXT,"
                                                 "radio_service_code TEXT,"
-                                                "grant_date TEXT,"
-                                                "expired_date TEXT,"
-                                                "cancellation_date TEXT,"
+                                                "grant_date INTEGER,"
+                                                "expired_date INTEGER,"
+                                                "cancellation_date INTEGER,"
                                                 "eligibility_rule_num TEXT,"
                                                 "applicant_type_code_reserved TEXT,"
                                                 "alien TEXT,"
@@ -153,8 +233,8 @@ const static char *HAM_SQLITE_TABLE_FCC_HD = "CREATE TABLE IF NOT EXISTS headers
                                                 "asian TEXT,"
                                                 "white TEXT,"
                                                 "ethnicity TEXT,"
-                                                "effective_date TEXT,"
-                                                "last_action_date TEXT,"
+                                                "effective_date INTEGER,"
+                                                "last_action_date INTEGER,"
                                                 "auction_id INTEGER,"
                                                 "reg_stat_broad_serv TEXT,"
                                                 "band_manager TEXT,"
@@ -170,7 +250,7 @@ const static char *HAM_SQLITE_TABLE_FCC_HS = "CREATE TABLE IF NOT EXISTS histori
                                                 "unique_system_identifier INTEGER NOT NULL,"
                                                 "uls_file_number TEXT,"
                                                 "callsign TEXT,"
-                                                "log_date TEXT,"
+                                                "log_date INTEGER,"
                                                 "code TEXT,"
                                                 "created_at DATETIME,"
                                                 "updated_at DATETIME);";
@@ -182,10 +262,10 @@ const static char *HAM_SQLITE_TABLE_FCC_CO = "CREATE TABLE IF NOT EXISTS comment
                                                 "unique_system_identifier INTEGER NOT NULL,"
                                                 "uls_file_num TEXT,"
                                                 "callsign TEXT,"
-                                                "comment_date TEXT,"
+                                                "comment_date INTEGER,"
                                                 "description TEXT,"
                                                 "status_code TEXT,"
-                                                "status_date DATETIME,"
+                                                "status_date INTEGER,"
                                                 "created_at DATETIME,"
                                                 "updated_at DATETIME);";
 
@@ -196,7 +276,7 @@ const static char *HAM_SQLITE_TABLE_FCC_LA = "CREATE TABLE IF NOT EXISTS license
                                                 "callsign TEXT,"
                                                 "attachment_code TEXT,"
                                                 "attachment_desc TEXT,"
-                                                "attachment_date TEXT,"
+                                                "attachment_date INTEGER,"
                                                 "attachment_filename TEXT,"
                                                 "action_performed TEXT,"
                                                 "created_at DATETIME,"
@@ -212,7 +292,7 @@ const static char *HAM_SQLITE_TABLE_FCC_SC = "CREATE TABLE IF NOT EXISTS special
                                                 "special_condition_type TEXT,"
                                                 "special_condition_code INTEGER,"
                                                 "status_code TEXT,"
-                                                "status_date DATETIME,"
+                                                "status_date INTEGER,"
                                                 "created_at DATETIME,"
                                                 "updated_at DATETIME);";
 
@@ -228,7 +308,7 @@ const static char *HAM_SQLITE_TABLE_FCC_SF = "CREATE TABLE IF NOT EXISTS license
                                                 "sequence_number INTEGER,"
                                                 "lic_freeform_condition TEXT,"
                                                 "status_code TEXT,"
-                                                "status_date DATETIME,"
+                                                "status_date INTEGER,"
                                                 "created_at DATETIME,"
                                                 "updated_at DATETIME);";
 
@@ -555,43 +635,419 @@ const static char *HAM_SQLITE_INSERT_FCC_SF = "INSERT INTO license_free_form_spe
                                                 "@created_at,"
                                                 "@updated_at)";
 
+/*
+ * Daily transaction files. A license's records are replaced as a whole, so the licenses already
+ * seen in this update are kept in a temporary table, and the old rows of a license are deleted the
+ * first time it shows up. Deleting by license needs an index on every table.
+ */
+const static char *HAM_SQLITE_UPDATE_TABLE = "CREATE TEMP TABLE IF NOT EXISTS ham_update_licenses ("
+                                                "unique_system_identifier INTEGER PRIMARY KEY)";
+
+const static char *HAM_SQLITE_UPDATE_MARK = "INSERT OR IGNORE INTO temp.ham_update_licenses"
+                                                "(unique_system_identifier) VALUES (?)";
+
+const static char *HAM_SQLITE_UPDATE_INDEX = "CREATE INDEX IF NOT EXISTS "
+                                                "%s_unique_system_identifier "
+                                                "ON %s (unique_system_identifier)";
+
+const static char *HAM_SQLITE_UPDATE_DELETE = "DELETE FROM %s WHERE unique_system_identifier = ?";
+
+/*
+ * Lookup indexes. They are built once the tables are loaded, when each is a single sort of the
+ * finished table instead of a B-tree updated on every insert. The names match the indexes an update
+ * creates, so an update of a database built with them reuses them.
+ */
+typedef struct ham_sqlite_index {
+    const char *table;
+    const char *column;
+
+    /* Columns of an index on more than one, or NULL for the one column it is named after */
+    const char *columns;
+} ham_sqlite_index;
+
+const static ham_sqlite_index HAM_SQLITE_INDEXES[] = {
+    {"amateurs", "unique_system_identifier", NULL},
+    {"amateurs", "callsign", NULL},
+    {"entities", "unique_system_identifier", NULL},
+    {"entities", "call_sign", NULL},
+    {"entities", "frn", NULL},
+    {"headers", "unique_system_identifier", NULL},
+    {"headers", "call_sign", NULL},
+    {"headers", "license_status", NULL},
+    {"histories", "unique_system_identifier", NULL},
+    {"histories", "callsign", NULL},
+    {"comments", "unique_system_identifier", NULL},
+    {"license_attachments", "unique_system_identifier", NULL},
+    {"special_conditions", "unique_system_identifier", NULL},
+    {"license_free_form_special_conditions", "unique_system_identifier", NULL}
+};
+
+#define HAM_SQLITE_INDEX_COUNT (sizeof(HAM_SQLITE_INDEXES) / sizeof(HAM_SQLITE_INDEXES[0]))
+
+const static char *HAM_SQLITE_INDEX = "CREATE INDEX IF NOT EXISTS %s_%s ON %s (%s)";
+
+/*
+ * Callsign parts. Every callsign and previous callsign of the AM file gets a row with its prefix
+ * letters, call area digit and suffix letters, and its format, e.g. 2x3 for KH6ABC. A callsign of
+ * another pattern has no parts. The index on callsign is a sorted prefix index: a prefix search
+ * such as callsign GLOB 'KH6*' is a range of it, and the other indexes serve searches by suffix
+ * and by format and call area.
+ */
+const static char *HAM_SQLITE_CALLSIGN_PARTS_TABLE = "CREATE TABLE IF NOT EXISTS callsign_parts ("
+                                                "unique_system_identifier INTEGER NOT NULL,"
+                                                "previous INTEGER NOT NULL,"
+                                                "callsign TEXT NOT NULL,"
+                                                "prefix TEXT,"
+                                                "area INTEGER,"
+                                                "suffix TEXT,"
+                                                "format TEXT)";
+
+const static char *HAM_SQLITE_CALLSIGN_PARTS_INSERT = "INSERT INTO callsign_parts ("
+                                                "unique_system_identifier, previous, callsign, "
+                                                "prefix, area, suffix, format) "
+                                                "VALUES (?, ?, ?, ?, ?, ?, ?)";
+
+const static ham_sqlite_index HAM_SQLITE_CALLSIGN_PARTS_INDEXES[] = {
+    {"callsign_parts", "unique_system_identifier", NULL},
+    {"callsign_parts", "callsign", NULL},
+    {"callsign_parts", "suffix", NULL},
+    {"callsign_parts", "format_area", "format, area"}
+};
+
+#define HAM_SQLITE_CALLSIGN_PARTS_INDEX_COUNT (sizeof(HAM_SQLITE_CALLSIGN_PARTS_INDEXES) \
+                                                / sizeof(HAM_SQLITE_CALLSIGN_PARTS_INDEXES[0]))
+
+/*
+ * Name search. An FTS5 index over the names and addresses of entities that reads their text from
+ * the table itself, as external content, so nothing is stored twice. unicode61 folds case and
+ * removes diacritics. A load fills it in one pass once the table is complete, with automatic
+ * merging off, and merges it into a single segment at the end. An update removes the rows of the
+ * licenses it replaces as they are deleted and adds the new rows at the end.
+ */
+#define HAM_SQLITE_NAME_SEARCH_COLUMNS "entity_name, first_name, last_name, street_address, city"
+
+const static char *HAM_SQLITE_NAME_SEARCH_TABLE = "CREATE VIRTUAL TABLE IF NOT EXISTS "
+                                                "entities_search USING fts5("
+                                                HAM_SQLITE_NAME_SEARCH_COLUMNS ","
+                                                "content='entities',"
+                                                "content_rowid='id',"
+                                                "tokenize='unicode61 remove_diacritics 2')";
+
+const static char *HAM_SQLITE_NAME_SEARCH_EXISTS = "SELECT 1 FROM sqlite_master "
+                                                "WHERE name = 'entities_search'";
+
+const static char *HAM_SQLITE_NAME_SEARCH_REBUILD = "INSERT INTO entities_search (entities_search, "
+                                                "rank) VALUES ('automerge', 0);"
+                                                "INSERT INTO entities_search (entities_search) "
+                                                "VALUES ('rebuild');"
+                                                "INSERT INTO entities_search (entities_search) "
+                                                "VALUES ('optimize');"
+                                                "INSERT INTO entities_search (entities_search, "
+                                                "rank) VALUES ('automerge', 4)";
+
+const static char *HAM_SQLITE_NAME_SEARCH_DELETE = "INSERT INTO entities_search (entities_search, "
+                                                "rowid, " HAM_SQLITE_NAME_SEARCH_COLUMNS ") "
+                                                "SELECT 'delete', id, "
+                                                HAM_SQLITE_NAME_SEARCH_COLUMNS " FROM entities "
+                                                "WHERE unique_system_identifier = ?";
+
+const static char *HAM_SQLITE_NAME_SEARCH_ADD = "INSERT INTO entities_search (rowid, "
+                                                HAM_SQLITE_NAME_SEARCH_COLUMNS ") "
+                                                "SELECT id, " HAM_SQLITE_NAME_SEARCH_COLUMNS " "
+                                                "FROM entities WHERE unique_system_identifier IN "
+                                                "(SELECT unique_system_identifier "
+                                                "FROM temp.ham_update_licenses)";
+
+/* A clustered entities table is not keyed by id, which is how the index finds its rows */
+const static char *HAM_SQLITE_NAME_SEARCH_ID_INDEX = "CREATE INDEX IF NOT EXISTS entities_id "
+                                                "ON entities (id)";
+
+/* Fields of the callsigns in an AM record */
+#define HAM_FCC_AM_CALLSIGN 4
+#define HAM_FCC_AM_PREVIOUS_CALLSIGN 15
+
+/*
+ * Compact schema. The ids are plain rowids, without the sqlite_sequence bookkeeping of
+ * AUTOINCREMENT, and the import time is kept once here instead of on every row.
+ */
+const static char *HAM_SQLITE_METADATA_TABLE = "CREATE TABLE IF NOT EXISTS ham_metadata ("
+                                                "key TEXT PRIMARY KEY,"
+                                                "value TEXT)";
+
+const static char *HAM_SQLITE_METADATA_SET = "INSERT OR REPLACE INTO ham_metadata (key, value) "
+                                                "VALUES (%Q, %Q)";
+
+/*
+ * Checkpoints of a load in batches, one row per file: its size, the byte offset and line the next
+ * batch starts at, and whether the file is done. The table is dropped once the load succeeds.
+ */
+const static char *HAM_SQLITE_CHECKPOINT_TABLE = "CREATE TABLE IF NOT EXISTS ham_checkpoints ("
+                                                    "file TEXT PRIMARY KEY,"
+                                                    "size INTEGER NOT NULL,"
+                                                    "byte_offset INTEGER NOT NULL,"
+                                                    "line INTEGER NOT NULL,"
+                                                    "done INTEGER NOT NULL)";
+
+const static char *HAM_SQLITE_CHECKPOINT_SET = "INSERT OR REPLACE INTO ham_checkpoints "
+                                                "(file, size, byte_offset, line, done) "
+                                                "VALUES (?, ?, ?, ?, ?)";
+
+const static char *HAM_SQLITE_CHECKPOINT_SELECT = "SELECT file, size, byte_offset, line, done "
+                                                    "FROM ham_checkpoints";
+
+/* The timestamps at the end of the insert statements */
+#define HAM_SQLITE_TIMESTAMP_COLUMNS ",created_at,updated_at"
+#define HAM_SQLITE_TIMESTAMP_VALUES ",@created_at,@updated_at"
+
+/*
+ * Clustered layout. The tables are WITHOUT ROWID, keyed by license and then by id, which is the
+ * order the rows were loaded in. Rows that arrive in key order are appended; the others are staged
+ * in a temporary table and sorted into place at the end.
+ */
+#define HAM_SQLITE_CLUSTER_KEY ",PRIMARY KEY (unique_system_identifier, id)"
+
+const static char *HAM_SQLITE_STAGE_TABLE = "CREATE TEMP TABLE IF NOT EXISTS ham_stage_%s AS "
+                                                "SELECT * FROM main.%s WHERE 0";
+
+const static char *HAM_SQLITE_STAGE_MERGE = "INSERT INTO main.%s SELECT * FROM temp.ham_stage_%s "
+                                                "ORDER BY unique_system_identifier, id";
+
+const static char *HAM_SQLITE_MAX_ID = "SELECT max(id) FROM %s";
+
+/*
+ * Encoded schema. Each code column holds the code of its value, and its lookup table, named after
+ * the table and column, gives the value back. The <table>_decoded views have the columns and values
+ * of the plain schema.
+ */
+const static char *HAM_SQLITE_CODE_TABLE = "CREATE TABLE IF NOT EXISTS %s_%s_codes ("
+                                                "code INTEGER PRIMARY KEY,"
+                                                "value TEXT NOT NULL)";
+
+const static char *HAM_SQLITE_CODE_INSERT = "INSERT OR IGNORE INTO %s_%s_codes (code, value) "
+                                                "VALUES (?, ?)";
+
+const static char *HAM_SQLITE_CODE_SELECT = "SELECT code, value FROM %s_%s_codes ORDER BY code";
+
+const static char *HAM_SQLITE_CODE_MERGE = "INSERT OR IGNORE INTO main.%s_%s_codes "
+                                                "SELECT * FROM part.%s_%s_codes";
+
+const static char *HAM_SQLITE_CODE_VIEW_COLUMN = "%z, (SELECT value FROM %s_%s_codes "
+                                                    "WHERE code = %s.%s) AS %s";
+
+/*
+ * Licenses table. One row per license with the fields a lookup usually wants, so it is a single
+ * row fetch instead of a join of amateurs, entities and headers. The row is joined out of the AM,
+ * EN and HD files, which are read side by side in license order.
+ */
+typedef struct ham_license_column {
+    const char *name;
+    int fcc_file;
+    int field;
+} ham_license_column;
+
+const static ham_license_column HAM_LICENSE_COLUMNS[] = {
+    {"callsign", HAM_FCC_FILE_HD, 4},
+    {"license_status", HAM_FCC_FILE_HD, 5},
+    {"grant_date", HAM_FCC_FILE_HD, 7},
+    {"expired_date", HAM_FCC_FILE_HD, 8},
+    {"operator_class", HAM_FCC_FILE_AM, 5},
+    {"entity_name", HAM_FCC_FILE_EN, 7},
+    {"first_name", HAM_FCC_FILE_EN, 8},
+    {"last_name", HAM_FCC_FILE_EN, 10},
+    {"street_address", HAM_FCC_FILE_EN, 15},
+    {"city", HAM_FCC_FILE_EN, 16},
+    {"state", HAM_FCC_FILE_EN, 17},
+    {"zip_code", HAM_FCC_FILE_EN, 18}
+};
+
+#define HAM_LICENSE_COLUMN_COUNT (sizeof(HAM_LICENSE_COLUMNS) / sizeof(HAM_LICENSE_COLUMNS[0]))
+
+/* The files the licenses table is joined from */
+const static int HAM_LICENSE_FILES[] = {HAM_FCC_FILE_AM, HAM_FCC_FILE_EN, HAM_FCC_FILE_HD};
+
+#define HAM_LICENSE_FILE_COUNT (sizeof(HAM_LICENSE_FILES) / sizeof(HAM_LICENSE_FILES[0]))
+
+/* A license has several entities; the name and address are the licensee's, entity type L */
+#define HAM_LICENSE_ENTITY_TYPE 5
+#define HAM_LICENSE_LICENSEE "L"
+
+const static char *HAM_SQLITE_LICENSES_TABLE = "CREATE TABLE IF NOT EXISTS licenses ("
+                                                "unique_system_identifier INTEGER PRIMARY KEY%s)";
+
+const static char *HAM_SQLITE_LICENSES_INSERT = "INSERT OR REPLACE INTO licenses "
+                                                    "(unique_system_identifier%s) VALUES (?%s)";
+
+/*
+ * Rows of the callsign index. They are read in table order and sorted afterwards, which is much
+ * faster than having SQLite sort them. The tables are the views with the values when the schema
+ * is encoded.
+ */
+const static char *HAM_SQLITE_CALLSIGN_INDEX_SELECT = "SELECT h.call_sign, "
+                                                        "h.unique_system_identifier, "
+                                                        "h.expired_date, h.license_status, "
+                                                        "a.operator_class FROM %s h "
+                                                        "LEFT JOIN %s a ON "
+                                                        "a.unique_system_identifier = "
+                                                        "h.unique_system_identifier "
+                                                        "WHERE h.call_sign IS NOT NULL";
+
+/* Status of an active license */
+#define HAM_LICENSE_ACTIVE 'A'
+
+/* A record that comes out of order only fills in its own columns of the row written before */
+const static char *HAM_SQLITE_LICENSES_UPSERT = "INSERT INTO licenses "
+                                                    "(unique_system_identifier%s) VALUES (?%s) "
+                                                    "ON CONFLICT (unique_system_identifier) "
+                                                    "DO UPDATE SET %s";
+
+/* A caller supplied source that is read front to back once */
+typedef struct ham_fcc_source {
+    ham_fcc_read_callback read;
+    void *context;
+
+    /* Set once anything has been read; the source cannot be rewound after that */
+    int started;
+} ham_fcc_source;
+
+/*
+ * A single FCC data file. When the platform allows it the whole file is memory mapped and the
+ * reader hands out slices of the mapping; otherwise it falls back to reading through the FILE*.
+ */
+typedef struct ham_fcc_file {
+    FILE *file;
+    int open;
+
+    /* Size in bytes, or -1 if it cannot be known without reading the file (e.g. a pipe) */
+    INT64 size;
+
+    /* The whole file, when it could be mapped */
+    ham_map map;
+
+    /* Set when the file is a member of a zip archive. Reads inflate it; file is NULL. */
+    ham_zip_stream *zip;
+
+    /* Set when the file is read from a callback; file is NULL */
+    ham_fcc_source *source;
+} ham_fcc_file;
+
+/* Reads one FCC file a line at a time without copying the line out of the mapping or buffer */
+typedef struct ham_fcc_reader {
+    const ham_fcc_file *source;
+
+    /* Unread data. For mapped files this is the rest of the mapping. */
+    const char *begin;
+    const char *end;
+
+    /* Only used on the FILE* path */
+    char *buffer;
+    size_t buffer_size;
+    int eof;
+
+    /* Set if a read failed, which also ends the file */
+    int error;
+
+    /*
+     * Bytes of a mapped file to read before the pages behind the current record are given back,
+     * or 0 to keep the whole mapping; and where the pages given back so far end
+     */
+    size_t release;
+    const char *released;
+
+    /* Bytes of the file before the next record */
+    INT64 offset;
+} ham_fcc_reader;
+
+/* Rows parsed out of one chunk of a file by a parser */
+typedef struct ham_batch {
+    int error;
+
+    int rows;
+    int capacity;
+
+    /* rows * num_fields views into the chunk */
+    ham_field *fields;
+
+    /* Line of each row, counted from the start of the chunk */
+    unsigned int *lines;
+
+    /* Lines in the chunk, blank ones included */
+    unsigned int num_lines;
+} ham_batch;
+
+/* A chunk of a file on its way from the reader through a parser to the writer */
+typedef struct ham_slot {
+    const char *begin;
+    const char *end;
+
+    /* Holds the chunk when the file is read instead of mapped */
+    char *buffer;
+    size_t buffer_size;
+
+    /* Set on the slot that ends the file. It carries no data, only the reader's error if any. */
+    int last;
+
+    /* Bytes of the file up to the end of the chunk */
+    INT64 offset;
+
+    ham_batch batch;
+} ham_slot;
+
+typedef struct ham_pipeline ham_pipeline;
+
+/*
+ * A parser and the rings around it. Slots go reader -> input -> parser -> output -> writer -> free
+ * -> reader, so each ring has one producer and one consumer, and a full set of slots in flight
+ * holds the reader back.
+ */
+typedef struct ham_parser {
+    ham_pipeline *pipeline;
+    ham_thread thread;
+
+    ham_ring input;
+    ham_ring output;
+    ham_ring free;
+
+    ham_slot slots[HAM_PIPELINE_DEPTH];
+} ham_parser;
+
+/*
+ * Reads a file on one thread, parses it on one or more others and leaves the writer with nothing
+ * but binding and stepping. Chunks are dealt to the parsers round robin, so the writer gets them
+ * back in file order by visiting the parsers in the same order.
+ */
+struct ham_pipeline {
+    const ham_fcc_file *file;
+    int num_fields;
+    size_t chunk_size;
+
+    int num_parsers;
+    int started;
+    ham_parser *parsers;
+
+    ham_thread reader;
+    int reader_started;
+
+    /*
+     * Reader state. Mapped files are cut in place; read ones carry a partial record over. The
+     * offset is the bytes of the file handed out so far.
+     */
+    const char *position;
+    INT64 offset;
+    char *carry;
+    size_t carry_length;
+    size_t carry_size;
+    int eof;
+
+    /* Set through ham_ring_abort to stop every stage early */
+    volatile int abort;
+};
+
 /* FCC database structure */
 struct ham_fcc_database {
     char *directory;
 
-    /* FCC database files */
-    FILE *am;
-    FILE *en;
-    FILE *hd;
-    FILE *hs;
-    FILE *co;
-    FILE *la;
-    FILE *sc;
-    FILE *sf;
-
-    int am_open;
-    int en_open;
-    int hd_open;
-    int hs_open;
-    int co_open;
-    int la_open;
-    int sc_open;
-    int sf_open;
-
-    /* Holds the number of lines in the files */
-    ham_fcc_lengths *fcc_lengths;
-};
-
-/* FCC database file lengths */
-struct ham_fcc_lengths {
-    INT64 am_length;
-    INT64 en_length;
-    INT64 hd_length;
-    INT64 hs_length;
-    INT64 co_length;
-    INT64 la_length;
-    INT64 sc_length;
-    INT64 sf_length;
+    /* FCC database files, indexed by the HAM_FCC_FILE_* identifiers */
+    ham_fcc_file files[HAM_FCC_FILE_COUNT + 1];
 };
 
 typedef struct ham_fcc_sqlite {
@@ -620,148 +1076,341 @@ typedef struct ham_fcc_sqlite {
     char time[80];
 
     unsigned int sql_insert_calls;
+
+    /* Threads the read and parse pipeline may use. With none, the writer reads the file itself. */
+    int threads;
+
+    /* Bytes per pipeline chunk, and the page cache in KiB while the indexes are built */
+    size_t chunk_size;
+    int index_cache_size;
+
+    /* Set when applying a daily transaction file instead of loading a full one */
+    int update;
+    sqlite3_stmt *mark_stmt;
+    sqlite3_stmt *delete_stmt[HAM_FCC_FILE_COUNT + 1];
+    unsigned int licenses_replaced;
+
+    /* Set for the encoded schema. Each file has a dictionary per field for its code columns. */
+    int encode;
+    ham_dict *dictionaries[HAM_FCC_FILE_COUNT + 1];
+
+    /* Set for the compact schema */
+    int compact;
+
+    /*
+     * Set for the clustered layout. Each table has the id of its last row, the largest license
+     * appended so far, and a statement for the rows that have to be staged instead.
+     */
+    int clustered;
+    INT64 sequence[HAM_FCC_FILE_COUNT + 1];
+    INT64 last_key[HAM_FCC_FILE_COUNT + 1];
+    sqlite3_stmt *stage_stmt[HAM_FCC_FILE_COUNT + 1];
+    unsigned int staged[HAM_FCC_FILE_COUNT + 1];
+
+    /* Set to fill the callsign_parts table along with the AM records */
+    int callsign_parts;
+    sqlite3_stmt *parts_stmt;
+    sqlite3_stmt *parts_delete_stmt;
+
+    /*
+     * Set to build the entities_search index. It is kept up to date by an update if it was
+     * already there, and filled from scratch otherwise.
+     */
+    int name_search;
+    int name_search_existed;
+    sqlite3_stmt *search_delete_stmt;
+
+    /* File an in-memory database is written out to once the conversion succeeds */
+    char *target;
+
+    /* Commit batching: the limits, the records and bytes in the open transaction, and commits */
+    INT64 commit_rows;
+    INT64 commit_bytes;
+    INT64 batch_rows;
+    INT64 batch_bytes;
+    unsigned int commits;
+
+    /*
+     * Checkpoints of a load in batches: the statement that records how far each file got, and for
+     * a resumed load the byte offset each file goes on from and whether it was done already.
+     */
+    sqlite3_stmt *checkpoint_stmt;
+    INT64 resume_offset[HAM_FCC_FILE_COUNT + 1];
+    int resume_done[HAM_FCC_FILE_COUNT + 1];
+
+    /*
+     * Memory budget in bytes, or 0. Under one the pages of the mapped input are given back as
+     * they are converted, and terminate puts back the heap limits from before it.
+     */
+    INT64 memory_budget;
+    INT64 soft_heap_limit;
+    INT64 hard_heap_limit;
+
+    /* An error that stops the load. A record that fails on its own is reported and skipped. */
+    int error;
 } ham_fcc_sqlite;
 
+/*
+ * Hands the files out to the table threads when each record type is converted into its own
+ * temporary database. The largest files go first so the biggest one does not start last.
+ */
+typedef struct ham_table_scheduler {
+    const ham_fcc_database *fcc_database;
+    const char *filename;
+    const char *time;
+
+    int order[HAM_FCC_FILE_COUNT];
+    int count;
+    int next;
+
+    /* Pipeline threads each table thread may use */
+    int threads;
+
+    /* Settings of the table databases, which are always files */
+    ham_fcc_convert_options options;
+
+    int encode;
+    int compact;
+    int clustered;
+    int callsign_parts;
+
+    /* Codes the output already has, which the table threads only read */
+    ham_dict *const *dictionaries;
+
+    ham_mutex mutex;
+    unsigned int sql_insert_calls;
+    int error;
+} ham_table_scheduler;
+
+/* One of the files read side by side to build the licenses table */
+typedef struct ham_license_stream {
+    int fcc_file;
+    int num_fields;
+
+    ham_fcc_reader reader;
+    int done;
+
+    /* The current record, and its license */
+    ham_field fields[HAM_SPLIT_MAX_FIELDS];
+    INT64 key;
+
+    /* License of the last run of records joined; a record before it is out of order */
+    INT64 last;
+} ham_license_stream;
+
 /* Internal function prototypes */
-int ham_alloc_string_array(char ***array, const int num_fields, const int num_char);
-int ham_free_string_array(char ***array, const int num_fields, const int num_char);
-int ham_parse_line_with_delimiter(char **fields, const char *line, const int num_fields,
-                                    const char *delimiter);
-INT64 ham_get_lines_in_file(FILE *file);
+int ham_parse_record(ham_field *fields, const ham_record *record, const int num_fields);
 
 char *fcc_directory(char *directory);
 
 /* Internal FCC file function prototypes */
 int ham_fcc_files_exist(char *directory);
 void ham_fcc_close_all(ham_fcc_database *database);
+int ham_fcc_file_open(ham_fcc_file *file, const char *path);
+int ham_fcc_file_open_zip(ham_fcc_file *file, const char *path, const ham_zip_member *member);
+int ham_fcc_file_open_source(ham_fcc_file *file, ham_fcc_read_callback read, void *context);
+int ham_fcc_file_index(const char *name);
+int ham_fcc_record_type(const ham_record *record);
+int ham_fcc_file_map(ham_fcc_file *file);
+void ham_fcc_file_release(const char **released, const char *end);
+void ham_fcc_file_close(ham_fcc_file *file);
+int ham_fcc_file_read(const ham_fcc_file *file, char *buffer, const size_t size, size_t *read);
+int ham_fcc_file_rewind(const ham_fcc_file *file);
+int ham_fcc_file_skip(const ham_fcc_file *file, const INT64 offset);
+int ham_fcc_reader_init(ham_fcc_reader *reader, const ham_fcc_file *file);
+int ham_fcc_reader_next_record(ham_fcc_reader *reader, ham_record *record);
+int ham_fcc_reader_seek(ham_fcc_reader *reader, const INT64 offset);
+void ham_fcc_reader_terminate(ham_fcc_reader *reader);
+
+/* Internal pipeline function prototypes */
+int ham_batch_parse(ham_batch *batch, const char *begin, const char *end, const int num_fields);
+int ham_pipeline_init(ham_pipeline *pipeline, const ham_fcc_file *file, const int num_fields,
+                        const size_t chunk_size, const INT64 offset);
+int ham_pipeline_start(ham_pipeline *pipeline, const ham_fcc_file *file, const int num_fields,
+                        const int num_parsers, const size_t chunk_size, const INT64 offset);
+void ham_pipeline_stop(ham_pipeline *pipeline);
+int ham_pipeline_next_chunk(ham_pipeline *pipeline, ham_slot *slot);
+void ham_pipeline_reader_main(void *argument);
+void ham_pipeline_parser_main(void *argument);
 
 /* Internal SQLite function prototypes */
-int ham_sqlite_init(ham_fcc_sqlite **fcc_sqlite, const char *filename);
+int ham_sqlite_init(ham_fcc_sqlite **fcc_sqlite, const char *filename,
+                    const ham_fcc_convert_options *options);
+int ham_sqlite_apply_options(sqlite3 *database, const ham_fcc_convert_options *options);
+int ham_sqlite_pragma(sqlite3 *database, const char *format, ...);
+const char *ham_sqlite_pragma_value(const char *value, const char *const *allowed);
+size_t ham_chunk_size(const ham_fcc_convert_options *options);
+void ham_budget_options(const ham_fcc_convert_options *options,
+                        ham_fcc_convert_options *budgeted);
+INT64 ham_peak_memory(void);
 int ham_sqlite_terminate(ham_fcc_sqlite *fcc_sqlite);
+int ham_sqlite_finish(ham_fcc_sqlite *fcc_sqlite, int error);
+int ham_sqlite_open_memory(sqlite3 **database, const char *filename);
+int ham_sqlite_flush(ham_fcc_sqlite *fcc_sqlite);
 int ham_sqlite_sql_prepare_stmt(ham_fcc_sqlite *fcc_sqlite);
 int ham_sqlite_sql_finalize_stmt(ham_fcc_sqlite *fcc_sqlite);
 int ham_sqlite_reset_file(const char *filename);
 int ham_sqlite_open_database_connection(sqlite3 **db, const char *filename);
 int ham_sqlite_create_tables(ham_fcc_sqlite *fcc_sqlite);
-int ham_sqlite_fcc_convert_file(ham_fcc_sqlite *fcc_sqlite, FILE *data, const int fcc_file);
-int ham_sqlite_insert_fields(ham_fcc_sqlite *fcc_sqlite, char **fields, const int num_fields,
-                                sqlite3_stmt *sql_stmt, const int fcc_file, const int currentline);
+const char *ham_sqlite_table_schema(const int fcc_file);
+int ham_sqlite_column_name(const int fcc_file, const int column, char *name, const size_t size);
+char *ham_sqlite_schema(const ham_fcc_sqlite *fcc_sqlite, const int fcc_file);
+int ham_sqlite_prepare_insert(ham_fcc_sqlite *fcc_sqlite, const char *insert, const char *into,
+                                sqlite3_stmt **sql_stmt);
+const char *ham_sqlite_insert_sql(const int fcc_file);
+int ham_sqlite_cluster_prepare(ham_fcc_sqlite *fcc_sqlite);
+sqlite3_stmt *ham_sqlite_cluster_target(ham_fcc_sqlite *fcc_sqlite, const int fcc_file,
+                                        const ham_field *identifier, sqlite3_stmt *sql_stmt);
+int ham_sqlite_cluster_finish(ham_fcc_sqlite *fcc_sqlite);
+int ham_sqlite_write_metadata(ham_fcc_sqlite *fcc_sqlite);
+int ham_sqlite_encode_prepare(ham_fcc_sqlite *fcc_sqlite);
+int ham_sqlite_encode_save(ham_fcc_sqlite *fcc_sqlite);
+int ham_sqlite_encode_finish(ham_fcc_sqlite *fcc_sqlite);
+void ham_sqlite_encode_free(ham_fcc_sqlite *fcc_sqlite);
+int ham_sqlite_encode_seed(ham_fcc_sqlite *fcc_sqlite, const int fcc_file,
+                            const ham_dict *dictionaries);
+int ham_sqlite_create_indexes(ham_fcc_sqlite *fcc_sqlite, const int threads);
+int ham_sqlite_create_index(ham_fcc_sqlite *fcc_sqlite, const ham_sqlite_index *index);
+double ham_seconds(void);
+void ham_sqlite_report_load(const ham_fcc_sqlite *fcc_sqlite, const double start);
+int ham_sqlite_update_prepare(ham_fcc_sqlite *fcc_sqlite);
+void ham_sqlite_update_finalize(ham_fcc_sqlite *fcc_sqlite);
+int ham_sqlite_update_license(ham_fcc_sqlite *fcc_sqlite, const ham_field *identifier);
+int ham_sqlite_file_target(ham_fcc_sqlite *fcc_sqlite, const int fcc_file, int *num_fields,
+                            sqlite3_stmt **sql_stmt, unsigned int **currentline);
+int ham_sqlite_fcc_convert_file(ham_fcc_sqlite *fcc_sqlite, const ham_fcc_file *data,
+                                const int fcc_file);
+int ham_sqlite_fcc_convert_mixed(ham_fcc_sqlite *fcc_sqlite, const ham_fcc_file *data);
+int ham_sqlite_fcc_convert_tar(ham_fcc_sqlite *fcc_sqlite, ham_tar *tar);
+int ham_sqlite_fcc_convert_pipelined(ham_fcc_sqlite *fcc_sqlite, const ham_fcc_file *data,
+                                        const int fcc_file, const int num_fields,
+                                        sqlite3_stmt *sql_stmt, unsigned int *currentline);
+int ham_sqlite_bind_field(sqlite3_stmt *sql_stmt, const int index, const ham_field *field,
+                            const char type, ham_dict *dict);
+int ham_sqlite_insert_fields(ham_fcc_sqlite *fcc_sqlite, const ham_field *fields,
+                                const int num_fields, sqlite3_stmt *sql_stmt, const int fcc_file,
+                                const int currentline);
+int ham_sqlite_insert_callsign_parts(ham_fcc_sqlite *fcc_sqlite, const ham_field *fields,
+                                        const int num_fields);
+int ham_sqlite_insert_callsign(ham_fcc_sqlite *fcc_sqlite, const ham_field *identifier,
+                                const ham_field *callsign, const int previous);
+void ham_sqlite_batch_record(ham_fcc_sqlite *fcc_sqlite, const ham_field *fields,
+                                const int num_fields);
+int ham_sqlite_batch_full(const ham_fcc_sqlite *fcc_sqlite);
+int ham_sqlite_commit(ham_fcc_sqlite *fcc_sqlite);
+int ham_sqlite_checkpoint(ham_fcc_sqlite *fcc_sqlite, const ham_fcc_file *data, const int fcc_file,
+                            const INT64 offset, const unsigned int line, const int done);
+int ham_sqlite_checkpoints_prepare(ham_fcc_sqlite *fcc_sqlite,
+                                    const ham_fcc_database *fcc_database, const int resume);
+int ham_sqlite_checkpoints_finish(ham_fcc_sqlite *fcc_sqlite);
+
+/* Internal per table conversion prototypes */
+void ham_sqlite_table_filename(char *buffer, const size_t size, const char *filename,
+                                const int fcc_file);
+int ham_sqlite_convert_tables(ham_fcc_sqlite *fcc_sqlite, const ham_fcc_database *fcc_database,
+                                const char *filename, const int threads,
+                                const ham_fcc_convert_options *options);
+void ham_sqlite_table_thread_main(void *argument);
+int ham_sqlite_convert_table(ham_table_scheduler *scheduler, const int fcc_file);
+int ham_sqlite_merge_table(ham_fcc_sqlite *fcc_sqlite, const char *table_filename,
+                            const int fcc_file);
+
+/* Internal licenses table prototypes */
+int ham_sqlite_build_licenses(ham_fcc_sqlite *fcc_sqlite, const ham_fcc_database *fcc_database);
+int ham_sqlite_licenses_prepare(ham_fcc_sqlite *fcc_sqlite, sqlite3_stmt **insert_stmt,
+                                sqlite3_stmt **upsert_stmt);
+int ham_license_stream_next(ham_license_stream *stream, sqlite3_stmt *upsert_stmt,
+                            unsigned int *late);
+int ham_license_stream_preferred(const ham_license_stream *stream);
+int ham_license_stream_bind(const ham_license_stream *stream, sqlite3_stmt *sql_stmt);
+
+/* Internal name search prototypes */
+int ham_sqlite_name_search_create(ham_fcc_sqlite *fcc_sqlite);
+int ham_sqlite_build_name_search(ham_fcc_sqlite *fcc_sqlite);
+
+/* Internal columnar snapshot prototypes */
+int ham_columns_convert_file(const ham_fcc_file *data, const int fcc_file, const char *path,
+                                uint64_t *rows);
+
+/* Internal sink prototypes */
+int ham_sink_convert_file(const ham_fcc_file *data, const int fcc_file, ham_fcc_sink *sink,
+                            const int threads, const size_t chunk_size, uint64_t *rows);
+int ham_sink_convert_chunks(const ham_fcc_file *data, const int num_fields, ham_fcc_sink *sink,
+                            const size_t chunk_size, uint64_t *rows);
+int ham_sink_convert_pipelined(const ham_fcc_file *data, const int num_fields,
+                                ham_fcc_sink *sink, const int threads, const size_t chunk_size,
+                                uint64_t *rows);
+int ham_sink_column_type(const char type);
+
+/* Internal callsign index prototypes */
+int ham_sqlite_write_callsign_index(ham_fcc_sqlite *fcc_sqlite, const char *path);
+int ham_sqlite_callsign_compare(const void *a, const void *b);
+
+/* Seconds on a monotonic clock, for timing the steps of a conversion */
+double ham_seconds(void) {
+#if defined(OS_WIN)
+    LARGE_INTEGER frequency, counter;
 
-int ham_sqlite_init_time(ham_fcc_sqlite *fcc_sqlite) {
-    time_t rawtime;
-    struct tm *timeinfo;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
 
-    time(&rawtime);
-    timeinfo = gmtime(&rawtime);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
 
-    strftime(fcc_sqlite->time, 80, "%Y-%m-%d %H:%M:%S", timeinfo);
+    clock_gettime(CLOCK_MONOTONIC, &now);
 
-    return HAM_OK;
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#endif
 }
 
-/*
- * Handles the memory allocation of the array of char arrays for holding the fields in the FCC
- * files.
- */
-int ham_alloc_string_array(char ***array, const int num_fields, const int num_char) {
-    /* Allocate the pointer to pointers */
-    (*array) = malloc(sizeof(char*) * num_fields);
-    if((*array) == NULL)
-        return HAM_ERROR_MALLOC_FAIL;
-    memset((*array), HAM_NULL_CHAR, sizeof(char*) * num_fields);
-
-    for(int i = 0; i < num_fields; i++) {
-        (*array)[i] = malloc(sizeof(char) * num_char);
-
-        if((*array)[i] == NULL) {
-            /* Clean up if an allocation fails */
-            /* This will not free the array if it's the first */
-            for(int j = 0; j < i; j++)
-                free((*array)[j]);
-
-            free((*array));
-
-            return HAM_ERROR_MALLOC_FAIL;
-        }
+/* Prints the number of records loaded and how fast they went in */
+void ham_sqlite_report_load(const ham_fcc_sqlite *fcc_sqlite, const double start) {
+    double elapsed = ham_seconds() - start;
 
-        /* If we don't set the memory to null, shit goes down later. */
-        memset((*array)[i], HAM_NULL_CHAR, sizeof(char) * HAM_BUFFER_SIZE);
-    }
+    printf("Records inserted: %u\n", fcc_sqlite->sql_insert_calls);
+    printf("Load time: %.2f s, %.0f records/s\n", elapsed,
+            elapsed > 0 ? fcc_sqlite->sql_insert_calls / elapsed : 0.0);
 
-    return HAM_OK;
+    if(fcc_sqlite->commits > 0)
+        printf("Commits: %u\n", fcc_sqlite->commits + 1);
 }
 
-/* Free the array of char arrays we allocated for holding the data fields */
-int ham_free_string_array(char ***array, const int num_fields, const int num_char) {
-    for(int i = 0; i < num_fields; i++)
-        free((*array)[i]);
+int ham_sqlite_init_time(ham_fcc_sqlite *fcc_sqlite) {
+    time_t rawtime;
+    struct tm *timeinfo;
+
+    time(&rawtime);
+    timeinfo = gmtime(&rawtime);
 
-    free((*array));
+    strftime(fcc_sqlite->time, 80, "%Y-%m-%d %H:%M:%S", timeinfo);
 
     return HAM_OK;
 }
 
-int ham_parse_line_with_delimiter(char **fields, const char *line, const int num_fields,
-                                const char *delimiter) {
-    const char *begin, *end;
-    char buffer[HAM_BUFFER_SIZE];
-    int field = 0, ctr = 0;
-
-    /* The fields must be reset or the unwanted data will be appended to many fields */
-    for(int i = 0; i < num_fields; i++)
-        memset(fields[i], HAM_NULL_CHAR, HAM_BUFFER_SIZE);
-
-    begin = line;
-
-    while (!ctr) {
-        memset(buffer, HAM_NULL_CHAR, sizeof(char) * HAM_BUFFER_SIZE);
-
-        end = strpbrk(begin, delimiter);
+/*
+ * Points the field views at the fields of a split record. Nothing is copied; the views are only
+ * valid as long as the record is. Fields missing from the record are left empty.
+ */
+int ham_parse_record(ham_field *fields, const ham_record *record, const int num_fields) {
+    int found = record->num_fields;
 
-        if(end == NULL) {
-            strncpy(buffer, begin, strlen(begin));
+    if(found > HAM_SPLIT_MAX_FIELDS)
+        found = HAM_SPLIT_MAX_FIELDS;
 
-            ctr++;
+    for(int i = 0; i < num_fields; i++) {
+        if(i < found) {
+            fields[i].data = ham_record_field(record, i);
+            fields[i].length = ham_record_field_length(record, i);
         } else {
-            strncpy(buffer, begin, (end - begin));
-            begin = end + 1;
+            fields[i].data = NULL;
+            fields[i].length = 0;
         }
-
-        if(strlen(buffer) == 0)
-            fields[field][0] = '\0';
-        else
-            strncpy(fields[field], buffer, strlen(buffer));
-
-        /*printf("Begin: %p\n", begin);
-        printf("End: %p\n", end);
-        printf("Token: %s\n", fields[field]);
-        printf("Length: %zd\n\n", strlen(buffer));*/
-        field++;
     }
 
     return HAM_OK;
 }
 
-/* Returns the number of lines in a file. If there's an error, -1 is returned. */
-INT64 ham_get_lines_in_file(FILE *file) {
-    if(file == NULL)
-        return -1;
-
-    INT64 lines = 0;
-    char buffer[HAM_BUFFER_SIZE];
-
-    /* Set file position to the beginning, possibly losing the position of the caller */
-    rewind(file);
-
-    do {
-        fgets(buffer, HAM_BUFFER_SIZE, file);
-        lines++;
-    } while(!feof(file));
-
-    rewind(file);
-    return lines;
-}
-
 char *fcc_directory(char *directory) {
     char *result = malloc(sizeof(char) * 256);
     memset(result, '\0', 256);
@@ -779,586 +1428,3975 @@ char *fcc_directory(char *directory) {
     return strncpy(result, directory, 249);
 }
 
-void ham_fcc_close_all(ham_fcc_database *database) {
-    if(database->am_open == HAM_BOOL_YES) {
-        fclose(database->am);
-        database->am_open = HAM_BOOL_NO;
-    }
-
-    if(database->en_open == HAM_BOOL_YES) {
-        fclose(database->en);
-        database->en_open = HAM_BOOL_NO;
-    }
-
-    if(database->hd_open == HAM_BOOL_YES) {
-        fclose(database->hd);
-        database->hd_open = HAM_BOOL_NO;
-    }
-
-    if(database->hs_open == HAM_BOOL_YES) {
-        fclose(database->hs);
-        database->hs_open = HAM_BOOL_NO;
-    }
+int ham_fcc_file_open(ham_fcc_file *file, const char *path) {
+    memset(file, 0, sizeof(ham_fcc_file));
 
-    if(database->co_open == HAM_BOOL_YES) {
-        fclose(database->co);
-        database->co_open = HAM_BOOL_NO;
-    }
+    file->file = fopen(path, "rb");
+    if(file->file == NULL)
+        return HAM_ERROR_OPEN_FILE;
 
-    if(database->la_open == HAM_BOOL_YES) {
-        fclose(database->la);
-        database->la_open = HAM_BOOL_NO;
-    }
+    file->open = HAM_BOOL_YES;
+    file->size = -1;
 
-    if(database->sc_open == HAM_BOOL_YES) {
-        fclose(database->sc);
-        database->sc_open = HAM_BOOL_NO;
+    /* Not being able to map the file is fine; the reader will use the FILE* instead. */
+    if(ham_fcc_file_map(file) != HAM_OK && !fseek(file->file, 0, SEEK_END)) {
+        file->size = ftell(file->file);
+        rewind(file->file);
     }
 
-    if(database->sf_open == HAM_BOOL_YES) {
-        fclose(database->sf);
-        database->sf_open = HAM_BOOL_NO;
-    }
+    return HAM_OK;
 }
 
-LIBHAMDATA_API int ham_fcc_database_init(ham_fcc_database **database, char *directory) {
-    int filesopen = 0;
-    char buffer[256] = "";
+/* Opens a member of a zip archive, which is inflated as it is read */
+int ham_fcc_file_open_zip(ham_fcc_file *file, const char *path, const ham_zip_member *member) {
+    int error;
 
-    (*database) = malloc(sizeof(ham_fcc_database));
-    if((*database) == NULL)
-        return HAM_ERROR_MALLOC_FAIL;
+    memset(file, 0, sizeof(ham_fcc_file));
 
-    (*database)->fcc_lengths = malloc(sizeof(ham_fcc_lengths));
-    if((*database)->fcc_lengths == NULL) {
-        free(*database);
-        return HAM_ERROR_MALLOC_FAIL;
-    }
+    error = ham_zip_stream_open(&file->zip, path, member);
+    if(error != HAM_OK)
+        return error;
 
-    (*database)->directory = fcc_directory(directory);
+    file->open = HAM_BOOL_YES;
+    file->size = member->size;
 
-    /* Initialize the open indicators to closed */
-    (*database)->am_open = HAM_BOOL_NO;
-    (*database)->en_open = HAM_BOOL_NO;
-    (*database)->hd_open = HAM_BOOL_NO;
-    (*database)->hs_open = HAM_BOOL_NO;
-    (*database)->co_open = HAM_BOOL_NO;
-    (*database)->la_open = HAM_BOOL_NO;
-    (*database)->sc_open = HAM_BOOL_NO;
-    (*database)->sf_open = HAM_BOOL_NO;
+    return HAM_OK;
+}
 
-    /* Open all FCC files */
+/* Opens a file that is read from a callback, e.g. a pipe. The size is not known. */
+int ham_fcc_file_open_source(ham_fcc_file *file, ham_fcc_read_callback read, void *context) {
+    memset(file, 0, sizeof(ham_fcc_file));
 
-    strncpy(buffer, (*database)->directory, 255);
-    (*database)->am = fopen(strncat(buffer, FCC_FILENAMES[HAM_FCC_FILE_AM], 6), "r");
-    if((*database)->am != NULL) {
-        (*database)->am_open = HAM_BOOL_YES;
-        (*database)->fcc_lengths->am_length = ham_get_lines_in_file((*database)->am);
-        filesopen++;
-    }
+    file->source = calloc(1, sizeof(ham_fcc_source));
+    if(file->source == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
 
-    strncpy(buffer, (*database)->directory, 255);
-    (*database)->en = fopen(strncat(buffer, FCC_FILENAMES[HAM_FCC_FILE_EN], 6), "r");
-    if((*database)->en != NULL) {
-        (*database)->en_open = HAM_BOOL_YES;
-        (*database)->fcc_lengths->en_length = ham_get_lines_in_file((*database)->en);
-        filesopen++;
-    }
+    file->source->read = read;
+    file->source->context = context;
+    file->open = HAM_BOOL_YES;
+    file->size = -1;
 
-    strncpy(buffer, (*database)->directory, 255);
-    (*database)->hd = fopen(strncat(buffer, FCC_FILENAMES[HAM_FCC_FILE_HD], 6), "r");
-    if((*database)->hd != NULL) {
-        (*database)->hd_open = HAM_BOOL_YES;
-        (*database)->fcc_lengths->hd_length = ham_get_lines_in_file((*database)->hd);
-        filesopen++;
-    }
+    return HAM_OK;
+}
 
-    strncpy(buffer, (*database)->directory, 255);
-    (*database)->hs = fopen(strncat(buffer, FCC_FILENAMES[HAM_FCC_FILE_HS], 6), "r");
-    if((*database)->hs != NULL) {
-        (*database)->hs_open = HAM_BOOL_YES;
-        (*database)->fcc_lengths->hs_length = ham_get_lines_in_file((*database)->hs);
-        filesopen++;
-    }
+/* Identifier of a file name such as "AM.dat", or just the record type "AM". 0 if it is not ours. */
+int ham_fcc_file_index(const char *name) {
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        const char *fcc_name = FCC_FILENAMES[i];
+        int j;
 
-    strncpy(buffer, (*database)->directory, 255);
-    (*database)->co = fopen(strncat(buffer, FCC_FILENAMES[HAM_FCC_FILE_CO], 6), "r");
-    if((*database)->co != NULL) {
-        (*database)->co_open = HAM_BOOL_YES;
-        (*database)->fcc_lengths->co_length = ham_get_lines_in_file((*database)->co);
-        filesopen++;
-    }
+        for(j = 0; name[j] != '\0' && toupper((unsigned char)name[j]) ==
+                toupper((unsigned char)fcc_name[j]); j++)
+            ;
 
-    strncpy(buffer, (*database)->directory, 255);
-    (*database)->la = fopen(strncat(buffer, FCC_FILENAMES[HAM_FCC_FILE_LA], 6), "r");
-    if((*database)->la != NULL) {
-        (*database)->la_open = HAM_BOOL_YES;
-        (*database)->fcc_lengths->la_length = ham_get_lines_in_file((*database)->la);
-        filesopen++;
-    }
+        if(fcc_name[j] == '\0' && name[j] == '\0')
+            return i;
 
-    strncpy(buffer, (*database)->directory, 255);
-    (*database)->sc = fopen(strncat(buffer, FCC_FILENAMES[HAM_FCC_FILE_SC], 6), "r");
-    if((*database)->sc != NULL) {
-        (*database)->sc_open = HAM_BOOL_YES;
-        (*database)->fcc_lengths->sc_length = ham_get_lines_in_file((*database)->sc);
-        filesopen++;
+        /* The record type alone, e.g. "AM" for "AM.dat" */
+        if(j == 2 && name[j] == '\0')
+            return i;
     }
 
-    strncpy(buffer, (*database)->directory, 255);
-    (*database)->sf = fopen(strncat(buffer, FCC_FILENAMES[HAM_FCC_FILE_SF], 6), "r");
-    if((*database)->sf != NULL) {
-        (*database)->sf_open = HAM_BOOL_YES;
-        (*database)->fcc_lengths->sf_length = ham_get_lines_in_file((*database)->sf);
-        filesopen++;
-    }
+    return 0;
+}
 
-    if(filesopen < 8) {
-        ham_fcc_terminate(*database);
+/* Identifier of the file a record belongs to, from its record type field. 0 if unknown. */
+int ham_fcc_record_type(const ham_record *record) {
+    if(record->num_fields < 1 || ham_record_field_length(record, 0) != 2)
+        return 0;
 
-        return HAM_ERROR_OPEN_FILE;
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        if(!memcmp(ham_record_field(record, 0), FCC_FILENAMES[i], 2))
+            return i;
     }
 
-    return HAM_OK;
+    return 0;
 }
 
-LIBHAMDATA_API int ham_fcc_terminate(ham_fcc_database *database) {
-
-    /* Can be safely called if already freed. */
-    if(database == NULL)
-        return HAM_OK;
+/*
+ * Maps the whole file read only and tells the kernel we will read it front to back. Pipes, empty
+ * files and platforms without mmap are left on the FILE* path.
+ */
+int ham_fcc_file_map(ham_fcc_file *file) {
+    if(ham_map_stream(&file->map, file->file) != HAM_OK)
+        return HAM_ERROR_GENERIC;
 
-    ham_fcc_close_all(database);
+#if defined(OS_GENERIC)
+    madvise((void *)file->map.data, file->map.size, MADV_SEQUENTIAL);
+#endif
 
-    free(database->directory);
-    free(database->fcc_lengths);
-    free(database);
+    file->size = (INT64)file->map.size;
 
     return HAM_OK;
 }
 
 /*
- * Convert the FCC's text database to SQLite.
- *
+ * Gives the pages of a mapped file from *released up to end back to the kernel, and moves *released
+ * on to where they stop. The mapping is read only, so a page that is read again is simply faulted
+ * back in from the file.
+ */
+void ham_fcc_file_release(const char **released, const char *end) {
+#if defined(OS_GENERIC)
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    const char *until = (const char *)((uintptr_t)end / page * page);
+
+    if(until > *released) {
+        madvise((void *)*released, (size_t)(until - *released), MADV_DONTNEED);
+        *released = until;
+    }
+#else
+    (void)released;
+    (void)end;
+#endif
+}
+
+void ham_fcc_file_close(ham_fcc_file *file) {
+    if(file->map.mapped == HAM_BOOL_YES)
+        ham_map_close(&file->map);
+
+    if(file->zip != NULL) {
+        ham_zip_stream_close(file->zip);
+        file->zip = NULL;
+    }
+
+    free(file->source);
+    file->source = NULL;
+
+    if(file->open == HAM_BOOL_YES) {
+        if(file->file != NULL)
+            fclose(file->file);
+        file->open = HAM_BOOL_NO;
+    }
+}
+
+/* Reads from a file that is not mapped. Fewer than size bytes are only read at the end. */
+int ham_fcc_file_read(const ham_fcc_file *file, char *buffer, const size_t size, size_t *read) {
+    INT64 count;
+
+    if(file->zip != NULL)
+        return ham_zip_stream_read(file->zip, buffer, size, read);
+
+    /* A pipe hands out what it has; keep reading so a short read still means the end */
+    if(file->source != NULL) {
+        for(*read = 0; *read < size; *read += (size_t)count) {
+            count = file->source->read(file->source->context, buffer + *read, size - *read);
+            if(count < 0)
+                return HAM_ERROR_GENERIC;
+            if(count == 0)
+                break;
+
+            file->source->started = HAM_BOOL_YES;
+        }
+
+        return HAM_OK;
+    }
+
+    *read = fread(buffer, 1, size, file->file);
+    if(*read < size && ferror(file->file))
+        return HAM_ERROR_GENERIC;
+
+    return HAM_OK;
+}
+
+/*
+ * Reads past the first offset bytes of a file that is not mapped, from the start. A zip member or
+ * a stream cannot seek, so the bytes are read and dropped. Fails if the file is shorter.
+ */
+int ham_fcc_file_skip(const ham_fcc_file *file, const INT64 offset) {
+    char *buffer;
+    size_t size, read;
+    INT64 skipped = 0;
+    int error = HAM_OK;
+
+    if(offset <= 0)
+        return HAM_OK;
+
+    /* A long is 32 bits on Windows, so plain fseek cannot reach past 2 GiB there */
+    if(file->zip == NULL && file->source == NULL) {
+#if defined(OS_WIN)
+        error = _fseeki64(file->file, offset, SEEK_SET);
+#else
+        error = fseeko(file->file, (off_t)offset, SEEK_SET);
+#endif
+        return error ? HAM_ERROR_GENERIC : HAM_OK;
+    }
+
+    buffer = malloc(HAM_READ_BUFFER_SIZE);
+    if(buffer == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    while(error == HAM_OK && skipped < offset) {
+        size = offset - skipped < HAM_READ_BUFFER_SIZE ? (size_t)(offset - skipped) :
+                HAM_READ_BUFFER_SIZE;
+
+        error = ham_fcc_file_read(file, buffer, size, &read);
+        if(error == HAM_OK && read < size)
+            error = HAM_ERROR_GENERIC;
+
+        skipped += read;
+    }
+
+    free(buffer);
+
+    return error;
+}
+
+int ham_fcc_file_rewind(const ham_fcc_file *file) {
+    if(file->zip != NULL)
+        return ham_zip_stream_rewind(file->zip);
+
+    /* Nothing to do before the first read, and impossible after it */
+    if(file->source != NULL)
+        return file->source->started == HAM_BOOL_YES ? HAM_ERROR_GENERIC : HAM_OK;
+
+    rewind(file->file);
+
+    return HAM_OK;
+}
+
+void ham_fcc_close_all(ham_fcc_database *database) {
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++)
+        ham_fcc_file_close(&database->files[i]);
+}
+
+int ham_fcc_reader_init(ham_fcc_reader *reader, const ham_fcc_file *file) {
+    memset(reader, 0, sizeof(ham_fcc_reader));
+    reader->source = file;
+
+    if(file->map.mapped == HAM_BOOL_YES) {
+        reader->begin = file->map.data;
+        reader->end = file->map.data + file->size;
+        reader->released = file->map.data;
+        reader->eof = HAM_BOOL_YES;
+
+        return HAM_OK;
+    }
+
+    reader->buffer = malloc(HAM_READ_BUFFER_SIZE);
+    if(reader->buffer == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    reader->buffer_size = HAM_READ_BUFFER_SIZE;
+    reader->begin = reader->buffer;
+    reader->end = reader->buffer;
+
+    return ham_fcc_file_rewind(file);
+}
+
+/*
+ * Splits the next record out of the file. The record points into the mapping or the read buffer and
+ * stays valid until the next call. HAM_ERROR_GENERIC is returned at the end of the file, and the
+ * error of a failed read is left in the reader.
+ */
+int ham_fcc_reader_next_record(ham_fcc_reader *reader, ham_record *record) {
+    const char *next;
+    size_t remaining, read;
+
+    /* The records before this one are done with */
+    if(reader->release > 0 && reader->released != NULL
+            && (size_t)(reader->begin - reader->released) >= reader->release)
+        ham_fcc_file_release(&reader->released, reader->begin);
+
+    for(;;) {
+        if(reader->begin == reader->end && reader->eof == HAM_BOOL_YES)
+            return HAM_ERROR_GENERIC;
+
+        next = ham_split_record(reader->begin, reader->end, HAM_DELIMITER, record);
+        if(next != NULL) {
+            reader->offset += next - reader->begin;
+            reader->begin = next;
+            return HAM_OK;
+        }
+
+        /* The last line of the file has no new line */
+        if(reader->eof == HAM_BOOL_YES) {
+            reader->offset += reader->end - reader->begin;
+            reader->begin = reader->end;
+            return HAM_OK;
+        }
+
+        /* Move the partial record to the front and refill the rest of the buffer */
+        remaining = reader->end - reader->begin;
+        memmove(reader->buffer, reader->begin, remaining);
+
+        /* A record longer than the whole buffer; grow it */
+        if(remaining == reader->buffer_size) {
+            char *buffer = realloc(reader->buffer, reader->buffer_size * 2);
+            if(buffer == NULL)
+                return HAM_ERROR_MALLOC_FAIL;
+
+            reader->buffer = buffer;
+            reader->buffer_size *= 2;
+        }
+
+        reader->error = ham_fcc_file_read(reader->source, reader->buffer + remaining,
+                                            reader->buffer_size - remaining, &read);
+        if(reader->error != HAM_OK)
+            return HAM_ERROR_GENERIC;
+
+        if(read < reader->buffer_size - remaining)
+            reader->eof = HAM_BOOL_YES;
+
+        remaining += read;
+
+        reader->begin = reader->buffer;
+        reader->end = reader->buffer + remaining;
+    }
+}
+
+/* Starts the reader at a byte offset of the file, which must be the start of a record */
+int ham_fcc_reader_seek(ham_fcc_reader *reader, const INT64 offset) {
+    const ham_fcc_file *file = reader->source;
+    int error;
+
+    if(file->map.mapped == HAM_BOOL_YES) {
+        if(offset < 0 || offset > file->size)
+            return HAM_ERROR_GENERIC;
+
+        reader->begin = file->map.data + offset;
+        reader->offset = offset;
+
+        return HAM_OK;
+    }
+
+    error = ham_fcc_file_skip(file, offset);
+    if(error == HAM_OK)
+        reader->offset = offset;
+
+    return error;
+}
+
+void ham_fcc_reader_terminate(ham_fcc_reader *reader) {
+    free(reader->buffer);
+    reader->buffer = NULL;
+}
+
+/* Parses one chunk into the batch, growing the batch if it is too small */
+int ham_batch_parse(ham_batch *batch, const char *begin, const char *end, const int num_fields) {
+    ham_record record;
+
+    batch->rows = 0;
+    batch->num_lines = 0;
+
+    while(begin != NULL && begin < end) {
+        begin = ham_split_record(begin, end, HAM_DELIMITER, &record);
+        batch->num_lines++;
+
+        /* Blank lines, usually a trailing one, are not records */
+        if(record.length == 0)
+            continue;
+
+        if(batch->rows == batch->capacity) {
+            int capacity = batch->capacity ? batch->capacity * 2 : 1024;
+            ham_field *fields = realloc(batch->fields,
+                                        sizeof(ham_field) * num_fields * capacity);
+            unsigned int *lines;
+
+            if(fields == NULL)
+                return HAM_ERROR_MALLOC_FAIL;
+            batch->fields = fields;
+
+            lines = realloc(batch->lines, sizeof(unsigned int) * capacity);
+            if(lines == NULL)
+                return HAM_ERROR_MALLOC_FAIL;
+            batch->lines = lines;
+
+            batch->capacity = capacity;
+        }
+
+        ham_parse_record(&batch->fields[batch->rows * num_fields], &record, num_fields);
+        batch->lines[batch->rows] = batch->num_lines;
+        batch->rows++;
+    }
+
+    return HAM_OK;
+}
+
+/*
+ * Sets up the reader state on a file, from a byte offset that is the start of a record. Without
+ * any stages started, ham_pipeline_next_chunk can then be called on the caller's own thread.
+ */
+int ham_pipeline_init(ham_pipeline *pipeline, const ham_fcc_file *file, const int num_fields,
+                        const size_t chunk_size, const INT64 offset) {
+    memset(pipeline, 0, sizeof(ham_pipeline));
+
+    pipeline->file = file;
+    pipeline->num_fields = num_fields;
+    pipeline->chunk_size = chunk_size;
+    pipeline->position = file->map.data;
+    pipeline->offset = offset;
+
+    if(file->map.mapped == HAM_BOOL_YES) {
+        if(offset < 0 || offset > file->size)
+            return HAM_ERROR_GENERIC;
+
+        pipeline->position = file->map.data + offset;
+    } else if(ham_fcc_file_rewind(file) != HAM_OK || ham_fcc_file_skip(file, offset) != HAM_OK) {
+        return HAM_ERROR_GENERIC;
+    }
+
+    return HAM_OK;
+}
+
+/* Starts the stages on a file, from a byte offset that is the start of a record */
+int ham_pipeline_start(ham_pipeline *pipeline, const ham_fcc_file *file, const int num_fields,
+                        const int num_parsers, const size_t chunk_size, const INT64 offset) {
+    int error;
+
+    error = ham_pipeline_init(pipeline, file, num_fields, chunk_size, offset);
+    if(error != HAM_OK)
+        return error;
+
+    pipeline->parsers = calloc(num_parsers, sizeof(ham_parser));
+    if(pipeline->parsers == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    pipeline->num_parsers = num_parsers;
+
+    for(int i = 0; i < num_parsers && error == HAM_OK; i++) {
+        ham_parser *parser = &pipeline->parsers[i];
+
+        parser->pipeline = pipeline;
+
+        error = ham_ring_init(&parser->input, HAM_PIPELINE_DEPTH);
+        if(error == HAM_OK)
+            error = ham_ring_init(&parser->output, HAM_PIPELINE_DEPTH);
+        if(error == HAM_OK)
+            error = ham_ring_init(&parser->free, HAM_PIPELINE_DEPTH);
+
+        /* Every slot starts out free for the reader */
+        for(int j = 0; j < HAM_PIPELINE_DEPTH && error == HAM_OK; j++)
+            ham_ring_push(&parser->free, &parser->slots[j], &pipeline->abort);
+    }
+
+    if(error != HAM_OK) {
+        ham_pipeline_stop(pipeline);
+        return error;
+    }
+
+    /* Pick the splitter before the parsers race to do it */
+    ham_split_implementation();
+
+    for(int i = 0; i < num_parsers; i++) {
+        if(ham_thread_create(&pipeline->parsers[i].thread, ham_pipeline_parser_main,
+                                &pipeline->parsers[i]) != HAM_OK) {
+            ham_pipeline_stop(pipeline);
+            return HAM_ERROR_GENERIC;
+        }
+
+        pipeline->started++;
+    }
+
+    if(ham_thread_create(&pipeline->reader, ham_pipeline_reader_main, pipeline) != HAM_OK) {
+        ham_pipeline_stop(pipeline);
+        return HAM_ERROR_GENERIC;
+    }
+
+    pipeline->reader_started = HAM_BOOL_YES;
+
+    return HAM_OK;
+}
+
+/* Joins the stages and frees the pipeline. Stages still running are stopped through abort. */
+void ham_pipeline_stop(ham_pipeline *pipeline) {
+    if(pipeline->reader_started != HAM_BOOL_YES || pipeline->started < pipeline->num_parsers)
+        ham_ring_abort(&pipeline->abort);
+
+    if(pipeline->reader_started == HAM_BOOL_YES)
+        ham_thread_join(pipeline->reader);
+
+    for(int i = 0; i < pipeline->started; i++)
+        ham_thread_join(pipeline->parsers[i].thread);
+
+    for(int i = 0; i < pipeline->num_parsers; i++) {
+        ham_parser *parser = &pipeline->parsers[i];
+
+        for(int j = 0; j < HAM_PIPELINE_DEPTH; j++) {
+            free(parser->slots[j].buffer);
+            free(parser->slots[j].batch.fields);
+            free(parser->slots[j].batch.lines);
+        }
+
+        ham_ring_destroy(&parser->input);
+        ham_ring_destroy(&parser->output);
+        ham_ring_destroy(&parser->free);
+    }
+
+    free(pipeline->parsers);
+    pipeline->parsers = NULL;
+
+    free(pipeline->carry);
+    pipeline->carry = NULL;
+}
+
+/*
+ * Fills the slot with the next run of whole records, or marks it last at the end of the file. A
+ * mapped file is only cut at a new line; a read file is copied into the slot's buffer, and the
+ * partial record at the end is kept back for the next chunk.
+ */
+int ham_pipeline_next_chunk(ham_pipeline *pipeline, ham_slot *slot) {
+    const ham_fcc_file *file = pipeline->file;
+    const char *end;
+    size_t length, keep, read;
+    int error;
+
+    slot->last = HAM_BOOL_NO;
+    slot->batch.error = HAM_OK;
+
+    if(file->map.mapped == HAM_BOOL_YES) {
+        end = file->map.data + file->size;
+
+        if(pipeline->position == end) {
+            slot->last = HAM_BOOL_YES;
+            return HAM_OK;
+        }
+
+        if((size_t)(end - pipeline->position) > pipeline->chunk_size) {
+            const char *newline = memchr(pipeline->position + pipeline->chunk_size - 1, '\n',
+                                            end - (pipeline->position + pipeline->chunk_size - 1));
+            if(newline != NULL)
+                end = newline + 1;
+        }
+
+        slot->begin = pipeline->position;
+        slot->end = end;
+        pipeline->position = end;
+
+        pipeline->offset += slot->end - slot->begin;
+        slot->offset = pipeline->offset;
+
+        return HAM_OK;
+    }
+
+    if(slot->buffer_size < pipeline->carry_length + pipeline->chunk_size) {
+        char *buffer = realloc(slot->buffer, pipeline->carry_length + pipeline->chunk_size);
+        if(buffer == NULL)
+            return HAM_ERROR_MALLOC_FAIL;
+
+        slot->buffer = buffer;
+        slot->buffer_size = pipeline->carry_length + pipeline->chunk_size;
+    }
+
+    if(pipeline->carry_length > 0)
+        memcpy(slot->buffer, pipeline->carry, pipeline->carry_length);
+    length = pipeline->carry_length;
+    pipeline->carry_length = 0;
+
+    for(;;) {
+        if(pipeline->eof != HAM_BOOL_YES) {
+            error = ham_fcc_file_read(file, slot->buffer + length, slot->buffer_size - length,
+                                        &read);
+            if(error != HAM_OK)
+                return error;
+
+            if(read < slot->buffer_size - length)
+                pipeline->eof = HAM_BOOL_YES;
+
+            length += read;
+        }
+
+        /* The rest of the file is the last chunk, whether or not it ends in a new line */
+        if(pipeline->eof == HAM_BOOL_YES) {
+            keep = 0;
+            break;
+        }
+
+        for(keep = 0; keep < length && slot->buffer[length - keep - 1] != '\n'; keep++)
+            ;
+        if(keep < length)
+            break;
+
+        /* A record longer than the whole buffer; grow it */
+        {
+            char *buffer = realloc(slot->buffer, slot->buffer_size * 2);
+            if(buffer == NULL)
+                return HAM_ERROR_MALLOC_FAIL;
+
+            slot->buffer = buffer;
+            slot->buffer_size *= 2;
+        }
+    }
+
+    if(length == 0) {
+        slot->last = HAM_BOOL_YES;
+        return HAM_OK;
+    }
+
+    if(keep > 0) {
+        if(pipeline->carry_size < keep) {
+            char *carry = realloc(pipeline->carry, keep);
+            if(carry == NULL)
+                return HAM_ERROR_MALLOC_FAIL;
+
+            pipeline->carry = carry;
+            pipeline->carry_size = keep;
+        }
+
+        memcpy(pipeline->carry, slot->buffer + length - keep, keep);
+        pipeline->carry_length = keep;
+    }
+
+    slot->begin = slot->buffer;
+    slot->end = slot->buffer + length - keep;
+
+    pipeline->offset += slot->end - slot->begin;
+    slot->offset = pipeline->offset;
+
+    return HAM_OK;
+}
+
+/*
+ * Deals the chunks out to the parsers. Once the file is done every parser is sent a last slot,
+ * starting with the one the writer will look at next, so they all stop.
+ */
+void ham_pipeline_reader_main(void *argument) {
+    ham_pipeline *pipeline = argument;
+    ham_parser *parser;
+    ham_slot *slot;
+    INT64 chunk = 0;
+    int error;
+
+    do {
+        parser = &pipeline->parsers[chunk++ % pipeline->num_parsers];
+
+        slot = ham_ring_pop(&parser->free, &pipeline->abort);
+        if(slot == NULL)
+            return;
+
+        error = ham_pipeline_next_chunk(pipeline, slot);
+        if(error != HAM_OK) {
+            slot->last = HAM_BOOL_YES;
+            slot->batch.error = error;
+        }
+
+        if(ham_ring_push(&parser->input, slot, &pipeline->abort) != HAM_OK)
+            return;
+    } while(slot->last != HAM_BOOL_YES);
+
+    for(int i = 1; i < pipeline->num_parsers; i++) {
+        parser = &pipeline->parsers[chunk++ % pipeline->num_parsers];
+
+        slot = ham_ring_pop(&parser->free, &pipeline->abort);
+        if(slot == NULL)
+            return;
+
+        slot->last = HAM_BOOL_YES;
+        slot->batch.error = HAM_OK;
+
+        if(ham_ring_push(&parser->input, slot, &pipeline->abort) != HAM_OK)
+            return;
+    }
+}
+
+void ham_pipeline_parser_main(void *argument) {
+    ham_parser *parser = argument;
+    ham_pipeline *pipeline = parser->pipeline;
+    ham_slot *slot;
+    int last;
+
+    do {
+        slot = ham_ring_pop(&parser->input, &pipeline->abort);
+        if(slot == NULL)
+            return;
+
+        /* The slot belongs to the writer once it is pushed */
+        last = slot->last;
+
+        if(last != HAM_BOOL_YES)
+            slot->batch.error = ham_batch_parse(&slot->batch, slot->begin, slot->end,
+                                                pipeline->num_fields);
+
+        if(ham_ring_push(&parser->output, slot, &pipeline->abort) != HAM_OK)
+            return;
+    } while(last != HAM_BOOL_YES);
+}
+
+LIBHAMDATA_API int ham_fcc_database_init(ham_fcc_database **database, char *directory) {
+    int filesopen = 0;
+    char buffer[256] = "";
+
+    (*database) = malloc(sizeof(ham_fcc_database));
+    if((*database) == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    (*database)->directory = fcc_directory(directory);
+
+    /* Open all FCC files */
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        strncpy(buffer, (*database)->directory, 255);
+        strncat(buffer, FCC_FILENAMES[i], 6);
+
+        if(ham_fcc_file_open(&(*database)->files[i], buffer) == HAM_OK)
+            filesopen++;
+    }
+
+    if(filesopen < HAM_FCC_FILE_COUNT) {
+        ham_fcc_terminate(*database);
+
+        return HAM_ERROR_OPEN_FILE;
+    }
+
+    return HAM_OK;
+}
+
+/*
+ * Opens the record files straight out of an FCC zip archive such as l_amat.zip. Each member is
+ * inflated as it is converted, so nothing is extracted to disk.
+ */
+LIBHAMDATA_API int ham_fcc_database_init_zip(ham_fcc_database **database, const char *path) {
+    const ham_zip_member *member;
+    ham_zip zip;
+    int error;
+
+    error = ham_zip_open(&zip, path);
+    if(error != HAM_OK)
+        return error;
+
+    (*database) = calloc(1, sizeof(ham_fcc_database));
+    if((*database) == NULL) {
+        ham_zip_close(&zip);
+        return HAM_ERROR_MALLOC_FAIL;
+    }
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT && error == HAM_OK; i++) {
+        member = ham_zip_find(&zip, FCC_FILENAMES[i]);
+        if(member == NULL) {
+            error = HAM_ERROR_OPEN_FILE;
+            break;
+        }
+
+        error = ham_fcc_file_open_zip(&(*database)->files[i], path, member);
+    }
+
+    ham_zip_close(&zip);
+
+    if(error != HAM_OK) {
+        ham_fcc_terminate(*database);
+        return error;
+    }
+
+    return HAM_OK;
+}
+
+LIBHAMDATA_API int ham_fcc_database_init_streams(ham_fcc_database **database) {
+    (*database) = calloc(1, sizeof(ham_fcc_database));
+    if((*database) == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    return HAM_OK;
+}
+
+LIBHAMDATA_API int ham_fcc_database_add_callback(ham_fcc_database *database, const char *name,
+                                                    ham_fcc_read_callback read, void *context) {
+    int fcc_file = ham_fcc_file_index(name);
+
+    if(fcc_file == 0)
+        return HAM_ERROR_GENERIC;
+
+    ham_fcc_file_close(&database->files[fcc_file]);
+
+    return ham_fcc_file_open_source(&database->files[fcc_file], read, context);
+}
+
+LIBHAMDATA_API int ham_fcc_database_add_stream(ham_fcc_database *database, const char *name,
+                                                FILE *stream) {
+    return ham_fcc_database_add_callback(database, name, ham_fcc_read_file, stream);
+}
+
+LIBHAMDATA_API INT64 ham_fcc_read_file(void *stream, char *buffer, size_t size) {
+    size_t count = fread(buffer, 1, size, stream);
+
+    if(count == 0 && ferror((FILE *)stream))
+        return -1;
+
+    return (INT64)count;
+}
+
+LIBHAMDATA_API int ham_fcc_terminate(ham_fcc_database *database) {
+
+    /* Can be safely called if already freed. */
+    if(database == NULL)
+        return HAM_OK;
+
+    ham_fcc_close_all(database);
+
+    free(database->directory);
+    free(database);
+
+    return HAM_OK;
+}
+
+/* Fills in the defaults of every conversion option */
+LIBHAMDATA_API void ham_fcc_convert_options_init(ham_fcc_convert_options *options) {
+    memset(options, 0, sizeof(ham_fcc_convert_options));
+
+    options->threads = 0;
+    options->parallel_tables = HAM_BOOL_NO;
+    options->update = HAM_BOOL_NO;
+    options->indexes = HAM_BOOL_YES;
+    options->encode = HAM_BOOL_NO;
+    options->compact = HAM_BOOL_NO;
+    options->clustered = HAM_BOOL_NO;
+    options->licenses = HAM_BOOL_NO;
+    options->callsign_parts = HAM_BOOL_NO;
+    options->name_search = HAM_BOOL_NO;
+    options->in_memory = HAM_BOOL_NO;
+    options->callsign_index = NULL;
+
+    options->page_size = HAM_PAGE_SIZE;
+    options->cache_size = HAM_CACHE_SIZE;
+    options->index_cache_size = HAM_INDEX_CACHE_SIZE;
+    options->mmap_size = HAM_MMAP_SIZE;
+    options->temp_store = HAM_TEMP_STORE_DEFAULT;
+    options->journal_mode = HAM_JOURNAL_MODE;
+    options->synchronous = HAM_SYNCHRONOUS;
+    options->chunk_size = HAM_CHUNK_SIZE;
+
+    options->commit_rows = 0;
+    options->commit_bytes = 0;
+    options->resume = HAM_BOOL_NO;
+    options->memory_budget = 0;
+}
+
+/*
+ * Convert the FCC's text database to SQLite.
+ *
  * If HAM_SQLITE_FILENAME already exists, it will be overwritten.
  */
-LIBHAMDATA_API int ham_fcc_to_sqlite(const ham_fcc_database *fcc_database, const char *filename) {
+LIBHAMDATA_API int ham_fcc_to_sqlite(const ham_fcc_database *fcc_database, const char *filename) {
+    ham_fcc_convert_options options;
+
+    ham_fcc_convert_options_init(&options);
+
+    return ham_fcc_to_sqlite_ex(fcc_database, filename, &options);
+}
+
+LIBHAMDATA_API int ham_fcc_to_sqlite_ex(const ham_fcc_database *fcc_database, const char *filename,
+                                        const ham_fcc_convert_options *options) {
+
+    /*
+     * This variable contains all the data need for the conversion process. It is passed to multiple
+     * sub-functions.
+     */
+    ham_fcc_sqlite *fcc_sqlite;
+    int threads = options->threads > 0 ? options->threads : ham_cpu_count();
+    int error = HAM_OK;
+    double start = ham_seconds();
+
+    /*
+     * Only a plain load in batches keeps checkpoints. The table threads, the staged rows of the
+     * clustered layout and an in-memory database are not on disk until the end, and an update is
+     * one transaction anyway.
+     */
+    int checkpoints = (options->commit_rows > 0 || options->commit_bytes > 0)
+                        && options->parallel_tables != HAM_BOOL_YES
+                        && options->update != HAM_BOOL_YES && options->clustered != HAM_BOOL_YES
+                        && options->in_memory != HAM_BOOL_YES;
+
+    /* Conversion preparations */
+
+    if(filename == NULL)
+        filename = HAM_SQLITE_FILENAME;
+
+    if(options->resume == HAM_BOOL_YES && !checkpoints) {
+        fprintf(stderr, "Error: only a load in batches can be resumed, and not one that is an "
+                "update, clustered, in memory or split by table\n");
+        return HAM_ERROR_GENERIC;
+    }
+
+    if(ham_sqlite_init(&fcc_sqlite, filename, options))
+        return HAM_ERROR_SQLITE_INIT;
+
+    fcc_sqlite->encode = options->encode;
+    fcc_sqlite->compact = options->compact;
+    fcc_sqlite->clustered = options->clustered;
+    fcc_sqlite->callsign_parts = options->callsign_parts;
+    fcc_sqlite->name_search = options->name_search;
+
+    if(ham_sqlite_create_tables(fcc_sqlite))
+        return HAM_ERROR_SQLITE_CREATE_TABLES;
+
+    if(ham_sqlite_sql_prepare_stmt(fcc_sqlite))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    if(options->update == HAM_BOOL_YES)
+        error = ham_sqlite_update_prepare(fcc_sqlite);
+
+    if(error == HAM_OK && options->clustered == HAM_BOOL_YES)
+        error = ham_sqlite_cluster_prepare(fcc_sqlite);
+
+    /* The table threads start their own dictionaries from these */
+    if(error == HAM_OK && options->encode == HAM_BOOL_YES)
+        error = ham_sqlite_encode_prepare(fcc_sqlite);
+
+    if(error == HAM_OK && checkpoints)
+        error = ham_sqlite_checkpoints_prepare(fcc_sqlite, fcc_database, options->resume);
+
+    /* Perform the conversion. An update replaces whole licenses, so it is never split by table. */
+    if(error != HAM_OK) {
+        /* Nothing to convert */
+    } else if(options->parallel_tables == HAM_BOOL_YES && options->update != HAM_BOOL_YES) {
+        error = ham_sqlite_convert_tables(fcc_sqlite, fcc_database, filename, threads, options);
+    } else {
+        /* The calling thread is the writer; the rest of the threads read and parse */
+        fcc_sqlite->threads = threads - 1;
+
+        /* A file that cannot be read, e.g. a damaged archive member, fails the conversion */
+        for(int i = 1; i <= HAM_FCC_FILE_COUNT && error == HAM_OK; i++) {
+            if(fcc_database->files[i].open == HAM_BOOL_YES
+                    && fcc_sqlite->resume_done[i] != HAM_BOOL_YES)
+                error = ham_sqlite_fcc_convert_file(fcc_sqlite, &fcc_database->files[i], i);
+        }
+    }
+
+    if(error == HAM_OK && options->clustered == HAM_BOOL_YES)
+        error = ham_sqlite_cluster_finish(fcc_sqlite);
+
+    ham_sqlite_report_load(fcc_sqlite, start);
+
+    if(error == HAM_OK && options->encode == HAM_BOOL_YES)
+        error = ham_sqlite_encode_finish(fcc_sqlite);
+
+    if(error == HAM_OK && options->compact == HAM_BOOL_YES)
+        error = ham_sqlite_write_metadata(fcc_sqlite);
+
+    if(error == HAM_OK && options->licenses == HAM_BOOL_YES)
+        error = ham_sqlite_build_licenses(fcc_sqlite, fcc_database);
+
+    if(error == HAM_OK && options->name_search == HAM_BOOL_YES)
+        error = ham_sqlite_build_name_search(fcc_sqlite);
+
+    if(error == HAM_OK && options->indexes == HAM_BOOL_YES)
+        error = ham_sqlite_create_indexes(fcc_sqlite, threads);
+
+    if(error == HAM_OK && options->callsign_index != NULL)
+        error = ham_sqlite_write_callsign_index(fcc_sqlite, options->callsign_index);
+
+    if(error == HAM_OK && checkpoints)
+        error = ham_sqlite_checkpoints_finish(fcc_sqlite);
+
+    /* Clean up */
+    return ham_sqlite_finish(fcc_sqlite, error);
+}
+
+LIBHAMDATA_API int ham_fcc_stream_to_sqlite(ham_fcc_read_callback read, void *context,
+                                            const char *filename,
+                                            const ham_fcc_convert_options *options) {
+    ham_fcc_sqlite *fcc_sqlite;
+    ham_fcc_file file;
+    ham_tar tar;
+    int threads = options->threads > 0 ? options->threads : ham_cpu_count();
+    int error, is_tar;
+    double start = ham_seconds();
+
+    if(filename == NULL)
+        filename = HAM_SQLITE_FILENAME;
+
+    /* A stream cannot be read from the middle */
+    if(options->resume == HAM_BOOL_YES) {
+        fprintf(stderr, "Error: a conversion from a stream cannot be resumed\n");
+        return HAM_ERROR_GENERIC;
+    }
+
+    if(ham_sqlite_init(&fcc_sqlite, filename, options))
+        return HAM_ERROR_SQLITE_INIT;
+
+    fcc_sqlite->encode = options->encode;
+    fcc_sqlite->compact = options->compact;
+    fcc_sqlite->clustered = options->clustered;
+    fcc_sqlite->callsign_parts = options->callsign_parts;
+    fcc_sqlite->name_search = options->name_search;
+
+    if(ham_sqlite_create_tables(fcc_sqlite))
+        return HAM_ERROR_SQLITE_CREATE_TABLES;
+
+    if(ham_sqlite_sql_prepare_stmt(fcc_sqlite))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    if(options->update == HAM_BOOL_YES && ham_sqlite_update_prepare(fcc_sqlite) != HAM_OK) {
+        ham_sqlite_finish(fcc_sqlite, HAM_ERROR_SQLITE_PREPARE_STMT);
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+    }
+
+    if(options->encode == HAM_BOOL_YES && ham_sqlite_encode_prepare(fcc_sqlite) != HAM_OK) {
+        ham_sqlite_finish(fcc_sqlite, HAM_ERROR_SQLITE_PREPARE_STMT);
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+    }
+
+    if(options->clustered == HAM_BOOL_YES && ham_sqlite_cluster_prepare(fcc_sqlite) != HAM_OK) {
+        ham_sqlite_finish(fcc_sqlite, HAM_ERROR_SQLITE_PREPARE_STMT);
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+    }
+
+    /* A single stream is converted in order; there are no separate tables to run in parallel */
+    fcc_sqlite->threads = threads - 1;
+
+    ham_tar_init(&tar, read, context);
+
+    error = ham_tar_detect(&tar, &is_tar);
+    if(error == HAM_OK && is_tar) {
+        error = ham_sqlite_fcc_convert_tar(fcc_sqlite, &tar);
+    } else if(error == HAM_OK) {
+        error = ham_fcc_file_open_source(&file, ham_tar_read_stream, &tar);
+        if(error == HAM_OK)
+            error = ham_sqlite_fcc_convert_mixed(fcc_sqlite, &file);
+
+        ham_fcc_file_close(&file);
+    }
+
+    if(error == HAM_OK && options->clustered == HAM_BOOL_YES)
+        error = ham_sqlite_cluster_finish(fcc_sqlite);
+
+    ham_sqlite_report_load(fcc_sqlite, start);
+
+    if(error == HAM_OK && options->encode == HAM_BOOL_YES)
+        error = ham_sqlite_encode_finish(fcc_sqlite);
+
+    if(error == HAM_OK && options->compact == HAM_BOOL_YES)
+        error = ham_sqlite_write_metadata(fcc_sqlite);
+
+    /* The join reads the files a second time, which a stream cannot do */
+    if(options->licenses == HAM_BOOL_YES)
+        fprintf(stderr, "Licenses table skipped: the input was a stream\n");
+
+    if(error == HAM_OK && options->name_search == HAM_BOOL_YES)
+        error = ham_sqlite_build_name_search(fcc_sqlite);
+
+    if(error == HAM_OK && options->indexes == HAM_BOOL_YES)
+        error = ham_sqlite_create_indexes(fcc_sqlite, threads);
+
+    if(error == HAM_OK && options->callsign_index != NULL)
+        error = ham_sqlite_write_callsign_index(fcc_sqlite, options->callsign_index);
+
+    return ham_sqlite_finish(fcc_sqlite, error);
+}
+
+/* The snapshot of each record type is built in memory and written once the file is read */
+LIBHAMDATA_API int ham_fcc_to_columns(const ham_fcc_database *fcc_database, const char *directory) {
+    char path[512];
+    uint64_t rows;
+    double start;
+    int error = HAM_OK;
+
+    if(directory == NULL)
+        directory = ".";
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT && error == HAM_OK; i++) {
+        if(fcc_database->files[i].open != HAM_BOOL_YES)
+            continue;
+
+        snprintf(path, sizeof(path), "%s/%s%s", directory, HAM_SQLITE_TABLE_NAMES[i],
+                    HAM_COLUMNS_EXTENSION);
+
+        start = ham_seconds();
+        error = ham_columns_convert_file(&fcc_database->files[i], i, path, &rows);
+
+        if(error == HAM_OK)
+            printf("Columns %s: %llu rows, %.2f s\n", path, (unsigned long long)rows,
+                    ham_seconds() - start);
+        else
+            fprintf(stderr, "Error (%d): failed to write %s\n", error, path);
+    }
+
+    return error;
+}
+
+/* Reads a file into a snapshot whose columns are named as those of its table */
+int ham_columns_convert_file(const ham_fcc_file *data, const int fcc_file, const char *path,
+                                uint64_t *rows) {
+    ham_columns_builder builder;
+    ham_fcc_reader reader;
+    ham_record record;
+    ham_field fields[HAM_SPLIT_MAX_FIELDS];
+    const char *types = HAM_FCC_COLUMN_TYPES[fcc_file];
+    int num_fields = (int)strlen(types);
+    int error;
+
+    *rows = 0;
+
+    error = ham_columns_builder_init(&builder, types);
+    if(error != HAM_OK)
+        return error;
+
+    for(int i = 0; i < num_fields && error == HAM_OK; i++)
+        error = ham_sqlite_column_name(fcc_file, i + 1, builder.columns[i].name,
+                                        sizeof(builder.columns[i].name));
+
+    if(error == HAM_OK)
+        error = ham_fcc_reader_init(&reader, data);
+
+    if(error != HAM_OK) {
+        ham_columns_builder_destroy(&builder);
+        return error;
+    }
+
+    while(error == HAM_OK && ham_fcc_reader_next_record(&reader, &record) == HAM_OK) {
+        /* Blank lines, usually a trailing one, are not records */
+        if(record.length == 0)
+            continue;
+
+        ham_parse_record(fields, &record, num_fields);
+
+        for(int i = 0; i < num_fields && error == HAM_OK; i++)
+            error = ham_columns_builder_add(&builder, i, fields[i].data, fields[i].length);
+
+        ham_columns_builder_end_row(&builder);
+    }
+
+    if(error == HAM_OK && reader.error != HAM_OK)
+        error = reader.error;
+
+    ham_fcc_reader_terminate(&reader);
+
+    if(error == HAM_OK)
+        error = ham_columns_write(&builder, path);
+
+    *rows = builder.rows;
+    ham_columns_builder_destroy(&builder);
+
+    return error;
+}
+
+/*
+ * Each record type is read and parsed as for SQLite, through the pipeline unless it is small, and
+ * the calling thread hands the rows to the sink.
+ */
+LIBHAMDATA_API int ham_fcc_to_sink(const ham_fcc_database *fcc_database, ham_fcc_sink *sink,
+                                    const ham_fcc_convert_options *options) {
+    ham_fcc_convert_options defaults;
+    uint64_t rows;
+    double start;
+    int threads, error = HAM_OK;
+
+    if(options == NULL) {
+        ham_fcc_convert_options_init(&defaults);
+        options = &defaults;
+    }
+
+    threads = options->threads > 0 ? options->threads : ham_cpu_count();
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT && error == HAM_OK; i++) {
+        if(fcc_database->files[i].open != HAM_BOOL_YES)
+            continue;
+
+        start = ham_seconds();
+        error = ham_sink_convert_file(&fcc_database->files[i], i, sink, threads - 1,
+                                        ham_chunk_size(options), &rows);
+
+        if(error == HAM_OK)
+            printf("Sink %s: %llu rows, %.2f s\n", HAM_SQLITE_TABLE_NAMES[i],
+                    (unsigned long long)rows, ham_seconds() - start);
+        else
+            fprintf(stderr, "Error (%d): failed to write %s\n", error, HAM_SQLITE_TABLE_NAMES[i]);
+    }
+
+    return error;
+}
+
+/* Describes the table to the sink, with the column names of the SQLite table, and feeds it */
+int ham_sink_convert_file(const ham_fcc_file *data, const int fcc_file, ham_fcc_sink *sink,
+                            const int threads, const size_t chunk_size, uint64_t *rows) {
+    char names[HAM_SPLIT_MAX_FIELDS][HAM_COLUMNS_NAME_SIZE];
+    const char *column_names[HAM_SPLIT_MAX_FIELDS];
+    int column_types[HAM_SPLIT_MAX_FIELDS];
+    char record_type[3];
+    ham_fcc_sink_table table;
+    const char *types = HAM_FCC_COLUMN_TYPES[fcc_file];
+    int num_fields = (int)strlen(types);
+    int error = HAM_OK;
+
+    *rows = 0;
+
+    for(int i = 0; i < num_fields && error == HAM_OK; i++) {
+        error = ham_sqlite_column_name(fcc_file, i + 1, names[i], sizeof(names[i]));
+        column_names[i] = names[i];
+        column_types[i] = ham_sink_column_type(types[i]);
+    }
+
+    if(error != HAM_OK)
+        return error;
+
+    memcpy(record_type, FCC_FILENAMES[fcc_file], 2);
+    record_type[2] = '\0';
+
+    table.name = HAM_SQLITE_TABLE_NAMES[fcc_file];
+    table.record_type = record_type;
+    table.num_columns = num_fields;
+    table.column_names = column_names;
+    table.column_types = column_types;
+
+    error = sink->begin_table(sink->context, &table);
+    if(error != HAM_OK)
+        return error;
+
+    /* Small files are not worth starting threads for */
+    if(threads > 0 && (data->map.mapped != HAM_BOOL_YES || (uint64_t)data->size > chunk_size)) {
+        error = ham_sink_convert_pipelined(data, num_fields, sink, threads, chunk_size, rows);
+    } else {
+        error = ham_sink_convert_chunks(data, num_fields, sink, chunk_size, rows);
+    }
+
+    if(error == HAM_OK)
+        error = sink->end_table(sink->context);
+
+    return error;
+}
+
+/* Reads and parses the chunks on this thread, so the sink gets the same batches without threads */
+int ham_sink_convert_chunks(const ham_fcc_file *data, const int num_fields, ham_fcc_sink *sink,
+                            const size_t chunk_size, uint64_t *rows) {
+    ham_pipeline pipeline;
+    ham_slot slot;
+    int error;
+
+    error = ham_pipeline_init(&pipeline, data, num_fields, chunk_size, 0);
+    if(error != HAM_OK)
+        return error;
+
+    memset(&slot, 0, sizeof(ham_slot));
+
+    while(error == HAM_OK) {
+        error = ham_pipeline_next_chunk(&pipeline, &slot);
+        if(error != HAM_OK || slot.last == HAM_BOOL_YES)
+            break;
+
+        error = ham_batch_parse(&slot.batch, slot.begin, slot.end, num_fields);
+        if(error == HAM_OK && slot.batch.rows > 0)
+            error = sink->append_rows(sink->context, slot.batch.fields, slot.batch.rows);
+
+        *rows += slot.batch.rows;
+    }
+
+    free(slot.buffer);
+    free(slot.batch.fields);
+    free(slot.batch.lines);
+    ham_pipeline_stop(&pipeline);
+
+    return error;
+}
+
+/* Each parsed chunk goes to the sink as one batch, in file order */
+int ham_sink_convert_pipelined(const ham_fcc_file *data, const int num_fields,
+                                ham_fcc_sink *sink, const int threads, const size_t chunk_size,
+                                uint64_t *rows) {
+    ham_pipeline pipeline;
+    ham_parser *parser;
+    ham_slot *slot;
+    int error;
+
+    error = ham_pipeline_start(&pipeline, data, num_fields, threads > 1 ? threads - 1 : 1,
+                                chunk_size, 0);
+    if(error != HAM_OK)
+        return error;
+
+    for(INT64 chunk = 0; ; chunk++) {
+        parser = &pipeline.parsers[chunk % pipeline.num_parsers];
+
+        /* Only this thread aborts, so the pop cannot give up */
+        slot = ham_ring_pop(&parser->output, &pipeline.abort);
+
+        error = slot->batch.error;
+        if(error == HAM_OK && slot->last != HAM_BOOL_YES && slot->batch.rows > 0)
+            error = sink->append_rows(sink->context, slot->batch.fields, slot->batch.rows);
+
+        if(error != HAM_OK) {
+            ham_ring_abort(&pipeline.abort);
+            break;
+        }
+
+        if(slot->last == HAM_BOOL_YES)
+            break;
+
+        *rows += slot->batch.rows;
+        ham_ring_push(&parser->free, slot, &pipeline.abort);
+    }
+
+    ham_pipeline_stop(&pipeline);
+
+    return error;
+}
+
+int ham_sink_column_type(const char type) {
+    switch(type) {
+        case HAM_VALUE_INTEGER:
+            return HAM_COLUMN_INT64;
+
+        case HAM_VALUE_DATE:
+            return HAM_COLUMN_DATE;
+
+        case HAM_VALUE_CODE:
+            return HAM_COLUMN_CODE;
+
+        default:
+            return HAM_COLUMN_STRING;
+    }
+}
+
+/*
+ * Opens the database. In memory, the database starts out as a copy of the file, if there is one,
+ * and only replaces it in ham_sqlite_finish.
+ */
+int ham_sqlite_init(ham_fcc_sqlite **fcc_sqlite, const char *filename,
+                    const ham_fcc_convert_options *options) {
+    ham_fcc_convert_options budgeted;
+    int in_memory = options->in_memory;
+    int error;
+
+    if(options->memory_budget > 0
+            && (options->memory_budget < HAM_MIN_MEMORY_BUDGET || in_memory == HAM_BOOL_YES)) {
+        fprintf(stderr, "Error: a memory budget must be at least %d MiB and cannot build the "
+                "database in memory\n", HAM_MIN_MEMORY_BUDGET / (1024 * 1024));
+        return HAM_ERROR_SQLITE_INIT;
+    }
+
+    ham_budget_options(options, &budgeted);
+
+    /* A batch that dies part way is rolled back from the journal, so it has to be on disk */
+    if((options->commit_rows > 0 || options->commit_bytes > 0) && budgeted.journal_mode != NULL
+            && !sqlite3_stricmp(budgeted.journal_mode, "MEMORY"))
+        budgeted.journal_mode = "TRUNCATE";
+
+    (*fcc_sqlite) = malloc(sizeof(ham_fcc_sqlite));
+    if((*fcc_sqlite) == NULL)
+        return HAM_ERROR_SQLITE_INIT;
+
+    if(filename == NULL)
+        filename = HAM_SQLITE_FILENAME;
+
+    (*fcc_sqlite)->target = NULL;
+    if(in_memory == HAM_BOOL_YES) {
+        (*fcc_sqlite)->target = malloc(strlen(filename) + 1);
+        if((*fcc_sqlite)->target == NULL) {
+            free((*fcc_sqlite));
+            (*fcc_sqlite) = NULL;
+
+            return HAM_ERROR_SQLITE_INIT;
+        }
+
+        strcpy((*fcc_sqlite)->target, filename);
+        error = ham_sqlite_open_memory(&(*fcc_sqlite)->database, filename);
+    } else {
+        error = ham_sqlite_open_database_connection(&(*fcc_sqlite)->database, filename);
+    }
+
+    if(error) {
+        free((*fcc_sqlite)->target);
+        free((*fcc_sqlite));
+        (*fcc_sqlite) = NULL;
+
+        return HAM_ERROR_SQLITE_OPEN_DATABASE_CONNECTION;
+    }
+
+    if(sqlite3_exec((*fcc_sqlite)->database, "PRAGMA quick_check", NULL, NULL, NULL)) {
+        printf("Error: database file corrupt! Reseting the file...\n");
+        sqlite3_close((*fcc_sqlite)->database);
+
+        /* The copy in memory is dropped instead; the file is replaced at the end */
+        if(in_memory != HAM_BOOL_YES && ham_sqlite_reset_file(filename)) {
+            free((*fcc_sqlite));
+            (*fcc_sqlite) = NULL;
+
+            return HAM_ERROR_SQLITE_RESET_FILE;
+        }
+
+        ham_sqlite_open_database_connection(&(*fcc_sqlite)->database,
+                                            in_memory == HAM_BOOL_YES ? ":memory:" : filename);
+    }
+
+    (*fcc_sqlite)->sql_insert_calls = 0;
+    (*fcc_sqlite)->am_line = 0;
+    (*fcc_sqlite)->en_line = 0;
+    (*fcc_sqlite)->hd_line = 0;
+    (*fcc_sqlite)->hs_line = 0;
+    (*fcc_sqlite)->co_line = 0;
+    (*fcc_sqlite)->la_line = 0;
+    (*fcc_sqlite)->sc_line = 0;
+    (*fcc_sqlite)->sf_line = 0;
+
+    (*fcc_sqlite)->threads = 0;
+    (*fcc_sqlite)->chunk_size = ham_chunk_size(options);
+    (*fcc_sqlite)->index_cache_size = budgeted.index_cache_size;
+
+    (*fcc_sqlite)->update = HAM_BOOL_NO;
+    (*fcc_sqlite)->mark_stmt = NULL;
+    for(int i = 0; i <= HAM_FCC_FILE_COUNT; i++)
+        (*fcc_sqlite)->delete_stmt[i] = NULL;
+    (*fcc_sqlite)->licenses_replaced = 0;
+
+    (*fcc_sqlite)->encode = HAM_BOOL_NO;
+    (*fcc_sqlite)->compact = HAM_BOOL_NO;
+
+    (*fcc_sqlite)->clustered = HAM_BOOL_NO;
+    for(int i = 0; i <= HAM_FCC_FILE_COUNT; i++) {
+        (*fcc_sqlite)->sequence[i] = 0;
+        (*fcc_sqlite)->last_key[i] = INT64_MIN;
+        (*fcc_sqlite)->stage_stmt[i] = NULL;
+        (*fcc_sqlite)->staged[i] = 0;
+    }
+    for(int i = 0; i <= HAM_FCC_FILE_COUNT; i++)
+        (*fcc_sqlite)->dictionaries[i] = NULL;
+
+    (*fcc_sqlite)->callsign_parts = HAM_BOOL_NO;
+    (*fcc_sqlite)->parts_stmt = NULL;
+    (*fcc_sqlite)->parts_delete_stmt = NULL;
+
+    (*fcc_sqlite)->name_search = HAM_BOOL_NO;
+    (*fcc_sqlite)->name_search_existed = HAM_BOOL_NO;
+    (*fcc_sqlite)->search_delete_stmt = NULL;
+
+    (*fcc_sqlite)->commit_rows = options->commit_rows;
+    (*fcc_sqlite)->commit_bytes = options->commit_bytes;
+    (*fcc_sqlite)->batch_rows = 0;
+    (*fcc_sqlite)->batch_bytes = 0;
+    (*fcc_sqlite)->commits = 0;
+
+    (*fcc_sqlite)->checkpoint_stmt = NULL;
+    for(int i = 0; i <= HAM_FCC_FILE_COUNT; i++) {
+        (*fcc_sqlite)->resume_offset[i] = 0;
+        (*fcc_sqlite)->resume_done[i] = HAM_BOOL_NO;
+    }
+
+    (*fcc_sqlite)->memory_budget = options->memory_budget;
+    (*fcc_sqlite)->soft_heap_limit = -1;
+    (*fcc_sqlite)->hard_heap_limit = -1;
+    (*fcc_sqlite)->error = HAM_OK;
+
+    ham_sqlite_init_time(*fcc_sqlite);
+
+    if(ham_sqlite_apply_options((*fcc_sqlite)->database, &budgeted) != HAM_OK) {
+        ham_sqlite_terminate(*fcc_sqlite);
+        (*fcc_sqlite) = NULL;
+
+        return HAM_ERROR_SQLITE_INIT;
+    }
+
+    /* The hard limit goes first, as SQLite keeps the soft limit under it */
+    if(options->memory_budget > 0) {
+        (*fcc_sqlite)->hard_heap_limit =
+            sqlite3_hard_heap_limit64(options->memory_budget / 8 * HAM_BUDGET_HARD_HEAP);
+        (*fcc_sqlite)->soft_heap_limit =
+            sqlite3_soft_heap_limit64(options->memory_budget / 8 * HAM_BUDGET_SOFT_HEAP);
+    }
+
+    sqlite3_exec((*fcc_sqlite)->database, "BEGIN TRANSACTION", NULL, NULL, NULL);
+
+    return HAM_OK;
+}
+
+static const char *const HAM_SQLITE_JOURNAL_MODES[] = {"DELETE", "TRUNCATE", "PERSIST", "MEMORY",
+                                                        "WAL", "OFF", NULL};
+static const char *const HAM_SQLITE_SYNCHRONOUS[] = {"OFF", "NORMAL", "FULL", "EXTRA", NULL};
+
+/*
+ * Sets the page size, caches and journal of the connection before anything is written. A size of
+ * 0 or a NULL mode leaves SQLite's own default, and the page size only applies to a new database.
+ * A mode that is not one of SQLite's is refused.
+ */
+int ham_sqlite_apply_options(sqlite3 *database, const ham_fcc_convert_options *options) {
+    const char *journal_mode = NULL, *synchronous = NULL;
+    int error = HAM_OK;
+
+    if(options->journal_mode != NULL)
+        journal_mode = ham_sqlite_pragma_value(options->journal_mode, HAM_SQLITE_JOURNAL_MODES);
+
+    if(options->synchronous != NULL)
+        synchronous = ham_sqlite_pragma_value(options->synchronous, HAM_SQLITE_SYNCHRONOUS);
+
+    if((options->journal_mode != NULL && journal_mode == NULL)
+            || (options->synchronous != NULL && synchronous == NULL)
+            || options->temp_store < HAM_TEMP_STORE_DEFAULT
+            || options->temp_store > HAM_TEMP_STORE_MEMORY) {
+        fprintf(stderr, "Error: unknown journal mode, synchronous or temp store setting\n");
+        return HAM_ERROR_GENERIC;
+    }
+
+    if(options->page_size > 0)
+        error = ham_sqlite_pragma(database, "PRAGMA page_size = %d", options->page_size);
+
+    if(error == HAM_OK && options->cache_size > 0)
+        error = ham_sqlite_pragma(database, "PRAGMA cache_size = -%d", options->cache_size);
+
+    if(error == HAM_OK && options->mmap_size >= 0)
+        error = ham_sqlite_pragma(database, "PRAGMA mmap_size = %lld",
+                                    (long long)options->mmap_size);
+
+    if(error == HAM_OK)
+        error = ham_sqlite_pragma(database, "PRAGMA temp_store = %d", options->temp_store);
+
+    if(error == HAM_OK && journal_mode != NULL)
+        error = ham_sqlite_pragma(database, "PRAGMA journal_mode = %s", journal_mode);
+
+    if(error == HAM_OK && synchronous != NULL)
+        error = ham_sqlite_pragma(database, "PRAGMA synchronous = %s", synchronous);
+
+    return error;
+}
+
+/* Runs a statement formatted by sqlite3_mprintf */
+int ham_sqlite_pragma(sqlite3 *database, const char *format, ...) {
+    va_list arguments;
+    char *sql;
+    int rc;
+
+    va_start(arguments, format);
+    sql = sqlite3_vmprintf(format, arguments);
+    va_end(arguments);
+
+    if(sql == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    rc = sqlite3_exec(database, sql, NULL, NULL, NULL);
+    sqlite3_free(sql);
+
+    return rc == SQLITE_OK ? HAM_OK : HAM_ERROR_GENERIC;
+}
+
+/* The allowed value that matches, ignoring case, or NULL */
+const char *ham_sqlite_pragma_value(const char *value, const char *const *allowed) {
+    for(int i = 0; allowed[i] != NULL; i++) {
+        if(!sqlite3_stricmp(value, allowed[i]))
+            return allowed[i];
+    }
+
+    return NULL;
+}
+
+size_t ham_chunk_size(const ham_fcc_convert_options *options) {
+    if(options->chunk_size == 0)
+        return HAM_CHUNK_SIZE;
+
+    return options->chunk_size < HAM_MIN_CHUNK_SIZE ? HAM_MIN_CHUNK_SIZE : options->chunk_size;
+}
+
+/*
+ * The options cut down to the memory budget, if there is one. The page caches are capped at their
+ * shares of it, and what would grow with the data, a MEMORY journal or temp store and a memory
+ * mapped database, goes through files instead.
+ */
+void ham_budget_options(const ham_fcc_convert_options *options,
+                        ham_fcc_convert_options *budgeted) {
+    INT64 cache = options->memory_budget / 1024 / 8 * HAM_BUDGET_CACHE;
+    INT64 index_cache = options->memory_budget / 1024 / 8 * HAM_BUDGET_INDEX_CACHE;
+
+    *budgeted = *options;
+
+    if(options->memory_budget <= 0)
+        return;
+
+    if(budgeted->cache_size <= 0 || budgeted->cache_size > cache)
+        budgeted->cache_size = (int)cache;
+
+    if(budgeted->index_cache_size <= 0 || budgeted->index_cache_size > index_cache)
+        budgeted->index_cache_size = (int)index_cache;
+
+    if(budgeted->temp_store == HAM_TEMP_STORE_MEMORY)
+        budgeted->temp_store = HAM_TEMP_STORE_FILE;
+
+    if(budgeted->journal_mode != NULL && !sqlite3_stricmp(budgeted->journal_mode, "MEMORY"))
+        budgeted->journal_mode = "TRUNCATE";
+
+    budgeted->mmap_size = 0;
+}
+
+/* Largest the process has been in memory so far, in bytes, or -1 if the platform cannot tell */
+INT64 ham_peak_memory(void) {
+#if defined(OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return -1;
+
+    return (INT64)counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+
+    if(getrusage(RUSAGE_SELF, &usage))
+        return -1;
+
+    /* Bytes on macOS, KiB everywhere else */
+#if defined(__APPLE__)
+    return (INT64)usage.ru_maxrss;
+#else
+    return (INT64)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+int ham_sqlite_terminate(ham_fcc_sqlite *fcc_sqlite) {
+
+    /* Can be safely called if already freed. */
+    if(fcc_sqlite == NULL)
+        return HAM_OK;
+
+    sqlite3_exec(fcc_sqlite->database, "END TRANSACTION", NULL, NULL, NULL);
+
+    sqlite3_close(fcc_sqlite->database);
+
+    if(fcc_sqlite->hard_heap_limit >= 0) {
+        sqlite3_hard_heap_limit64(fcc_sqlite->hard_heap_limit);
+        sqlite3_soft_heap_limit64(fcc_sqlite->soft_heap_limit);
+    }
+
+    ham_sqlite_encode_free(fcc_sqlite);
+    free(fcc_sqlite->target);
+    free(fcc_sqlite);
+    return HAM_OK;
+}
+
+/*
+ * Ends a conversion. A failed update is rolled back, so a daily file is applied either completely
+ * or not at all, and a failed load in batches goes back to its last checkpoint. An in-memory
+ * database is written out only if the conversion succeeded, so a failed one leaves the file as it
+ * was. The peak memory of the process is reported last. Returns the error, or that of writing the
+ * file.
+ */
+int ham_sqlite_finish(ham_fcc_sqlite *fcc_sqlite, int error) {
+    if(fcc_sqlite->update == HAM_BOOL_YES) {
+        printf("Licenses replaced: %u\n", fcc_sqlite->licenses_replaced);
+
+        if(error != HAM_OK)
+            sqlite3_exec(fcc_sqlite->database, "ROLLBACK", NULL, NULL, NULL);
+    }
+
+    if(fcc_sqlite->checkpoint_stmt != NULL) {
+        if(error != HAM_OK)
+            sqlite3_exec(fcc_sqlite->database, "ROLLBACK", NULL, NULL, NULL);
+
+        sqlite3_finalize(fcc_sqlite->checkpoint_stmt);
+        fcc_sqlite->checkpoint_stmt = NULL;
+    }
+
+    ham_sqlite_update_finalize(fcc_sqlite);
+    ham_sqlite_sql_finalize_stmt(fcc_sqlite);
+
+    if(error == HAM_OK && fcc_sqlite->target != NULL)
+        error = ham_sqlite_flush(fcc_sqlite);
+
+    if(ham_peak_memory() >= 0)
+        printf("Peak memory: %.1f MiB\n", ham_peak_memory() / (1024.0 * 1024.0));
+
+    ham_sqlite_terminate(fcc_sqlite);
+
+    return error;
+}
+
+/* An empty in-memory database, with a copy of the file in it if there is one to read */
+int ham_sqlite_open_memory(sqlite3 **database, const char *filename) {
+    sqlite3 *file;
+    sqlite3_backup *backup;
+    int rc, finish;
+
+    if(ham_sqlite_open_database_connection(database, ":memory:"))
+        return HAM_ERROR_SQLITE_OPEN_DATABASE_CONNECTION;
+
+    if(sqlite3_open_v2(filename, &file, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        sqlite3_close(file);
+        return HAM_OK;
+    }
+
+    backup = sqlite3_backup_init(*database, "main", file, "main");
+    if(backup != NULL) {
+        rc = sqlite3_backup_step(backup, -1);
+        finish = sqlite3_backup_finish(backup);
+
+        if(rc == SQLITE_DONE)
+            rc = finish;
+    } else {
+        rc = sqlite3_errcode(*database);
+    }
+
+    /* The errors of a backup are left on the connection it copies into */
+    if(rc != SQLITE_OK) {
+        fprintf(stderr, "Error: unable to copy %s into memory: %s\n", filename,
+                sqlite3_errmsg(*database));
+        sqlite3_close(*database);
+        *database = NULL;
+    }
+
+    sqlite3_close(file);
+
+    return rc == SQLITE_OK ? HAM_OK : HAM_ERROR_SQLITE_OPEN_DATABASE_CONNECTION;
+}
+
+/*
+ * Writes the in-memory database out with VACUUM INTO, which copies it b-tree by b-tree into a
+ * new file in one sequential pass, with every table and index in contiguous pages. The new file
+ * takes the place of the old one once it is complete.
+ */
+int ham_sqlite_flush(ham_fcc_sqlite *fcc_sqlite) {
+    char path[512];
+    sqlite3_stmt *sql_stmt;
+    double start = ham_seconds();
+    int rc;
+
+    if((size_t)snprintf(path, sizeof(path), "%s.tmp", fcc_sqlite->target) >= sizeof(path))
+        return HAM_ERROR_DIR_TOO_LONG;
+
+    /* VACUUM cannot run inside the conversion's transaction */
+    sqlite3_exec(fcc_sqlite->database, "END TRANSACTION", NULL, NULL, NULL);
+
+    /* Left over from an earlier run that did not finish */
+    remove(path);
+
+    if(sqlite3_prepare_v2(fcc_sqlite->database, "VACUUM INTO ?", -1, &sql_stmt, NULL))
+        return HAM_ERROR_SQLITE_INSERT;
+
+    sqlite3_bind_text(sql_stmt, 1, path, -1, SQLITE_STATIC);
+    rc = sqlite3_step(sql_stmt);
+    sqlite3_finalize(sql_stmt);
+
+    if(rc != SQLITE_DONE) {
+        fprintf(stderr, "Error: unable to write %s: %s\n", path,
+                sqlite3_errmsg(fcc_sqlite->database));
+        remove(path);
+
+        return HAM_ERROR_SQLITE_INSERT;
+    }
+
+#if defined(OS_WIN)
+    /* rename does not replace a file on Windows */
+    remove(fcc_sqlite->target);
+#endif
+
+    if(rename(path, fcc_sqlite->target)) {
+        remove(path);
+        return HAM_ERROR_OPEN_FILE;
+    }
+
+    printf("Written to %s: %.2f s\n", fcc_sqlite->target, ham_seconds() - start);
+
+    return HAM_OK;
+}
+
+int ham_sqlite_sql_prepare_stmt(ham_fcc_sqlite *fcc_sqlite) {
+
+    if(ham_sqlite_prepare_insert(fcc_sqlite, HAM_SQLITE_INSERT_FCC_AM, NULL,
+                                    &fcc_sqlite->am_stmt))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    if(ham_sqlite_prepare_insert(fcc_sqlite, HAM_SQLITE_INSERT_FCC_EN, NULL,
+                                    &fcc_sqlite->en_stmt))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    if(ham_sqlite_prepare_insert(fcc_sqlite, HAM_SQLITE_INSERT_FCC_HD, NULL,
+                                    &fcc_sqlite->hd_stmt))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    if(ham_sqlite_prepare_insert(fcc_sqlite, HAM_SQLITE_INSERT_FCC_HS, NULL,
+                                    &fcc_sqlite->hs_stmt))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    if(ham_sqlite_prepare_insert(fcc_sqlite, HAM_SQLITE_INSERT_FCC_CO, NULL,
+                                    &fcc_sqlite->co_stmt))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    if(ham_sqlite_prepare_insert(fcc_sqlite, HAM_SQLITE_INSERT_FCC_LA, NULL,
+                                    &fcc_sqlite->la_stmt))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    if(ham_sqlite_prepare_insert(fcc_sqlite, HAM_SQLITE_INSERT_FCC_SC, NULL,
+                                    &fcc_sqlite->sc_stmt))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    if(ham_sqlite_prepare_insert(fcc_sqlite, HAM_SQLITE_INSERT_FCC_SF, NULL,
+                                    &fcc_sqlite->sf_stmt))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    if(fcc_sqlite->callsign_parts == HAM_BOOL_YES
+            && sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_CALLSIGN_PARTS_INSERT, -1,
+                                    &fcc_sqlite->parts_stmt, NULL))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    return HAM_OK;
+}
+
+int ham_sqlite_sql_finalize_stmt(ham_fcc_sqlite *fcc_sqlite) {
+    if(fcc_sqlite->am_stmt != NULL) {
+        sqlite3_finalize(fcc_sqlite->am_stmt);
+        fcc_sqlite->am_stmt = NULL;
+    }
+
+    if(fcc_sqlite->en_stmt != NULL) {
+        sqlite3_finalize(fcc_sqlite->en_stmt);
+        fcc_sqlite->en_stmt = NULL;
+    }
+
+    if(fcc_sqlite->hd_stmt != NULL) {
+        sqlite3_finalize(fcc_sqlite->hd_stmt);
+        fcc_sqlite->hd_stmt = NULL;
+    }
+
+    if(fcc_sqlite->hs_stmt != NULL) {
+        sqlite3_finalize(fcc_sqlite->hs_stmt);
+        fcc_sqlite->hs_stmt = NULL;
+    }
+
+    if(fcc_sqlite->co_stmt != NULL) {
+        sqlite3_finalize(fcc_sqlite->co_stmt);
+        fcc_sqlite->co_stmt = NULL;
+    }
+
+    if(fcc_sqlite->la_stmt != NULL) {
+        sqlite3_finalize(fcc_sqlite->la_stmt);
+        fcc_sqlite->la_stmt = NULL;
+    }
+
+    if(fcc_sqlite->sc_stmt != NULL) {
+        sqlite3_finalize(fcc_sqlite->sc_stmt);
+        fcc_sqlite->sc_stmt = NULL;
+    }
+
+    if(fcc_sqlite->sf_stmt != NULL) {
+        sqlite3_finalize(fcc_sqlite->sf_stmt);
+        fcc_sqlite->sf_stmt = NULL;
+    }
+
+    if(fcc_sqlite->parts_stmt != NULL) {
+        sqlite3_finalize(fcc_sqlite->parts_stmt);
+        fcc_sqlite->parts_stmt = NULL;
+    }
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        if(fcc_sqlite->stage_stmt[i] != NULL) {
+            sqlite3_finalize(fcc_sqlite->stage_stmt[i]);
+            fcc_sqlite->stage_stmt[i] = NULL;
+        }
+    }
+
+    return HAM_OK;
+}
+
+
+/* Creates the HAM_SQLITE_FILENAME. If it already exists, reset it. */
+int ham_sqlite_reset_file(const char *filename) {
+    FILE *f = fopen(filename, "w");
+
+    if(f == NULL)
+        return HAM_ERROR_SQLITE_RESET_FILE;
+
+    fclose(f);
+
+    return HAM_OK;
+}
+
+int ham_sqlite_open_database_connection(sqlite3 **database, const char *filename) {
+    if(sqlite3_open(filename, database)) {
+        fprintf(stderr, "Error: unable to open database: %s\n", sqlite3_errmsg(*database));
+
+        sqlite3_close(*database);
+        return HAM_ERROR_SQLITE_OPEN_DATABASE_CONNECTION;
+    }
+
+    return HAM_OK;
+}
+
+int ham_sqlite_create_tables(ham_fcc_sqlite *fcc_sqlite) {
+    char name[HAM_FCC_NAME_SIZE];
+    const char *types;
+    char *sql;
+    int rc;
+
+    if(fcc_sqlite->compact == HAM_BOOL_YES
+            && sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_METADATA_TABLE, NULL, NULL, NULL))
+        return HAM_ERROR_SQLITE_CREATE_TABLES;
+
+    if(fcc_sqlite->callsign_parts == HAM_BOOL_YES
+            && sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_CALLSIGN_PARTS_TABLE, NULL, NULL,
+                            NULL))
+        return HAM_ERROR_SQLITE_CREATE_TABLES;
+
+    if(fcc_sqlite->name_search == HAM_BOOL_YES && ham_sqlite_name_search_create(fcc_sqlite))
+        return HAM_ERROR_SQLITE_CREATE_TABLES;
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        sql = ham_sqlite_schema(fcc_sqlite, i);
+        if(sql == NULL)
+            return HAM_ERROR_MALLOC_FAIL;
+
+        rc = sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+        sqlite3_free(sql);
+
+        if(rc != SQLITE_OK)
+            return HAM_ERROR_SQLITE_CREATE_TABLES;
+
+        if(fcc_sqlite->encode != HAM_BOOL_YES)
+            continue;
+
+        types = HAM_FCC_COLUMN_TYPES[i];
+
+        for(int field = 0; types[field] != HAM_NULL_CHAR; field++) {
+            if(types[field] != HAM_VALUE_CODE)
+                continue;
+
+            if(ham_sqlite_column_name(i, field + 1, name, sizeof(name)))
+                return HAM_ERROR_SQLITE_CREATE_TABLES;
+
+            sql = sqlite3_mprintf(HAM_SQLITE_CODE_TABLE, HAM_SQLITE_TABLE_NAMES[i], name);
+            if(sql == NULL)
+                return HAM_ERROR_MALLOC_FAIL;
+
+            rc = sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+            sqlite3_free(sql);
+
+            if(rc != SQLITE_OK)
+                return HAM_ERROR_SQLITE_CREATE_TABLES;
+        }
+    }
+
+    return HAM_OK;
+}
+
+/* The CREATE TABLE statement of a file's table */
+const char *ham_sqlite_table_schema(const int fcc_file) {
+    switch (fcc_file) {
+        case HAM_FCC_FILE_AM:
+            return HAM_SQLITE_TABLE_FCC_AM;
+        case HAM_FCC_FILE_EN:
+            return HAM_SQLITE_TABLE_FCC_EN;
+        case HAM_FCC_FILE_HD:
+            return HAM_SQLITE_TABLE_FCC_HD;
+        case HAM_FCC_FILE_HS:
+            return HAM_SQLITE_TABLE_FCC_HS;
+        case HAM_FCC_FILE_CO:
+            return HAM_SQLITE_TABLE_FCC_CO;
+        case HAM_FCC_FILE_LA:
+            return HAM_SQLITE_TABLE_FCC_LA;
+        case HAM_FCC_FILE_SC:
+            return HAM_SQLITE_TABLE_FCC_SC;
+        case HAM_FCC_FILE_SF:
+            return HAM_SQLITE_TABLE_FCC_SF;
+    }
+
+    return NULL;
+}
+
+/*
+ * Name of a column of a table, read from its schema. Column 0 is the id, column 1 the first field
+ * of the file, and so on. HAM_ERROR_GENERIC if there is no such column.
+ */
+int ham_sqlite_column_name(const int fcc_file, const int column, char *name, const size_t size) {
+    const char *definition = strchr(ham_sqlite_table_schema(fcc_file), '(') + 1;
+    size_t length;
+
+    for(int i = 0; i < column; i++) {
+        definition = strpbrk(definition, ",)");
+        if(definition == NULL || *definition == ')')
+            return HAM_ERROR_GENERIC;
+
+        definition++;
+    }
+
+    length = strcspn(definition, " ");
+    if(length == 0 || length >= size)
+        return HAM_ERROR_GENERIC;
+
+    memcpy(name, definition, length);
+    name[length] = HAM_NULL_CHAR;
+
+    return HAM_OK;
+}
+
+/*
+ * The schema of a table as this conversion stores it. The encoded schema declares the code columns
+ * INTEGER, the compact one has a plain rowid id and no timestamps, and the clustered one is
+ * WITHOUT ROWID with the id as part of the key. Free it with sqlite3_free.
+ */
+char *ham_sqlite_schema(const ham_fcc_sqlite *fcc_sqlite, const int fcc_file) {
+    const char *schema = ham_sqlite_table_schema(fcc_file);
+    const char *types = HAM_FCC_COLUMN_TYPES[fcc_file];
+    const char *definition = strchr(schema, '(') + 1;
+    const char *end;
+    int num_fields = (int)strlen(types);
+    int name;
+    char *sql;
+
+    sql = sqlite3_mprintf("%.*s", (int)(definition - schema), schema);
+
+    for(int column = 0; sql != NULL; column++) {
+        end = strpbrk(definition, ",)");
+        name = (int)strcspn(definition, " ");
+
+        if(fcc_sqlite->compact == HAM_BOOL_YES && column > num_fields) {
+            /* The timestamps are kept once in the metadata table */
+        } else if(fcc_sqlite->clustered == HAM_BOOL_YES && column == 0) {
+            sql = sqlite3_mprintf("%z%.*s INTEGER NOT NULL", sql, name, definition);
+        } else if(fcc_sqlite->compact == HAM_BOOL_YES && column == 0) {
+            sql = sqlite3_mprintf("%z%.*s INTEGER PRIMARY KEY", sql, name, definition);
+        } else if(fcc_sqlite->encode == HAM_BOOL_YES && column > 0
+                    && types[column - 1] == HAM_VALUE_CODE) {
+            sql = sqlite3_mprintf("%z,%.*s INTEGER", sql, name, definition);
+        } else {
+            sql = sqlite3_mprintf("%z%s%.*s", sql, column > 0 ? "," : "",
+                                    (int)(end - definition), definition);
+        }
+
+        if(*end == ')' && fcc_sqlite->clustered == HAM_BOOL_YES) {
+            sql = sqlite3_mprintf("%z%s) WITHOUT ROWID%s", sql, HAM_SQLITE_CLUSTER_KEY, end + 1);
+            break;
+        }
+
+        if(*end == ')') {
+            sql = sqlite3_mprintf("%z%s", sql, end);
+            break;
+        }
+
+        definition = end + 1;
+    }
+
+    return sql;
+}
+
+/*
+ * Prepares a file's insert statement, into its table or, with into, another one with the same
+ * columns. The compact schema has no timestamps, so they are cut out of the column and value lists,
+ * and the clustered layout binds the id itself as the last parameter.
+ */
+int ham_sqlite_prepare_insert(ham_fcc_sqlite *fcc_sqlite, const char *insert, const char *into,
+                                sqlite3_stmt **sql_stmt) {
+    const char *columns, *values, *table;
+    size_t skip_columns = 0, skip_values = 0;
+    char *sql;
+    int rc;
+
+    if(fcc_sqlite->compact != HAM_BOOL_YES && fcc_sqlite->clustered != HAM_BOOL_YES
+            && into == NULL)
+        return sqlite3_prepare_v2(fcc_sqlite->database, insert, -1, sql_stmt, NULL);
+
+    if(fcc_sqlite->compact == HAM_BOOL_YES) {
+        columns = strstr(insert, HAM_SQLITE_TIMESTAMP_COLUMNS);
+        values = strstr(insert, HAM_SQLITE_TIMESTAMP_VALUES);
+        skip_columns = strlen(HAM_SQLITE_TIMESTAMP_COLUMNS);
+        skip_values = strlen(HAM_SQLITE_TIMESTAMP_VALUES);
+    } else {
+        columns = strchr(insert, ')');
+        values = strrchr(insert, ')');
+    }
+
+    /* The statements start INSERT INTO <table>( */
+    table = strchr(insert, '(');
+    if(columns == NULL || values == NULL || table == NULL)
+        return SQLITE_ERROR;
+
+    if(into != NULL)
+        sql = sqlite3_mprintf("INSERT INTO %s%.*s", into, (int)(columns - table), table);
+    else
+        sql = sqlite3_mprintf("%.*s", (int)(columns - insert), insert);
+
+    sql = sqlite3_mprintf("%z%s%.*s%s%s", sql,
+                            fcc_sqlite->clustered == HAM_BOOL_YES ? ",id" : "",
+                            (int)(values - columns - skip_columns), columns + skip_columns,
+                            fcc_sqlite->clustered == HAM_BOOL_YES ? ",@id" : "",
+                            values + skip_values);
+    if(sql == NULL)
+        return SQLITE_NOMEM;
+
+    rc = sqlite3_prepare_v2(fcc_sqlite->database, sql, -1, sql_stmt, NULL);
+    sqlite3_free(sql);
+
+    return rc;
+}
+
+/* The insert statement of a file's table */
+const char *ham_sqlite_insert_sql(const int fcc_file) {
+    switch (fcc_file) {
+        case HAM_FCC_FILE_AM:
+            return HAM_SQLITE_INSERT_FCC_AM;
+        case HAM_FCC_FILE_EN:
+            return HAM_SQLITE_INSERT_FCC_EN;
+        case HAM_FCC_FILE_HD:
+            return HAM_SQLITE_INSERT_FCC_HD;
+        case HAM_FCC_FILE_HS:
+            return HAM_SQLITE_INSERT_FCC_HS;
+        case HAM_FCC_FILE_CO:
+            return HAM_SQLITE_INSERT_FCC_CO;
+        case HAM_FCC_FILE_LA:
+            return HAM_SQLITE_INSERT_FCC_LA;
+        case HAM_FCC_FILE_SC:
+            return HAM_SQLITE_INSERT_FCC_SC;
+        case HAM_FCC_FILE_SF:
+            return HAM_SQLITE_INSERT_FCC_SF;
+    }
+
+    return NULL;
+}
+
+/* Continues the ids of the clustered tables after the rows already in them, e.g. for an update */
+int ham_sqlite_cluster_prepare(ham_fcc_sqlite *fcc_sqlite) {
+    sqlite3_stmt *stmt;
+    char *sql;
+    int rc;
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        sql = sqlite3_mprintf(HAM_SQLITE_MAX_ID, HAM_SQLITE_TABLE_NAMES[i]);
+        if(sql == NULL)
+            return HAM_ERROR_MALLOC_FAIL;
+
+        rc = sqlite3_prepare_v2(fcc_sqlite->database, sql, -1, &stmt, NULL);
+        sqlite3_free(sql);
+
+        if(rc != SQLITE_OK)
+            return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+        if(sqlite3_step(stmt) == SQLITE_ROW)
+            fcc_sqlite->sequence[i] = sqlite3_column_int64(stmt, 0);
+
+        sqlite3_finalize(stmt);
+    }
+
+    return HAM_OK;
+}
+
+/*
+ * Statement a row of a clustered table goes through. A row whose license is not before the last
+ * one appended is appended too; the B-tree then only ever grows at its end. Anything else is staged
+ * for ham_sqlite_cluster_finish. NULL if the staging table cannot be created.
+ */
+sqlite3_stmt *ham_sqlite_cluster_target(ham_fcc_sqlite *fcc_sqlite, const int fcc_file,
+                                        const ham_field *identifier, sqlite3_stmt *sql_stmt) {
+    char into[HAM_FCC_NAME_SIZE];
+    INT64 key;
+    char *sql;
+    int rc;
+
+    /* A missing identifier fails on the insert, which reports it, and leaves the last key alone */
+    if(ham_parse_int64(identifier->data, identifier->length, &key) != HAM_OK)
+        return sql_stmt;
+
+    if(key >= fcc_sqlite->last_key[fcc_file]) {
+        fcc_sqlite->last_key[fcc_file] = key;
+        return sql_stmt;
+    }
+
+    if(fcc_sqlite->stage_stmt[fcc_file] == NULL) {
+        sql = sqlite3_mprintf(HAM_SQLITE_STAGE_TABLE, HAM_SQLITE_TABLE_NAMES[fcc_file],
+                                HAM_SQLITE_TABLE_NAMES[fcc_file]);
+        if(sql == NULL)
+            return NULL;
+
+        rc = sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+        sqlite3_free(sql);
+
+        snprintf(into, sizeof(into), "temp.ham_stage_%s", HAM_SQLITE_TABLE_NAMES[fcc_file]);
+
+        if(rc != SQLITE_OK || ham_sqlite_prepare_insert(fcc_sqlite, ham_sqlite_insert_sql(fcc_file),
+                                                        into, &fcc_sqlite->stage_stmt[fcc_file]))
+            return NULL;
+    }
+
+    fcc_sqlite->staged[fcc_file]++;
+
+    return fcc_sqlite->stage_stmt[fcc_file];
+}
+
+/*
+ * Sorts the staged rows into their tables. SQLite sorts them with its external merge sort, which
+ * spills to temporary files when they do not fit in the cache.
+ */
+int ham_sqlite_cluster_finish(ham_fcc_sqlite *fcc_sqlite) {
+    char *sql;
+    int rc;
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        if(fcc_sqlite->stage_stmt[i] == NULL)
+            continue;
+
+        sqlite3_finalize(fcc_sqlite->stage_stmt[i]);
+        fcc_sqlite->stage_stmt[i] = NULL;
+
+        sql = sqlite3_mprintf(HAM_SQLITE_STAGE_MERGE, HAM_SQLITE_TABLE_NAMES[i],
+                                HAM_SQLITE_TABLE_NAMES[i]);
+        if(sql == NULL)
+            return HAM_ERROR_MALLOC_FAIL;
+
+        rc = sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+        sqlite3_free(sql);
+
+        if(rc != SQLITE_OK) {
+            fprintf(stderr, "Error (%d): Message: %s - Failed to sort %s\n", rc,
+                    sqlite3_errmsg(fcc_sqlite->database), FCC_FILENAMES[i]);
+
+            return HAM_ERROR_SQLITE_INSERT;
+        }
+
+        sql = sqlite3_mprintf("DROP TABLE temp.ham_stage_%s", HAM_SQLITE_TABLE_NAMES[i]);
+        sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+        sqlite3_free(sql);
+
+        printf("Rows sorted into %s: %u\n", HAM_SQLITE_TABLE_NAMES[i], fcc_sqlite->staged[i]);
+    }
+
+    return HAM_OK;
+}
+
+/* Records when the data was imported, or last updated, in the metadata table */
+int ham_sqlite_write_metadata(ham_fcc_sqlite *fcc_sqlite) {
+    char *sql;
+    int rc;
+
+    sql = sqlite3_mprintf(HAM_SQLITE_METADATA_SET,
+                            fcc_sqlite->update == HAM_BOOL_YES ? "updated_at" : "imported_at",
+                            fcc_sqlite->time);
+    if(sql == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    rc = sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+    sqlite3_free(sql);
+
+    return rc == SQLITE_OK ? HAM_OK : HAM_ERROR_SQLITE_INSERT;
+}
+
+/*
+ * Gives each file a dictionary per field for the encoded schema. When the database already has
+ * codes, e.g. for an update, they are loaded so new rows get the same codes.
+ */
+int ham_sqlite_encode_prepare(ham_fcc_sqlite *fcc_sqlite) {
+    char name[HAM_FCC_NAME_SIZE];
+    const char *types;
+    sqlite3_stmt *stmt;
+    uint32_t code;
+    char *sql;
+    int rc;
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        types = HAM_FCC_COLUMN_TYPES[i];
+
+        fcc_sqlite->dictionaries[i] = malloc(sizeof(ham_dict) * strlen(types));
+        if(fcc_sqlite->dictionaries[i] == NULL)
+            return HAM_ERROR_MALLOC_FAIL;
+
+        for(int field = 0; types[field] != HAM_NULL_CHAR; field++)
+            ham_dict_init(&fcc_sqlite->dictionaries[i][field]);
+
+        for(int field = 0; types[field] != HAM_NULL_CHAR; field++) {
+            if(types[field] != HAM_VALUE_CODE)
+                continue;
+
+            if(ham_sqlite_column_name(i, field + 1, name, sizeof(name)))
+                return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+            sql = sqlite3_mprintf(HAM_SQLITE_CODE_SELECT, HAM_SQLITE_TABLE_NAMES[i], name);
+            if(sql == NULL)
+                return HAM_ERROR_MALLOC_FAIL;
+
+            rc = sqlite3_prepare_v2(fcc_sqlite->database, sql, -1, &stmt, NULL);
+            sqlite3_free(sql);
+
+            if(rc != SQLITE_OK)
+                return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+            while((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+                /* The codes are handed out in order, so they come back the same */
+                rc = ham_dict_intern(&fcc_sqlite->dictionaries[i][field],
+                                        (const char *)sqlite3_column_text(stmt, 1),
+                                        (size_t)sqlite3_column_bytes(stmt, 1), &code);
+
+                if(rc != HAM_OK || code != (uint32_t)sqlite3_column_int64(stmt, 0)) {
+                    rc = SQLITE_CORRUPT;
+                    break;
+                }
+            }
+
+            sqlite3_finalize(stmt);
+
+            if(rc != SQLITE_DONE)
+                return HAM_ERROR_SQLITE_PREPARE_STMT;
+        }
+    }
+
+    return HAM_OK;
+}
+
+/*
+ * Writes the codes to the lookup tables. Codes already there are left alone, so a checkpoint can
+ * save them with each batch and the end of the load again.
+ */
+int ham_sqlite_encode_save(ham_fcc_sqlite *fcc_sqlite) {
+    char name[HAM_FCC_NAME_SIZE];
+    const char *table, *types, *value;
+    sqlite3_stmt *stmt;
+    size_t length;
+    char *sql;
+    int rc;
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        table = HAM_SQLITE_TABLE_NAMES[i];
+        types = HAM_FCC_COLUMN_TYPES[i];
+
+        for(int field = 0; fcc_sqlite->dictionaries[i] != NULL && types[field] != HAM_NULL_CHAR;
+                field++) {
+            ham_dict *dict = &fcc_sqlite->dictionaries[i][field];
+
+            if(dict->count == 0 || ham_sqlite_column_name(i, field + 1, name, sizeof(name)))
+                continue;
+
+            sql = sqlite3_mprintf(HAM_SQLITE_CODE_INSERT, table, name);
+            if(sql == NULL)
+                return HAM_ERROR_MALLOC_FAIL;
+
+            rc = sqlite3_prepare_v2(fcc_sqlite->database, sql, -1, &stmt, NULL);
+            sqlite3_free(sql);
+
+            if(rc != SQLITE_OK)
+                return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+            for(uint32_t code = 1; code <= dict->count && rc == SQLITE_OK; code++) {
+                value = ham_dict_value(dict, code, &length);
+
+                sqlite3_bind_int64(stmt, 1, code);
+                sqlite3_bind_text(stmt, 2, value, (int)length, SQLITE_STATIC);
+
+                rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+                sqlite3_reset(stmt);
+            }
+
+            sqlite3_finalize(stmt);
+
+            if(rc != SQLITE_OK)
+                return HAM_ERROR_SQLITE_INSERT;
+        }
+    }
+
+    return HAM_OK;
+}
+
+/* Writes the codes to the lookup tables and creates the views that decode the tables */
+int ham_sqlite_encode_finish(ham_fcc_sqlite *fcc_sqlite) {
+    char name[HAM_FCC_NAME_SIZE];
+    const char *table, *types;
+    char *sql;
+    int error, rc;
+
+    error = ham_sqlite_encode_save(fcc_sqlite);
+    if(error != HAM_OK)
+        return error;
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        table = HAM_SQLITE_TABLE_NAMES[i];
+        types = HAM_FCC_COLUMN_TYPES[i];
+
+        /* The view lists every column of the table, decoding the code columns */
+        sql = sqlite3_mprintf("CREATE VIEW IF NOT EXISTS %s_decoded AS SELECT", table);
+
+        for(int column = 0; sql != NULL && ham_sqlite_column_name(i, column, name, sizeof(name))
+                == HAM_OK; column++) {
+            if(fcc_sqlite->compact == HAM_BOOL_YES && column > (int)strlen(types))
+                break;
+
+            if(column > 0 && column <= (int)strlen(types) && types[column - 1] == HAM_VALUE_CODE)
+                sql = sqlite3_mprintf(HAM_SQLITE_CODE_VIEW_COLUMN, sql, table, name, table, name,
+                                        name);
+            else
+                sql = sqlite3_mprintf("%z%s %s", sql, column > 0 ? "," : "", name);
+        }
+
+        sql = sqlite3_mprintf("%z FROM %s", sql, table);
+        if(sql == NULL)
+            return HAM_ERROR_MALLOC_FAIL;
+
+        rc = sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+        sqlite3_free(sql);
+
+        if(rc != SQLITE_OK)
+            return HAM_ERROR_SQLITE_CREATE_TABLES;
+    }
+
+    return HAM_OK;
+}
+
+/*
+ * Starts the dictionaries of a file with the codes of another connection's, in code order, so the
+ * codes a table thread hands out agree with those already in the output.
+ */
+int ham_sqlite_encode_seed(ham_fcc_sqlite *fcc_sqlite, const int fcc_file,
+                            const ham_dict *dictionaries) {
+    const char *value;
+    size_t length;
+    uint32_t code;
+
+    if(dictionaries == NULL)
+        return HAM_OK;
+
+    for(int field = 0; HAM_FCC_COLUMN_TYPES[fcc_file][field] != HAM_NULL_CHAR; field++) {
+        for(uint32_t i = 1; i <= dictionaries[field].count; i++) {
+            value = ham_dict_value(&dictionaries[field], i, &length);
+
+            if(ham_dict_intern(&fcc_sqlite->dictionaries[fcc_file][field], value, length, &code)
+                    != HAM_OK || code != i)
+                return HAM_ERROR_MALLOC_FAIL;
+        }
+    }
+
+    return HAM_OK;
+}
+
+void ham_sqlite_encode_free(ham_fcc_sqlite *fcc_sqlite) {
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        if(fcc_sqlite->dictionaries[i] == NULL)
+            continue;
+
+        for(int field = 0; HAM_FCC_COLUMN_TYPES[i][field] != HAM_NULL_CHAR; field++)
+            ham_dict_destroy(&fcc_sqlite->dictionaries[i][field]);
+
+        free(fcc_sqlite->dictionaries[i]);
+        fcc_sqlite->dictionaries[i] = NULL;
+    }
+}
+
+/*
+ * Builds the lookup indexes on the loaded tables and reports how long each took. The page cache is
+ * made large enough for the sorts to stay in memory, and SQLite may use the conversion threads to
+ * sort.
+ */
+int ham_sqlite_create_indexes(ham_fcc_sqlite *fcc_sqlite, const int threads) {
+    int cache_size = fcc_sqlite->index_cache_size;
+    double begin;
+    int error = HAM_OK;
+
+    /* Each sort thread fills up to a cache's worth before it writes out; a budget is shared */
+    if(fcc_sqlite->memory_budget > 0)
+        cache_size /= threads + 1;
+
+    if(cache_size > 0)
+        ham_sqlite_pragma(fcc_sqlite->database, "PRAGMA cache_size = -%d", cache_size);
+
+    ham_sqlite_pragma(fcc_sqlite->database, "PRAGMA threads = %d", threads);
+
+    begin = ham_seconds();
+
+    for(size_t i = 0; i < HAM_SQLITE_INDEX_COUNT && error == HAM_OK; i++) {
+        /* A clustered table is already ordered by license */
+        if(fcc_sqlite->clustered == HAM_BOOL_YES
+                && !strcmp(HAM_SQLITE_INDEXES[i].column, "unique_system_identifier"))
+            continue;
+
+        error = ham_sqlite_create_index(fcc_sqlite, &HAM_SQLITE_INDEXES[i]);
+    }
+
+    for(size_t i = 0; i < HAM_SQLITE_CALLSIGN_PARTS_INDEX_COUNT && error == HAM_OK
+            && fcc_sqlite->callsign_parts == HAM_BOOL_YES; i++)
+        error = ham_sqlite_create_index(fcc_sqlite, &HAM_SQLITE_CALLSIGN_PARTS_INDEXES[i]);
+
+    if(error == HAM_OK)
+        printf("Indexes built: %.2f s\n", ham_seconds() - begin);
+
+    return error;
+}
+
+int ham_sqlite_create_index(ham_fcc_sqlite *fcc_sqlite, const ham_sqlite_index *index) {
+    char *sql;
+    double start;
+    int rc;
+
+    sql = sqlite3_mprintf(HAM_SQLITE_INDEX, index->table, index->column, index->table,
+                            index->columns != NULL ? index->columns : index->column);
+    if(sql == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    start = ham_seconds();
+    rc = sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+    sqlite3_free(sql);
+
+    if(rc != SQLITE_OK) {
+        fprintf(stderr, "Index %s_%s: %s\n", index->table, index->column,
+                sqlite3_errmsg(fcc_sqlite->database));
+        return HAM_ERROR_SQLITE_CREATE_INDEXES;
+    }
+
+    printf("Index %s_%s: %.2f s\n", index->table, index->column, ham_seconds() - start);
+
+    return HAM_OK;
+}
+
+/*
+ * Builds the licenses table in one pass over the AM, EN and HD files, without a join in SQL. The
+ * files are essentially in license order, so they are merged like sorted runs: the smallest
+ * license at the head of the three files is written with the fields of all of them, and the files
+ * move on past it. A record that comes after a larger license in its own file is out of order; it
+ * is written on its own into the row its license already has, so nothing has to be held back and
+ * memory stays the same however the files are ordered.
+ */
+int ham_sqlite_build_licenses(ham_fcc_sqlite *fcc_sqlite, const ham_fcc_database *fcc_database) {
+    ham_license_stream streams[HAM_LICENSE_FILE_COUNT];
+    sqlite3_stmt *insert_stmt = NULL;
+    sqlite3_stmt *upsert_stmt = NULL;
+    unsigned int joined = 0, late = 0;
+    double start = ham_seconds();
+    INT64 key;
+    char *sql;
+    int error = HAM_OK, rc, bound, preferred;
+    size_t opened = 0;
+
+    /* A stream was read once by the load and cannot be read again */
+    for(size_t i = 0; i < HAM_LICENSE_FILE_COUNT; i++) {
+        if(fcc_database->files[HAM_LICENSE_FILES[i]].source != NULL) {
+            fprintf(stderr, "Licenses table skipped: %s was read from a stream\n",
+                    FCC_FILENAMES[HAM_LICENSE_FILES[i]]);
+            return HAM_OK;
+        }
+    }
+
+    error = ham_sqlite_licenses_prepare(fcc_sqlite, &insert_stmt, &upsert_stmt);
+
+    for(; error == HAM_OK && opened < HAM_LICENSE_FILE_COUNT; opened++) {
+        ham_license_stream *stream = &streams[opened];
+        const ham_fcc_file *file = &fcc_database->files[HAM_LICENSE_FILES[opened]];
+        sqlite3_stmt *sql_stmt;
+        unsigned int *currentline;
+
+        memset(stream, 0, sizeof(ham_license_stream));
+        stream->fcc_file = HAM_LICENSE_FILES[opened];
+        stream->last = INT64_MIN;
+        ham_sqlite_file_target(fcc_sqlite, stream->fcc_file, &stream->num_fields, &sql_stmt,
+                                &currentline);
+
+        /* A file that is not there has nothing to add */
+        if(file->open != HAM_BOOL_YES) {
+            stream->done = HAM_BOOL_YES;
+            continue;
+        }
+
+        error = ham_fcc_reader_init(&stream->reader, file);
+        if(fcc_sqlite->memory_budget > 0)
+            stream->reader.release = fcc_sqlite->chunk_size;
+
+        if(error == HAM_OK)
+            error = ham_license_stream_next(stream, upsert_stmt, &late);
+    }
+
+    while(error == HAM_OK) {
+        key = INT64_MAX;
+        for(size_t i = 0; i < HAM_LICENSE_FILE_COUNT; i++) {
+            if(streams[i].done != HAM_BOOL_YES && streams[i].key < key)
+                key = streams[i].key;
+        }
+
+        if(key == INT64_MAX)
+            break;
+
+        sqlite3_clear_bindings(insert_stmt);
+        sqlite3_bind_int64(insert_stmt, 1, key);
+
+        /* Every record of the license; the first one of a file, or its licensee, is the one used */
+        for(size_t i = 0; i < HAM_LICENSE_FILE_COUNT && error == HAM_OK; i++) {
+            ham_license_stream *stream = &streams[i];
+
+            if(stream->done == HAM_BOOL_YES || stream->key != key)
+                continue;
+
+            stream->last = key;
+            bound = HAM_BOOL_NO;
+            preferred = HAM_BOOL_NO;
+
+            while(error == HAM_OK && stream->done != HAM_BOOL_YES && stream->key == key) {
+                if(preferred != HAM_BOOL_YES && (bound != HAM_BOOL_YES
+                        || ham_license_stream_preferred(stream) == HAM_BOOL_YES)) {
+                    ham_license_stream_bind(stream, insert_stmt);
+                    bound = HAM_BOOL_YES;
+                    preferred = ham_license_stream_preferred(stream);
+                }
+
+                error = ham_license_stream_next(stream, upsert_stmt, &late);
+            }
+        }
+
+        if(error != HAM_OK)
+            break;
+
+        rc = sqlite3_step(insert_stmt);
+        sqlite3_reset(insert_stmt);
+
+        if(rc != SQLITE_DONE) {
+            fprintf(stderr, "Error (%d): Message: %s - Failed to insert license %lld\n", rc,
+                    sqlite3_errmsg(fcc_sqlite->database), (long long)key);
+            error = HAM_ERROR_SQLITE_INSERT;
+        }
+
+        joined++;
+    }
+
+    for(size_t i = 0; i < opened; i++)
+        ham_fcc_reader_terminate(&streams[i].reader);
+
+    sqlite3_finalize(insert_stmt);
+    sqlite3_finalize(upsert_stmt);
+
+    if(error != HAM_OK)
+        return error;
+
+    /* Looked up by callsign, so like the other indexes it is built once the table is full */
+    sql = sqlite3_mprintf(HAM_SQLITE_INDEX, "licenses", "callsign", "licenses", "callsign");
+    if(sql == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    rc = sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+    sqlite3_free(sql);
+
+    if(rc != SQLITE_OK) {
+        fprintf(stderr, "Index licenses_callsign: %s\n", sqlite3_errmsg(fcc_sqlite->database));
+        return HAM_ERROR_SQLITE_CREATE_INDEXES;
+    }
+
+    printf("Licenses joined: %u (%u records out of order), %.2f s\n", joined, late,
+            ham_seconds() - start);
+
+    return HAM_OK;
+}
+
+/* Creates the licenses table and prepares its statements, all generated from its columns */
+int ham_sqlite_licenses_prepare(ham_fcc_sqlite *fcc_sqlite, sqlite3_stmt **insert_stmt,
+                                sqlite3_stmt **upsert_stmt) {
+    char *columns = NULL, *names = NULL, *values = NULL, *updates = NULL;
+    char *sql;
+    int error = HAM_OK;
+    int rc;
+
+    for(size_t i = 0; i < HAM_LICENSE_COLUMN_COUNT; i++) {
+        const ham_license_column *column = &HAM_LICENSE_COLUMNS[i];
+        char type = HAM_FCC_COLUMN_TYPES[column->fcc_file][column->field];
+
+        columns = sqlite3_mprintf("%z,%s %s", columns, column->name,
+                                    type == HAM_VALUE_INTEGER || type == HAM_VALUE_DATE ?
+                                    "INTEGER" : "TEXT");
+        names = sqlite3_mprintf("%z,%s", names, column->name);
+        values = sqlite3_mprintf("%z,?", values);
+        updates = sqlite3_mprintf("%z%s%s = coalesce(excluded.%s, %s)", updates,
+                                    i > 0 ? "," : "", column->name, column->name, column->name);
+    }
+
+    if(columns == NULL || names == NULL || values == NULL || updates == NULL)
+        error = HAM_ERROR_MALLOC_FAIL;
+
+    if(error == HAM_OK) {
+        sql = sqlite3_mprintf(HAM_SQLITE_LICENSES_TABLE, columns);
+        rc = sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+        sqlite3_free(sql);
+
+        if(rc != SQLITE_OK) {
+            fprintf(stderr, "Error (%d): Message: %s - Failed to create licenses\n", rc,
+                    sqlite3_errmsg(fcc_sqlite->database));
+            error = HAM_ERROR_SQLITE_CREATE_TABLES;
+        }
+    }
+
+    if(error == HAM_OK) {
+        sql = sqlite3_mprintf(HAM_SQLITE_LICENSES_INSERT, names, values);
+        rc = sqlite3_prepare_v2(fcc_sqlite->database, sql, -1, insert_stmt, NULL);
+        sqlite3_free(sql);
+
+        if(rc == SQLITE_OK) {
+            sql = sqlite3_mprintf(HAM_SQLITE_LICENSES_UPSERT, names, values, updates);
+            rc = sqlite3_prepare_v2(fcc_sqlite->database, sql, -1, upsert_stmt, NULL);
+            sqlite3_free(sql);
+        }
+
+        if(rc != SQLITE_OK) {
+            fprintf(stderr, "Error (%d): Message: %s - Failed to prepare licenses\n", rc,
+                    sqlite3_errmsg(fcc_sqlite->database));
+            error = HAM_ERROR_SQLITE_PREPARE_STMT;
+        }
+    }
+
+    sqlite3_free(columns);
+    sqlite3_free(names);
+    sqlite3_free(values);
+    sqlite3_free(updates);
+
+    return error;
+}
+
+/*
+ * Moves the stream to its next record that is in order. Records that are not are written into
+ * their license's row as they are met. The end of the file sets done.
+ */
+int ham_license_stream_next(ham_license_stream *stream, sqlite3_stmt *upsert_stmt,
+                            unsigned int *late) {
+    ham_record record;
+    int rc;
+
+    while(ham_fcc_reader_next_record(&stream->reader, &record) == HAM_OK) {
+        if(record.length == 0)
+            continue;
+
+        ham_parse_record(stream->fields, &record, stream->num_fields);
+
+        /* Field 1 of every record type is the license's unique system identifier */
+        if(ham_parse_int64(stream->fields[1].data, stream->fields[1].length, &stream->key)
+                != HAM_OK)
+            continue;
+
+        if(stream->key >= stream->last)
+            return HAM_OK;
+
+        /* Only the records the join would have used */
+        if(ham_license_stream_preferred(stream) != HAM_BOOL_YES)
+            continue;
+
+        sqlite3_clear_bindings(upsert_stmt);
+        sqlite3_bind_int64(upsert_stmt, 1, stream->key);
+        ham_license_stream_bind(stream, upsert_stmt);
+
+        rc = sqlite3_step(upsert_stmt);
+        sqlite3_reset(upsert_stmt);
+
+        if(rc != SQLITE_DONE)
+            return HAM_ERROR_SQLITE_INSERT;
+
+        (*late)++;
+    }
+
+    stream->done = HAM_BOOL_YES;
+
+    return stream->reader.error;
+}
+
+/* Whether the current record is the one to take a license's fields from: the licensee entity */
+int ham_license_stream_preferred(const ham_license_stream *stream) {
+    const ham_field *type = &stream->fields[HAM_LICENSE_ENTITY_TYPE];
+
+    if(stream->fcc_file != HAM_FCC_FILE_EN)
+        return HAM_BOOL_YES;
+
+    return type->length == strlen(HAM_LICENSE_LICENSEE)
+            && !memcmp(type->data, HAM_LICENSE_LICENSEE, type->length) ? HAM_BOOL_YES : HAM_BOOL_NO;
+}
+
+/*
+ * Binds the columns the current record has. The record is gone by the time the row is written, so
+ * text is copied instead of bound in place.
+ */
+int ham_license_stream_bind(const ham_license_stream *stream, sqlite3_stmt *sql_stmt) {
+    int rc = SQLITE_OK;
+    INT64 value;
+
+    for(size_t i = 0; i < HAM_LICENSE_COLUMN_COUNT && rc == SQLITE_OK; i++) {
+        const ham_license_column *column = &HAM_LICENSE_COLUMNS[i];
+        const ham_field *field = &stream->fields[column->field];
+        char type = HAM_FCC_COLUMN_TYPES[column->fcc_file][column->field];
+        int index = (int)i + 2;
+
+        if(column->fcc_file != stream->fcc_file)
+            continue;
+
+        if(field->length == 0)
+            rc = sqlite3_bind_null(sql_stmt, index);
+        else if(type == HAM_VALUE_INTEGER
+                && ham_parse_int64(field->data, field->length, &value) == HAM_OK)
+            rc = sqlite3_bind_int64(sql_stmt, index, value);
+        else if(type == HAM_VALUE_DATE
+                && ham_parse_date(field->data, field->length, &value) == HAM_OK)
+            rc = sqlite3_bind_int64(sql_stmt, index, value);
+        else
+            rc = sqlite3_bind_text(sql_stmt, index, field->data, (int)field->length,
+                                    SQLITE_TRANSIENT);
+    }
+
+    return rc == SQLITE_OK ? HAM_OK : HAM_ERROR_GENERIC;
+}
+
+/* Creates the entities_search table, noting whether it was already there */
+int ham_sqlite_name_search_create(ham_fcc_sqlite *fcc_sqlite) {
+    sqlite3_stmt *sql_stmt;
+
+    if(sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_NAME_SEARCH_EXISTS, -1, &sql_stmt,
+                            NULL))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    fcc_sqlite->name_search_existed = sqlite3_step(sql_stmt) == SQLITE_ROW ? HAM_BOOL_YES :
+                                        HAM_BOOL_NO;
+    sqlite3_finalize(sql_stmt);
+
+    if(sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_NAME_SEARCH_TABLE, NULL, NULL, NULL)) {
+        fprintf(stderr, "Name search: %s\n", sqlite3_errmsg(fcc_sqlite->database));
+        return HAM_ERROR_SQLITE_CREATE_TABLES;
+    }
+
+    return HAM_OK;
+}
+
+/*
+ * Fills the entities_search index once the entities are loaded. An update of a database that
+ * already has the index adds the rows of the licenses it replaced; anything else rebuilds it.
+ */
+int ham_sqlite_build_name_search(ham_fcc_sqlite *fcc_sqlite) {
+    const char *sql = HAM_SQLITE_NAME_SEARCH_REBUILD;
+    double start = ham_seconds();
+
+    if(fcc_sqlite->update == HAM_BOOL_YES && fcc_sqlite->name_search_existed == HAM_BOOL_YES)
+        sql = HAM_SQLITE_NAME_SEARCH_ADD;
+
+    if(fcc_sqlite->clustered == HAM_BOOL_YES
+            && sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_NAME_SEARCH_ID_INDEX, NULL, NULL,
+                            NULL))
+        return HAM_ERROR_SQLITE_CREATE_INDEXES;
+
+    if(sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL)) {
+        fprintf(stderr, "Name search: %s\n", sqlite3_errmsg(fcc_sqlite->database));
+        return HAM_ERROR_SQLITE_CREATE_INDEXES;
+    }
+
+    printf("Name search index: %.2f s\n", ham_seconds() - start);
+
+    return HAM_OK;
+}
+
+/* Writes the callsign index file out of the loaded tables, one license per callsign */
+int ham_sqlite_write_callsign_index(ham_fcc_sqlite *fcc_sqlite, const char *path) {
+    ham_index_builder builder;
+    ham_index_slot record;
+    sqlite3_stmt *sql_stmt;
+    uint32_t kept = 0;
+    unsigned int skipped = 0;
+    double start = ham_seconds();
+    char *sql;
+    int error = HAM_OK, rc;
+
+    if(fcc_sqlite->encode == HAM_BOOL_YES)
+        sql = sqlite3_mprintf(HAM_SQLITE_CALLSIGN_INDEX_SELECT, "headers_decoded",
+                                "amateurs_decoded");
+    else
+        sql = sqlite3_mprintf(HAM_SQLITE_CALLSIGN_INDEX_SELECT, "headers", "amateurs");
+
+    if(sql == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
+
+    rc = sqlite3_prepare_v2(fcc_sqlite->database, sql, -1, &sql_stmt, NULL);
+    sqlite3_free(sql);
+
+    if(rc != SQLITE_OK) {
+        fprintf(stderr, "Error (%d): Message: %s - Failed to read the callsigns\n", rc,
+                sqlite3_errmsg(fcc_sqlite->database));
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+    }
+
+    ham_index_builder_init(&builder);
+
+    while(error == HAM_OK && (rc = sqlite3_step(sql_stmt)) == SQLITE_ROW) {
+        const char *status = (const char *)sqlite3_column_text(sql_stmt, 3);
+        const char *operator_class = (const char *)sqlite3_column_text(sql_stmt, 4);
+
+        memset(&record, 0, sizeof(record));
+        record.unique_system_identifier = sqlite3_column_int64(sql_stmt, 1);
+        if(sqlite3_column_type(sql_stmt, 2) == SQLITE_INTEGER)
+            record.expired_date = (int32_t)sqlite3_column_int64(sql_stmt, 2);
+        record.license_status = status != NULL ? status[0] : HAM_NULL_CHAR;
+        record.operator_class = operator_class != NULL ? operator_class[0] : HAM_NULL_CHAR;
+
+        error = ham_index_builder_add(&builder, (const char *)sqlite3_column_text(sql_stmt, 0),
+                                        (size_t)sqlite3_column_bytes(sql_stmt, 0), &record);
+
+        /* A callsign too long for the index */
+        if(error == HAM_ERROR_GENERIC) {
+            skipped++;
+            error = HAM_OK;
+        }
+    }
+
+    if(error == HAM_OK && rc != SQLITE_DONE) {
+        fprintf(stderr, "Error (%d): Message: %s - Failed to read the callsigns\n", rc,
+                sqlite3_errmsg(fcc_sqlite->database));
+        error = HAM_ERROR_GENERIC;
+    }
+
+    sqlite3_finalize(sql_stmt);
+
+    /* The licenses of a callsign end up together, the one to keep first */
+    if(error == HAM_OK && builder.count > 0) {
+        qsort(builder.slots, builder.count, sizeof(ham_index_slot), ham_sqlite_callsign_compare);
+
+        for(uint32_t i = 0; i < builder.count; i++) {
+            if(kept == 0 || memcmp(builder.slots[i].callsign, builder.slots[kept - 1].callsign,
+                                    HAM_INDEX_CALLSIGN_SIZE))
+                builder.slots[kept++] = builder.slots[i];
+        }
+
+        builder.count = kept;
+    }
+
+    if(error == HAM_OK)
+        error = ham_index_write(&builder, path);
+
+    if(error == HAM_OK)
+        printf("Callsign index: %u callsigns, %u skipped, %.2f s\n", builder.count, skipped,
+                ham_seconds() - start);
+    else
+        fprintf(stderr, "Error: failed to write the callsign index %s\n", path);
+
+    ham_index_builder_destroy(&builder);
+
+    return error;
+}
+
+/* By callsign, then the license to keep first: an active one, or else the one that expires last */
+int ham_sqlite_callsign_compare(const void *a, const void *b) {
+    const ham_index_slot *left = a, *right = b;
+    int result = memcmp(left->callsign, right->callsign, HAM_INDEX_CALLSIGN_SIZE);
+    int left_active = left->license_status == HAM_LICENSE_ACTIVE;
+    int right_active = right->license_status == HAM_LICENSE_ACTIVE;
+
+    if(result != 0)
+        return result;
+
+    if(left_active != right_active)
+        return left_active ? -1 : 1;
+
+    if(left->expired_date != right->expired_date)
+        return left->expired_date > right->expired_date ? -1 : 1;
+
+    if(left->unique_system_identifier != right->unique_system_identifier)
+        return left->unique_system_identifier > right->unique_system_identifier ? -1 : 1;
+
+    return 0;
+}
+
+/* Indexes the tables by license and prepares the statements used to replace a license's rows */
+int ham_sqlite_update_prepare(ham_fcc_sqlite *fcc_sqlite) {
+    char *sql;
+    int rc;
+
+    if(sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_UPDATE_TABLE, NULL, NULL, NULL)
+            || sqlite3_exec(fcc_sqlite->database, "DELETE FROM temp.ham_update_licenses", NULL,
+                            NULL, NULL))
+        return HAM_ERROR_SQLITE_CREATE_TABLES;
+
+    if(sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_UPDATE_MARK, -1,
+                            &fcc_sqlite->mark_stmt, NULL))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT && fcc_sqlite->clustered != HAM_BOOL_YES; i++) {
+        sql = sqlite3_mprintf(HAM_SQLITE_UPDATE_INDEX, HAM_SQLITE_TABLE_NAMES[i],
+                                HAM_SQLITE_TABLE_NAMES[i]);
+        if(sql == NULL)
+            return HAM_ERROR_MALLOC_FAIL;
+
+        rc = sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+        sqlite3_free(sql);
+
+        if(rc != SQLITE_OK)
+            return HAM_ERROR_SQLITE_CREATE_TABLES;
+    }
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        sql = sqlite3_mprintf(HAM_SQLITE_UPDATE_DELETE, HAM_SQLITE_TABLE_NAMES[i]);
+        if(sql == NULL)
+            return HAM_ERROR_MALLOC_FAIL;
+
+        rc = sqlite3_prepare_v2(fcc_sqlite->database, sql, -1, &fcc_sqlite->delete_stmt[i], NULL);
+        sqlite3_free(sql);
+
+        if(rc != SQLITE_OK)
+            return HAM_ERROR_SQLITE_PREPARE_STMT;
+    }
+
+    if(fcc_sqlite->callsign_parts == HAM_BOOL_YES) {
+        sql = sqlite3_mprintf(HAM_SQLITE_UPDATE_INDEX, "callsign_parts", "callsign_parts");
+        if(sql == NULL)
+            return HAM_ERROR_MALLOC_FAIL;
+
+        rc = sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+        sqlite3_free(sql);
+
+        if(rc != SQLITE_OK)
+            return HAM_ERROR_SQLITE_CREATE_TABLES;
+
+        sql = sqlite3_mprintf(HAM_SQLITE_UPDATE_DELETE, "callsign_parts");
+        if(sql == NULL)
+            return HAM_ERROR_MALLOC_FAIL;
+
+        rc = sqlite3_prepare_v2(fcc_sqlite->database, sql, -1, &fcc_sqlite->parts_delete_stmt,
+                                NULL);
+        sqlite3_free(sql);
+
+        if(rc != SQLITE_OK)
+            return HAM_ERROR_SQLITE_PREPARE_STMT;
+    }
+
+    /* A new index is filled from scratch at the end, so there is nothing to remove from it */
+    if(fcc_sqlite->name_search_existed == HAM_BOOL_YES
+            && sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_NAME_SEARCH_DELETE, -1,
+                                    &fcc_sqlite->search_delete_stmt, NULL))
+        return HAM_ERROR_SQLITE_PREPARE_STMT;
+
+    fcc_sqlite->update = HAM_BOOL_YES;
+
+    return HAM_OK;
+}
+
+void ham_sqlite_update_finalize(ham_fcc_sqlite *fcc_sqlite) {
+    sqlite3_finalize(fcc_sqlite->mark_stmt);
+    fcc_sqlite->mark_stmt = NULL;
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        sqlite3_finalize(fcc_sqlite->delete_stmt[i]);
+        fcc_sqlite->delete_stmt[i] = NULL;
+    }
+
+    sqlite3_finalize(fcc_sqlite->parts_delete_stmt);
+    fcc_sqlite->parts_delete_stmt = NULL;
+
+    sqlite3_finalize(fcc_sqlite->search_delete_stmt);
+    fcc_sqlite->search_delete_stmt = NULL;
+
+    fcc_sqlite->update = HAM_BOOL_NO;
+}
+
+/* Deletes every row of the license from all the tables, unless this update already did */
+int ham_sqlite_update_license(ham_fcc_sqlite *fcc_sqlite, const ham_field *identifier) {
+    int rc;
+
+    if(identifier->length == 0)
+        return HAM_OK;
+
+    ham_sqlite_bind_field(fcc_sqlite->mark_stmt, 1, identifier, HAM_VALUE_INTEGER, NULL);
+    rc = sqlite3_step(fcc_sqlite->mark_stmt);
+    sqlite3_reset(fcc_sqlite->mark_stmt);
+
+    if(rc != SQLITE_DONE)
+        return HAM_ERROR_SQLITE_INSERT;
+
+    if(sqlite3_changes(fcc_sqlite->database) == 0)
+        return HAM_OK;
+
+    /* The index reads the old text from the rows, so it goes before they are deleted */
+    if(fcc_sqlite->search_delete_stmt != NULL) {
+        ham_sqlite_bind_field(fcc_sqlite->search_delete_stmt, 1, identifier, HAM_VALUE_INTEGER,
+                                NULL);
+        rc = sqlite3_step(fcc_sqlite->search_delete_stmt);
+        sqlite3_reset(fcc_sqlite->search_delete_stmt);
+
+        if(rc != SQLITE_DONE)
+            return HAM_ERROR_SQLITE_INSERT;
+    }
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        ham_sqlite_bind_field(fcc_sqlite->delete_stmt[i], 1, identifier, HAM_VALUE_INTEGER,
+                                NULL);
+        rc = sqlite3_step(fcc_sqlite->delete_stmt[i]);
+        sqlite3_reset(fcc_sqlite->delete_stmt[i]);
+
+        if(rc != SQLITE_DONE) {
+            fprintf(stderr, "Error (%d): Message: %s - Failed to delete license %.*s from %s\n",
+                        rc, sqlite3_errmsg(fcc_sqlite->database), (int)identifier->length,
+                        identifier->data, HAM_SQLITE_TABLE_NAMES[i]);
+
+            return HAM_ERROR_SQLITE_INSERT;
+        }
+    }
+
+    if(fcc_sqlite->parts_delete_stmt != NULL) {
+        ham_sqlite_bind_field(fcc_sqlite->parts_delete_stmt, 1, identifier, HAM_VALUE_INTEGER,
+                                NULL);
+        rc = sqlite3_step(fcc_sqlite->parts_delete_stmt);
+        sqlite3_reset(fcc_sqlite->parts_delete_stmt);
+
+        if(rc != SQLITE_DONE)
+            return HAM_ERROR_SQLITE_INSERT;
+    }
+
+    fcc_sqlite->licenses_replaced++;
+
+    return HAM_OK;
+}
+
+/* Number of fields, insert statement and line counter of a file */
+int ham_sqlite_file_target(ham_fcc_sqlite *fcc_sqlite, const int fcc_file, int *num_fields,
+                            sqlite3_stmt **sql_stmt, unsigned int **currentline) {
+    switch (fcc_file) {
+        case HAM_FCC_FILE_AM:
+            *num_fields = HAM_FCC_AM_FIELDS;
+            *sql_stmt = fcc_sqlite->am_stmt;
+            *currentline = &fcc_sqlite->am_line;
+            break;
+
+        case HAM_FCC_FILE_EN:
+            *num_fields = HAM_FCC_EN_FIELDS;
+            *sql_stmt = fcc_sqlite->en_stmt;
+            *currentline = &fcc_sqlite->en_line;
+            break;
+
+        case HAM_FCC_FILE_HD:
+            *num_fields = HAM_FCC_HD_FIELDS;
+            *sql_stmt = fcc_sqlite->hd_stmt;
+            *currentline = &fcc_sqlite->hd_line;
+            break;
+
+        case HAM_FCC_FILE_HS:
+            *num_fields = HAM_FCC_HS_FIELDS;
+            *sql_stmt = fcc_sqlite->hs_stmt;
+            *currentline = &fcc_sqlite->hs_line;
+            break;
+
+        case HAM_FCC_FILE_CO:
+            *num_fields = HAM_FCC_CO_FIELDS;
+            *sql_stmt = fcc_sqlite->co_stmt;
+            *currentline = &fcc_sqlite->co_line;
+            break;
+
+        case HAM_FCC_FILE_LA:
+            *num_fields = HAM_FCC_LA_FIELDS;
+            *sql_stmt = fcc_sqlite->la_stmt;
+            *currentline = &fcc_sqlite->la_line;
+            break;
+
+        case HAM_FCC_FILE_SC:
+            *num_fields = HAM_FCC_SC_FIELDS;
+            *sql_stmt = fcc_sqlite->sc_stmt;
+            *currentline = &fcc_sqlite->sc_line;
+            break;
+
+        case HAM_FCC_FILE_SF:
+            *num_fields = HAM_FCC_SF_FIELDS;
+            *sql_stmt = fcc_sqlite->sf_stmt;
+            *currentline = &fcc_sqlite->sf_line;
+            break;
+
+        default:
+            return HAM_ERROR_GENERIC;
+    }
+
+    return HAM_OK;
+}
+
+int ham_sqlite_fcc_convert_file(ham_fcc_sqlite *fcc_sqlite, const ham_fcc_file *data,
+                                const int fcc_file) {
+    ham_fcc_reader reader;
+    ham_record record;
+    int error = HAM_OK;
+    int num_fields = 0;
+    sqlite3_stmt *sql_stmt = NULL;
+    ham_field fields[HAM_SPLIT_MAX_FIELDS];
+
+    unsigned int *currentline;
+
+    error = ham_sqlite_file_target(fcc_sqlite, fcc_file, &num_fields, &sql_stmt, &currentline);
+    if(error != HAM_OK)
+        return error;
+
+    /* Small files are not worth starting threads for */
+    if(fcc_sqlite->threads > 0
+            && (data->map.mapped != HAM_BOOL_YES || (uint64_t)data->size > fcc_sqlite->chunk_size))
+        return ham_sqlite_fcc_convert_pipelined(fcc_sqlite, data, fcc_file, num_fields, sql_stmt,
+                                                currentline);
+
+    /* A resumed load goes on from the file's checkpoint */
+    error = ham_fcc_reader_init(&reader, data);
+    if(error == HAM_OK)
+        error = ham_fcc_reader_seek(&reader, fcc_sqlite->resume_offset[fcc_file]);
+
+    if(error != HAM_OK) {
+        ham_fcc_reader_terminate(&reader);
+        return error;
+    }
+
+    if(fcc_sqlite->memory_budget > 0)
+        reader.release = fcc_sqlite->chunk_size;
+
+    while(fcc_sqlite->error == HAM_OK && ham_fcc_reader_next_record(&reader, &record) == HAM_OK) {
+        (*currentline)++;
+
+        /* Blank lines, usually a trailing one, are not records */
+        if(record.length == 0)
+            continue;
+
+        error = ham_parse_record(fields, &record, num_fields);
+        if(error != HAM_OK) {
+            ham_fcc_reader_terminate(&reader);
+            return HAM_ERROR_GENERIC;
+        }
+
+        ham_sqlite_insert_fields(fcc_sqlite, fields, num_fields, sql_stmt, fcc_file, *currentline);
+
+        if(ham_sqlite_batch_full(fcc_sqlite))
+            ham_sqlite_checkpoint(fcc_sqlite, data, fcc_file, reader.offset, *currentline,
+                                    HAM_BOOL_NO);
+    }
+
+    if(reader.error != HAM_OK)
+        error = reader.error;
+    else if(fcc_sqlite->error != HAM_OK)
+        error = fcc_sqlite->error;
+    else
+        error = ham_sqlite_checkpoint(fcc_sqlite, data, fcc_file, reader.offset, *currentline,
+                                        HAM_BOOL_YES);
+
+    ham_fcc_reader_terminate(&reader);
+
+    return error;
+}
+
+/*
+ * Converts a stream of the files concatenated together. Each record goes to the table of its record
+ * type field, so the order of the files does not matter. Records are handled on this thread only.
+ */
+int ham_sqlite_fcc_convert_mixed(ham_fcc_sqlite *fcc_sqlite, const ham_fcc_file *data) {
+    ham_fcc_reader reader;
+    ham_record record;
+    int error, fcc_file, num_fields;
+    sqlite3_stmt *sql_stmt;
+    ham_field fields[HAM_SPLIT_MAX_FIELDS];
+
+    unsigned int *currentline;
+
+    error = ham_fcc_reader_init(&reader, data);
+    if(error != HAM_OK)
+        return error;
+
+    while(fcc_sqlite->error == HAM_OK && ham_fcc_reader_next_record(&reader, &record) == HAM_OK) {
+        if(record.length == 0)
+            continue;
+
+        fcc_file = ham_fcc_record_type(&record);
+        if(fcc_file == 0) {
+            fprintf(stderr, "Error: unknown record type %.2s - record skipped\n", record.line);
+            continue;
+        }
+
+        error = ham_sqlite_file_target(fcc_sqlite, fcc_file, &num_fields, &sql_stmt,
+                                        &currentline);
+        if(error != HAM_OK)
+            break;
+
+        (*currentline)++;
+
+        error = ham_parse_record(fields, &record, num_fields);
+        if(error != HAM_OK) {
+            error = HAM_ERROR_GENERIC;
+            break;
+        }
+
+        ham_sqlite_insert_fields(fcc_sqlite, fields, num_fields, sql_stmt, fcc_file, *currentline);
+
+        /* A stream is not resumed, so there is no checkpoint to keep */
+        if(ham_sqlite_batch_full(fcc_sqlite))
+            ham_sqlite_commit(fcc_sqlite);
+    }
+
+    if(error == HAM_OK)
+        error = reader.error != HAM_OK ? reader.error : fcc_sqlite->error;
+
+    ham_fcc_reader_terminate(&reader);
+
+    return error;
+}
+
+/*
+ * Converts the FCC files in a tar stream as they come by. Each entry is read through its own file,
+ * so large ones still go through the pipeline. Other entries are skipped.
+ */
+int ham_sqlite_fcc_convert_tar(ham_fcc_sqlite *fcc_sqlite, ham_tar *tar) {
+    ham_fcc_file file;
+    char name[HAM_FCC_NAME_SIZE];
+    INT64 size;
+    int error, fcc_file;
+
+    for(;;) {
+        error = ham_tar_next(tar, name, sizeof(name), &size);
+        if(error != HAM_OK || name[0] == '\0')
+            return error;
+
+        fcc_file = ham_fcc_file_index(name);
+        if(fcc_file == 0)
+            continue;
+
+        error = ham_fcc_file_open_source(&file, ham_tar_read_entry, tar);
+        if(error != HAM_OK)
+            return error;
+
+        file.size = size;
+
+        error = ham_sqlite_fcc_convert_file(fcc_sqlite, &file, fcc_file);
+        ham_fcc_file_close(&file);
+
+        if(error != HAM_OK)
+            return error;
+    }
+}
+
+/*
+ * Converts a file through the pipeline. One thread reads, the rest of the pipeline threads parse,
+ * and this thread only binds and steps the rows, which it receives in file order.
+ */
+int ham_sqlite_fcc_convert_pipelined(ham_fcc_sqlite *fcc_sqlite, const ham_fcc_file *data,
+                                        const int fcc_file, const int num_fields,
+                                        sqlite3_stmt *sql_stmt, unsigned int *currentline) {
+    ham_pipeline pipeline;
+    ham_parser *parser;
+    ham_slot *slot;
+    INT64 offset = fcc_sqlite->resume_offset[fcc_file];
+    const char *released = data->map.data;
+    int error;
+
+    error = ham_pipeline_start(&pipeline, data, num_fields,
+                                fcc_sqlite->threads > 1 ? fcc_sqlite->threads - 1 : 1,
+                                fcc_sqlite->chunk_size, offset);
+    if(error != HAM_OK)
+        return error;
+
+    for(INT64 chunk = 0; ; chunk++) {
+        parser = &pipeline.parsers[chunk % pipeline.num_parsers];
+
+        /* Only this thread aborts, so the pop cannot give up */
+        slot = ham_ring_pop(&parser->output, &pipeline.abort);
+
+        if(slot->batch.error != HAM_OK) {
+            error = slot->batch.error;
+            ham_ring_abort(&pipeline.abort);
+            break;
+        }
+
+        if(slot->last == HAM_BOOL_YES)
+            break;
+
+        for(int row = 0; row < slot->batch.rows && fcc_sqlite->error == HAM_OK; row++)
+            ham_sqlite_insert_fields(fcc_sqlite, &slot->batch.fields[row * num_fields],
+                                        num_fields, sql_stmt, fcc_file,
+                                        *currentline + slot->batch.lines[row]);
+
+        if(fcc_sqlite->error != HAM_OK) {
+            error = fcc_sqlite->error;
+            ham_ring_abort(&pipeline.abort);
+            break;
+        }
+
+        /* Chunks come back in file order, so everything before this one's end is done with */
+        if(fcc_sqlite->memory_budget > 0 && data->map.mapped == HAM_BOOL_YES)
+            ham_fcc_file_release(&released, slot->end);
+
+        *currentline += slot->batch.num_lines;
+        offset = slot->offset;
+        ham_ring_push(&parser->free, slot, &pipeline.abort);
+
+        /* A batch ends on a chunk, so its checkpoint is a place the pipeline can start again */
+        if(ham_sqlite_batch_full(fcc_sqlite)
+                && ham_sqlite_checkpoint(fcc_sqlite, data, fcc_file, offset, *currentline,
+                                            HAM_BOOL_NO) != HAM_OK) {
+            error = fcc_sqlite->error;
+            ham_ring_abort(&pipeline.abort);
+            break;
+        }
+    }
+
+    ham_pipeline_stop(&pipeline);
+
+    if(error == HAM_OK)
+        error = ham_sqlite_checkpoint(fcc_sqlite, data, fcc_file, offset, *currentline,
+                                        HAM_BOOL_YES);
+
+    return error;
+}
+
+/*
+ * Binds a field as its column type. Empty fields are NULL. A code column is bound as its code when
+ * it has a dictionary, which is only the case for the encoded schema.
+ */
+int ham_sqlite_bind_field(sqlite3_stmt *sql_stmt, const int index, const ham_field *field,
+                            const char type, ham_dict *dict) {
+    uint32_t code;
+    INT64 value;
+
+    if(field->length == 0)
+        return sqlite3_bind_null(sql_stmt, index);
+
+    if(type == HAM_VALUE_CODE && dict != NULL) {
+        if(ham_dict_intern(dict, field->data, field->length, &code) != HAM_OK)
+            return SQLITE_NOMEM;
+
+        return sqlite3_bind_int64(sql_stmt, index, code);
+    }
+
+    if(type == HAM_VALUE_INTEGER && ham_parse_int64(field->data, field->length, &value) == HAM_OK)
+        return sqlite3_bind_int64(sql_stmt, index, value);
+
+    if(type == HAM_VALUE_DATE && ham_parse_date(field->data, field->length, &value) == HAM_OK)
+        return sqlite3_bind_int64(sql_stmt, index, value);
+
+    return sqlite3_bind_text(sql_stmt, index, field->data, (int)field->length, SQLITE_STATIC);
+}
+
+/*
+ * Binds the field views and inserts the row. The views are bound as SQLITE_STATIC, so SQLite reads
+ * them straight out of the mapping or read buffer instead of making its own copy first.
+ */
+int ham_sqlite_insert_fields(ham_fcc_sqlite *fcc_sqlite, const ham_field *fields,
+                                const int num_fields, sqlite3_stmt *sql_stmt, const int fcc_file,
+                                const int currentline) {
+
+    ham_dict *dictionaries = fcc_sqlite->dictionaries[fcc_file];
+    int rc = 0;
+
+    /*
+     * Field 1 of every record type is the license's unique system identifier. A license that was
+     * only partly replaced cannot be left in the update, so a failure stops it and rolls it back.
+     */
+    if(fcc_sqlite->update == HAM_BOOL_YES && num_fields > 1
+            && ham_sqlite_update_license(fcc_sqlite, &fields[1]) != HAM_OK) {
+        fprintf(stderr, "Error: failed to replace license %.*s: %s\n", (int)fields[1].length,
+                    fields[1].data, sqlite3_errmsg(fcc_sqlite->database));
+        fcc_sqlite->error = HAM_ERROR_SQLITE_INSERT;
+
+        return HAM_ERROR_SQLITE_INSERT;
+    }
+
+    if(fcc_sqlite->clustered == HAM_BOOL_YES) {
+        /* Without the staging table no later row could be placed either */
+        sql_stmt = ham_sqlite_cluster_target(fcc_sqlite, fcc_file, &fields[1], sql_stmt);
+        if(sql_stmt == NULL) {
+            fprintf(stderr, "Error: unable to stage the rows of %s: %s\n",
+                        FCC_FILENAMES[fcc_file], sqlite3_errmsg(fcc_sqlite->database));
+            fcc_sqlite->error = HAM_ERROR_SQLITE_INSERT;
+
+            return HAM_ERROR_SQLITE_INSERT;
+        }
+
+        sqlite3_bind_int64(sql_stmt, sqlite3_bind_parameter_count(sql_stmt),
+                            fcc_sqlite->sequence[fcc_file] + 1);
+    }
+
+    for(int i = 0; i < num_fields; i++) {
+        rc = ham_sqlite_bind_field(sql_stmt, i+1, &fields[i], HAM_FCC_COLUMN_TYPES[fcc_file][i],
+                                    dictionaries != NULL ? &dictionaries[i] : NULL);
+
+        if(rc != SQLITE_OK) {
+            fprintf(stderr, "Error (%d): paramater binding failed. * File: %s * Index: %d\n", rc,
+                        FCC_FILENAMES[fcc_file], i);
+
+            if(rc == SQLITE_NOMEM)
+                fcc_sqlite->error = HAM_ERROR_MALLOC_FAIL;
+
+            return HAM_ERROR_GENERIC;
+        }
+    }
+
+    if(fcc_sqlite->compact != HAM_BOOL_YES) {
+        sqlite3_bind_text(sql_stmt, num_fields + 1, fcc_sqlite->time, -1, SQLITE_STATIC);
+        sqlite3_bind_text(sql_stmt, num_fields + 2, fcc_sqlite->time, -1, SQLITE_STATIC);
+    }
+
+    rc = sqlite3_step(sql_stmt);
 
-    /*
-     * This variable contains all the data need for the conversion process. It is passed to multiple
-     * sub-functions.
-     */
-    ham_fcc_sqlite *fcc_sqlite;
+    /* Every parameter is bound again for the next row, so there is no need to clear them */
+    sqlite3_reset(sql_stmt);
 
-    /* Conversion preparations */
+    if(rc != SQLITE_DONE)
+    {
+        fprintf(stderr, "Error (%d): Message: %s - Failed to insert record. File: %s; Line: %u\n", rc,
+                    sqlite3_errmsg(fcc_sqlite->database), FCC_FILENAMES[fcc_file], currentline);
 
-    if(ham_sqlite_init(&fcc_sqlite, filename))
-        return HAM_ERROR_SQLITE_INIT;
+        /* Out of memory or disk is not down to the record, so the rest would fail as well */
+        if((rc & 0xff) == SQLITE_NOMEM || (rc & 0xff) == SQLITE_FULL
+                || (rc & 0xff) == SQLITE_IOERR)
+            fcc_sqlite->error = HAM_ERROR_SQLITE_INSERT;
 
-    if(ham_sqlite_create_tables(fcc_sqlite))
-        return HAM_ERROR_SQLITE_CREATE_TABLES;
+        return HAM_ERROR_SQLITE_INSERT;
+    }
 
-    if(ham_sqlite_sql_prepare_stmt(fcc_sqlite))
-        return HAM_ERROR_SQLITE_PREPARE_STMT;
+    fcc_sqlite->sql_insert_calls++;
+    fcc_sqlite->sequence[fcc_file]++;
 
-    /* Perform the conversion */
-    if(fcc_database->am_open == HAM_BOOL_YES)
-        ham_sqlite_fcc_convert_file(fcc_sqlite, fcc_database->am, HAM_FCC_FILE_AM);
+    if(fcc_file == HAM_FCC_FILE_AM && fcc_sqlite->parts_stmt != NULL)
+        rc = ham_sqlite_insert_callsign_parts(fcc_sqlite, fields, num_fields);
+    else
+        rc = HAM_OK;
 
-    if(fcc_database->en_open == HAM_BOOL_YES)
-        ham_sqlite_fcc_convert_file(fcc_sqlite, fcc_database->en, HAM_FCC_FILE_EN);
+    if(rc == HAM_OK && (fcc_sqlite->commit_rows > 0 || fcc_sqlite->commit_bytes > 0))
+        ham_sqlite_batch_record(fcc_sqlite, fields, num_fields);
 
-    if(fcc_database->hd_open == HAM_BOOL_YES)
-        ham_sqlite_fcc_convert_file(fcc_sqlite, fcc_database->hd, HAM_FCC_FILE_HD);
+    return rc;
+}
 
-    if(fcc_database->hs_open == HAM_BOOL_YES)
-        ham_sqlite_fcc_convert_file(fcc_sqlite, fcc_database->hs, HAM_FCC_FILE_HS);
+/* Counts a record into the open transaction */
+void ham_sqlite_batch_record(ham_fcc_sqlite *fcc_sqlite, const ham_field *fields,
+                                const int num_fields) {
+    /* The fields and their delimiters */
+    fcc_sqlite->batch_rows++;
+    for(int i = 0; i < num_fields; i++)
+        fcc_sqlite->batch_bytes += fields[i].length + 1;
+}
 
-    if(fcc_database->co_open == HAM_BOOL_YES)
-        ham_sqlite_fcc_convert_file(fcc_sqlite, fcc_database->co, HAM_FCC_FILE_CO);
+/*
+ * Whether the open transaction holds commit_rows records or commit_bytes bytes. The caller then
+ * commits it at the next record boundary. An update stays one transaction, so it can still be
+ * rolled back whole.
+ */
+int ham_sqlite_batch_full(const ham_fcc_sqlite *fcc_sqlite) {
+    if(fcc_sqlite->update == HAM_BOOL_YES)
+        return HAM_BOOL_NO;
 
-    if(fcc_database->la_open == HAM_BOOL_YES)
-        ham_sqlite_fcc_convert_file(fcc_sqlite, fcc_database->la, HAM_FCC_FILE_LA);
+    return (fcc_sqlite->commit_rows > 0 && fcc_sqlite->batch_rows >= fcc_sqlite->commit_rows)
+            || (fcc_sqlite->commit_bytes > 0
+                && fcc_sqlite->batch_bytes >= fcc_sqlite->commit_bytes);
+}
 
-    if(fcc_database->sc_open == HAM_BOOL_YES)
-        ham_sqlite_fcc_convert_file(fcc_sqlite, fcc_database->sc, HAM_FCC_FILE_SC);
+/* Commits the open transaction and starts the next. A failed commit stops the load. */
+int ham_sqlite_commit(ham_fcc_sqlite *fcc_sqlite) {
+    fcc_sqlite->batch_rows = 0;
+    fcc_sqlite->batch_bytes = 0;
 
-    if(fcc_database->sf_open == HAM_BOOL_YES)
-        ham_sqlite_fcc_convert_file(fcc_sqlite, fcc_database->sf, HAM_FCC_FILE_SF);
+    if(sqlite3_exec(fcc_sqlite->database, "COMMIT", NULL, NULL, NULL) != SQLITE_OK
+            || sqlite3_exec(fcc_sqlite->database, "BEGIN TRANSACTION", NULL, NULL, NULL)
+                != SQLITE_OK) {
+        fprintf(stderr, "Error: commit failed: %s\n", sqlite3_errmsg(fcc_sqlite->database));
+        fcc_sqlite->error = HAM_ERROR_SQLITE_INSERT;
 
-    printf("Records inserted: %u\n", fcc_sqlite->sql_insert_calls);
+        return HAM_ERROR_SQLITE_INSERT;
+    }
 
-    /* Clean up */
-    ham_sqlite_sql_finalize_stmt(fcc_sqlite);
-    ham_sqlite_terminate(fcc_sqlite);
+    fcc_sqlite->commits++;
 
     return HAM_OK;
 }
 
-int ham_sqlite_init(ham_fcc_sqlite **fcc_sqlite, const char *filename) {
-    (*fcc_sqlite) = malloc(sizeof(ham_fcc_sqlite));
-    if((*fcc_sqlite) == NULL)
-        return HAM_ERROR_SQLITE_INIT;
+/*
+ * Commits the batch with the checkpoint of the file it ends in, the byte offset and line of the
+ * next record, if the load keeps checkpoints. The codes of the encoded schema go in with the rows
+ * that use them. The checkpoint that marks a file done is only written; the next commit takes it.
+ */
+int ham_sqlite_checkpoint(ham_fcc_sqlite *fcc_sqlite, const ham_fcc_file *data, const int fcc_file,
+                            const INT64 offset, const unsigned int line, const int done) {
+    sqlite3_stmt *sql_stmt = fcc_sqlite->checkpoint_stmt;
+    int error = HAM_OK;
 
-    if(filename == NULL)
-        filename = HAM_SQLITE_FILENAME;
+    if(sql_stmt != NULL) {
+        if(fcc_sqlite->encode == HAM_BOOL_YES)
+            error = ham_sqlite_encode_save(fcc_sqlite);
 
-    if(ham_sqlite_open_database_connection(&(*fcc_sqlite)->database, filename)) {
-        free((*fcc_sqlite));
-        (*fcc_sqlite) = NULL;
+        sqlite3_bind_text(sql_stmt, 1, FCC_FILENAMES[fcc_file], -1, SQLITE_STATIC);
+        sqlite3_bind_int64(sql_stmt, 2, data->size);
+        sqlite3_bind_int64(sql_stmt, 3, offset);
+        sqlite3_bind_int64(sql_stmt, 4, line);
+        sqlite3_bind_int(sql_stmt, 5, done);
 
-        return HAM_ERROR_SQLITE_OPEN_DATABASE_CONNECTION;
-    }
+        if(error == HAM_OK && sqlite3_step(sql_stmt) != SQLITE_DONE)
+            error = HAM_ERROR_SQLITE_INSERT;
 
-    if(sqlite3_exec((*fcc_sqlite)->database, "PRAGMA quick_check", NULL, NULL, NULL)) {
-        printf("Error: database file corrupt! Reseting the file...\n");
-        sqlite3_close((*fcc_sqlite)->database);
+        sqlite3_reset(sql_stmt);
 
-        if(ham_sqlite_reset_file(filename)) {
-            free((*fcc_sqlite));
-            (*fcc_sqlite) = NULL;
+        if(error != HAM_OK) {
+            fprintf(stderr, "Error: unable to write the checkpoint of %s: %s\n",
+                    FCC_FILENAMES[fcc_file], sqlite3_errmsg(fcc_sqlite->database));
+            fcc_sqlite->error = error;
 
-            return HAM_ERROR_SQLITE_RESET_FILE;
+            return error;
         }
-
-        ham_sqlite_open_database_connection(&(*fcc_sqlite)->database, filename);
     }
 
-    (*fcc_sqlite)->sql_insert_calls = 0;
-    (*fcc_sqlite)->am_line = 0;
-    (*fcc_sqlite)->en_line = 0;
-    (*fcc_sqlite)->hd_line = 0;
-    (*fcc_sqlite)->hs_line = 0;
-    (*fcc_sqlite)->co_line = 0;
-    (*fcc_sqlite)->la_line = 0;
-    (*fcc_sqlite)->sc_line = 0;
-    (*fcc_sqlite)->sf_line = 0;
-
-    ham_sqlite_init_time(*fcc_sqlite);
-
-    sqlite3_exec((*fcc_sqlite)->database, "PRAGMA syncronous = OFF", NULL, NULL, NULL);
-    sqlite3_exec((*fcc_sqlite)->database, "PRAGMA journal_mode = MEMORY", NULL, NULL, NULL);
-
-    sqlite3_exec((*fcc_sqlite)->database, "BEGIN TRANSACTION", NULL, NULL, NULL);
+    if(done == HAM_BOOL_YES)
+        return HAM_OK;
 
-    return HAM_OK;
+    return ham_sqlite_commit(fcc_sqlite);
 }
 
-int ham_sqlite_terminate(ham_fcc_sqlite *fcc_sqlite) {
+/*
+ * Creates the checkpoints table and its statement. A resumed load reads the checkpoints first:
+ * each file goes on from its offset and line, and one that is done is skipped. A file whose size
+ * is not the one it had is refused, as the offsets would no longer fall on its records.
+ */
+int ham_sqlite_checkpoints_prepare(ham_fcc_sqlite *fcc_sqlite,
+                                    const ham_fcc_database *fcc_database, const int resume) {
+    sqlite3_stmt *sql_stmt, *unused;
+    unsigned int *currentline;
+    const char *name;
+    int fcc_file, num_fields, rc = SQLITE_DONE, error = HAM_OK;
 
-    /* Can be safely called if already freed. */
-    if(fcc_sqlite == NULL)
-        return HAM_OK;
+    if(sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_CHECKPOINT_SELECT, -1, &sql_stmt,
+                            NULL) != SQLITE_OK) {
+        sqlite3_finalize(sql_stmt);
 
-    sqlite3_exec(fcc_sqlite->database, "END TRANSACTION", NULL, NULL, NULL);
+        if(resume == HAM_BOOL_YES) {
+            fprintf(stderr, "Error: %s has no checkpoints to resume from; convert it again "
+                    "without resuming\n", sqlite3_db_filename(fcc_sqlite->database, "main"));
+            return HAM_ERROR_GENERIC;
+        }
 
-    sqlite3_close(fcc_sqlite->database);
+        sql_stmt = NULL;
+    } else if(resume != HAM_BOOL_YES) {
+        printf("Warning: the database holds part of a conversion that did not finish; it can be "
+                "resumed instead\n");
+        sqlite3_finalize(sql_stmt);
+        sql_stmt = NULL;
+    }
 
-    free(fcc_sqlite);
-    return HAM_OK;
-}
+    while(sql_stmt != NULL && error == HAM_OK && (rc = sqlite3_step(sql_stmt)) == SQLITE_ROW) {
+        name = (const char *)sqlite3_column_text(sql_stmt, 0);
+        fcc_file = name != NULL ? ham_fcc_file_index(name) : 0;
 
-int ham_sqlite_sql_prepare_stmt(ham_fcc_sqlite *fcc_sqlite) {
+        if(fcc_file == 0
+                || ham_sqlite_file_target(fcc_sqlite, fcc_file, &num_fields, &unused,
+                                            &currentline) != HAM_OK)
+            continue;
 
-    if(sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_INSERT_FCC_AM, -1,
-                            &fcc_sqlite->am_stmt, NULL))
-        return HAM_ERROR_SQLITE_PREPARE_STMT;
+        if(fcc_database->files[fcc_file].open == HAM_BOOL_YES
+                && fcc_database->files[fcc_file].size != sqlite3_column_int64(sql_stmt, 1)) {
+            fprintf(stderr, "Error: %s is not the file the conversion started with\n", name);
+            error = HAM_ERROR_GENERIC;
+            break;
+        }
 
-    if(sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_INSERT_FCC_EN, -1,
-                            &fcc_sqlite->en_stmt, NULL))
-        return HAM_ERROR_SQLITE_PREPARE_STMT;
+        fcc_sqlite->resume_offset[fcc_file] = sqlite3_column_int64(sql_stmt, 2);
+        fcc_sqlite->resume_done[fcc_file] = sqlite3_column_int(sql_stmt, 4);
+        *currentline = (unsigned int)sqlite3_column_int64(sql_stmt, 3);
 
-    if(sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_INSERT_FCC_HD, -1,
-                            &fcc_sqlite->hd_stmt, NULL))
-        return HAM_ERROR_SQLITE_PREPARE_STMT;
+        if(fcc_sqlite->resume_done[fcc_file] == HAM_BOOL_YES)
+            printf("Resuming: %s is done\n", FCC_FILENAMES[fcc_file]);
+        else
+            printf("Resuming: %s from line %u\n", FCC_FILENAMES[fcc_file], *currentline + 1);
+    }
 
-    if(sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_INSERT_FCC_HS, -1,
-                            &fcc_sqlite->hs_stmt, NULL))
-        return HAM_ERROR_SQLITE_PREPARE_STMT;
+    if(sql_stmt != NULL && error == HAM_OK && rc != SQLITE_DONE)
+        error = HAM_ERROR_SQLITE_INSERT;
 
-    if(sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_INSERT_FCC_CO, -1,
-                            &fcc_sqlite->co_stmt, NULL))
-        return HAM_ERROR_SQLITE_PREPARE_STMT;
+    sqlite3_finalize(sql_stmt);
 
-    if(sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_INSERT_FCC_LA, -1,
-                            &fcc_sqlite->la_stmt, NULL))
-        return HAM_ERROR_SQLITE_PREPARE_STMT;
+    if(error != HAM_OK)
+        return error;
 
-    if(sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_INSERT_FCC_SC, -1,
-                            &fcc_sqlite->sc_stmt, NULL))
-        return HAM_ERROR_SQLITE_PREPARE_STMT;
+    if(sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_CHECKPOINT_TABLE, NULL, NULL, NULL)
+            != SQLITE_OK)
+        return HAM_ERROR_SQLITE_CREATE_TABLES;
 
-    if(sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_INSERT_FCC_SF, -1,
-                            &fcc_sqlite->sf_stmt, NULL))
+    if(sqlite3_prepare_v2(fcc_sqlite->database, HAM_SQLITE_CHECKPOINT_SET, -1,
+                            &fcc_sqlite->checkpoint_stmt, NULL) != SQLITE_OK)
         return HAM_ERROR_SQLITE_PREPARE_STMT;
 
     return HAM_OK;
 }
 
-int ham_sqlite_sql_finalize_stmt(ham_fcc_sqlite *fcc_sqlite) {
-    if(fcc_sqlite->am_stmt != NULL) {
-        sqlite3_finalize(fcc_sqlite->am_stmt);
-        fcc_sqlite->am_stmt = NULL;
-    }
+/* Drops the checkpoints once the load is complete. It goes in with the last transaction. */
+int ham_sqlite_checkpoints_finish(ham_fcc_sqlite *fcc_sqlite) {
+    sqlite3_finalize(fcc_sqlite->checkpoint_stmt);
+    fcc_sqlite->checkpoint_stmt = NULL;
 
-    if(fcc_sqlite->en_stmt != NULL) {
-        sqlite3_finalize(fcc_sqlite->en_stmt);
-        fcc_sqlite->en_stmt = NULL;
-    }
+    if(sqlite3_exec(fcc_sqlite->database, "DROP TABLE IF EXISTS ham_checkpoints", NULL, NULL,
+                    NULL) != SQLITE_OK)
+        return HAM_ERROR_SQLITE_INSERT;
 
-    if(fcc_sqlite->hd_stmt != NULL) {
-        sqlite3_finalize(fcc_sqlite->hd_stmt);
-        fcc_sqlite->hd_stmt = NULL;
-    }
+    return HAM_OK;
+}
 
-    if(fcc_sqlite->hs_stmt != NULL) {
-        sqlite3_finalize(fcc_sqlite->hs_stmt);
-        fcc_sqlite->hs_stmt = NULL;
-    }
+/* Adds the parts of an AM record's callsign and previous callsign */
+int ham_sqlite_insert_callsign_parts(ham_fcc_sqlite *fcc_sqlite, const ham_field *fields,
+                                        const int num_fields) {
+    int error = HAM_OK;
 
-    if(fcc_sqlite->co_stmt != NULL) {
-        sqlite3_finalize(fcc_sqlite->co_stmt);
-        fcc_sqlite->co_stmt = NULL;
-    }
+    if(num_fields > HAM_FCC_AM_CALLSIGN)
+        error = ham_sqlite_insert_callsign(fcc_sqlite, &fields[1], &fields[HAM_FCC_AM_CALLSIGN],
+                                            HAM_BOOL_NO);
 
-    if(fcc_sqlite->la_stmt != NULL) {
-        sqlite3_finalize(fcc_sqlite->la_stmt);
-        fcc_sqlite->la_stmt = NULL;
-    }
+    if(error == HAM_OK && num_fields > HAM_FCC_AM_PREVIOUS_CALLSIGN)
+        error = ham_sqlite_insert_callsign(fcc_sqlite, &fields[1],
+                                            &fields[HAM_FCC_AM_PREVIOUS_CALLSIGN], HAM_BOOL_YES);
 
-    if(fcc_sqlite->sc_stmt != NULL) {
-        sqlite3_finalize(fcc_sqlite->sc_stmt);
-        fcc_sqlite->sc_stmt = NULL;
-    }
+    return error;
+}
 
-    if(fcc_sqlite->sf_stmt != NULL) {
-        sqlite3_finalize(fcc_sqlite->sf_stmt);
-        fcc_sqlite->sf_stmt = NULL;
-    }
+int ham_sqlite_insert_callsign(ham_fcc_sqlite *fcc_sqlite, const ham_field *identifier,
+                                const ham_field *callsign, const int previous) {
+    sqlite3_stmt *sql_stmt = fcc_sqlite->parts_stmt;
+    ham_callsign parts;
+    char format[8];
+    int rc;
 
-    return HAM_OK;
-}
+    if(callsign->length == 0)
+        return HAM_OK;
 
+    ham_sqlite_bind_field(sql_stmt, 1, identifier, HAM_VALUE_INTEGER, NULL);
+    sqlite3_bind_int(sql_stmt, 2, previous == HAM_BOOL_YES);
+    sqlite3_bind_text(sql_stmt, 3, callsign->data, (int)callsign->length, SQLITE_STATIC);
+
+    if(ham_parse_callsign(callsign->data, callsign->length, &parts) == HAM_OK) {
+        snprintf(format, sizeof(format), "%ux%u", (unsigned int)parts.prefix_length,
+                    (unsigned int)parts.suffix_length);
+
+        sqlite3_bind_text(sql_stmt, 4, callsign->data, (int)parts.prefix_length,
+                            SQLITE_STATIC);
+        sqlite3_bind_int(sql_stmt, 5, parts.area);
+        sqlite3_bind_text(sql_stmt, 6, callsign->data + parts.suffix_offset,
+                            (int)parts.suffix_length, SQLITE_STATIC);
+        sqlite3_bind_text(sql_stmt, 7, format, -1, SQLITE_STATIC);
+    } else {
+        for(int i = 4; i <= 7; i++)
+            sqlite3_bind_null(sql_stmt, i);
+    }
 
-/* Creates the HAM_SQLITE_FILENAME. If it already exists, reset it. */
-int ham_sqlite_reset_file(const char *filename) {
-    FILE *f = fopen(filename, "w");
+    rc = sqlite3_step(sql_stmt);
+    sqlite3_reset(sql_stmt);
 
-    if(f == NULL)
-        return HAM_ERROR_SQLITE_RESET_FILE;
+    if(rc != SQLITE_DONE) {
+        fprintf(stderr, "Error (%d): Message: %s - Failed to insert the parts of %.*s\n", rc,
+                    sqlite3_errmsg(fcc_sqlite->database), (int)callsign->length, callsign->data);
 
-    fclose(f);
+        return HAM_ERROR_SQLITE_INSERT;
+    }
 
     return HAM_OK;
 }
 
-int ham_sqlite_open_database_connection(sqlite3 **database, const char *filename) {
-    if(sqlite3_open(filename, database)) {
-        fprintf(stderr, "Error: unable to open database: %s\n", sqlite3_errmsg(*database));
+/* Name of the temporary database a file is converted into, next to the output file */
+void ham_sqlite_table_filename(char *buffer, const size_t size, const char *filename,
+                                const int fcc_file) {
+    snprintf(buffer, size, "%s.%s.tmp", filename, FCC_FILENAMES[fcc_file]);
+}
 
-        sqlite3_close(*database);
-        return HAM_ERROR_SQLITE_OPEN_DATABASE_CONNECTION;
+/*
+ * Converts every record type into its own temporary database on its own thread, then merges them
+ * into the output. Each table thread has its own connection and prepared statements, so the only
+ * thing they share is the scheduler.
+ */
+int ham_sqlite_convert_tables(ham_fcc_sqlite *fcc_sqlite, const ham_fcc_database *fcc_database,
+                                const char *filename, const int threads,
+                                const ham_fcc_convert_options *options) {
+    ham_table_scheduler scheduler;
+    ham_thread table_threads[HAM_FCC_FILE_COUNT];
+    char table_filename[512];
+    int num_threads, started = 0;
+
+    memset(&scheduler, 0, sizeof(ham_table_scheduler));
+    scheduler.fcc_database = fcc_database;
+    scheduler.filename = filename;
+    scheduler.time = fcc_sqlite->time;
+    scheduler.encode = fcc_sqlite->encode;
+    scheduler.compact = fcc_sqlite->compact;
+    scheduler.clustered = fcc_sqlite->clustered;
+    scheduler.callsign_parts = fcc_sqlite->callsign_parts;
+    scheduler.dictionaries = fcc_sqlite->dictionaries;
+
+    /* Only the output is built in memory; the table databases are attached to it by name */
+    scheduler.options = *options;
+    scheduler.options.in_memory = HAM_BOOL_NO;
+
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        if(fcc_database->files[i].open == HAM_BOOL_YES)
+            scheduler.order[scheduler.count++] = i;
     }
 
-    return HAM_OK;
-}
+    /* Largest first; unknown sizes (-1) go last */
+    for(int i = 1; i < scheduler.count; i++) {
+        int fcc_file = scheduler.order[i];
+        int j = i;
 
-int ham_sqlite_create_tables(ham_fcc_sqlite *fcc_sqlite) {
-    if(sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_TABLE_FCC_AM, NULL, NULL, NULL))
-        return HAM_ERROR_SQLITE_CREATE_TABLES;
+        while(j > 0 && fcc_database->files[scheduler.order[j - 1]].size <
+                        fcc_database->files[fcc_file].size) {
+            scheduler.order[j] = scheduler.order[j - 1];
+            j--;
+        }
 
-    if(sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_TABLE_FCC_EN, NULL, NULL, NULL))
-        return HAM_ERROR_SQLITE_CREATE_TABLES;
+        scheduler.order[j] = fcc_file;
+    }
 
-    if(sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_TABLE_FCC_HD, NULL, NULL, NULL))
-        return HAM_ERROR_SQLITE_CREATE_TABLES;
+    num_threads = threads < scheduler.count ? threads : scheduler.count;
+    if(num_threads < 1)
+        num_threads = 1;
 
-    if(sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_TABLE_FCC_HS, NULL, NULL, NULL))
-        return HAM_ERROR_SQLITE_CREATE_TABLES;
+    /* Threads left over once every table thread has one go to parsing */
+    scheduler.threads = (threads - num_threads) / num_threads;
 
-    if(sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_TABLE_FCC_CO, NULL, NULL, NULL))
-        return HAM_ERROR_SQLITE_CREATE_TABLES;
+    /* Under a memory budget the table databases share the load's page cache */
+    if(options->memory_budget > 0) {
+        ham_fcc_convert_options budgeted;
 
-    if(sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_TABLE_FCC_LA, NULL, NULL, NULL))
-        return HAM_ERROR_SQLITE_CREATE_TABLES;
+        ham_budget_options(&scheduler.options, &budgeted);
+        scheduler.options.cache_size = budgeted.cache_size / num_threads;
+    }
 
-    if(sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_TABLE_FCC_SC, NULL, NULL, NULL))
-        return HAM_ERROR_SQLITE_CREATE_TABLES;
+    ham_mutex_init(&scheduler.mutex);
 
-    if(sqlite3_exec(fcc_sqlite->database, HAM_SQLITE_TABLE_FCC_SF, NULL, NULL, NULL))
-        return HAM_ERROR_SQLITE_CREATE_TABLES;
+    for(int i = 0; i < num_threads; i++) {
+        if(ham_thread_create(&table_threads[i], ham_sqlite_table_thread_main, &scheduler))
+            break;
 
-    return HAM_OK;
-}
+        started++;
+    }
 
-int ham_sqlite_fcc_convert_file(ham_fcc_sqlite *fcc_sqlite, FILE *data, const int fcc_file) {
-    char buffer[HAM_BUFFER_SIZE];
-    int error = HAM_OK;
-    int num_fields = 0;
-    sqlite3_stmt *sql_stmt = NULL;
-    char **fields;
+    /* If no thread could be started, do the work on this one */
+    if(started == 0)
+        ham_sqlite_table_thread_main(&scheduler);
 
-    unsigned int *currentline;
+    for(int i = 0; i < started; i++)
+        ham_thread_join(table_threads[i]);
 
-    switch (fcc_file) {
-        case HAM_FCC_FILE_AM:
-            error = ham_alloc_string_array(&fields, HAM_FCC_AM_FIELDS, HAM_BUFFER_SIZE);
-            if(error != HAM_OK)
-                return HAM_ERROR_MALLOC_FAIL;
+    ham_mutex_destroy(&scheduler.mutex);
 
-            num_fields = HAM_FCC_AM_FIELDS;
-            sql_stmt = fcc_sqlite->am_stmt;
-            currentline = &fcc_sqlite->am_line;
-            break;
+    fcc_sqlite->sql_insert_calls += scheduler.sql_insert_calls;
 
-        case HAM_FCC_FILE_EN:
-            error = ham_alloc_string_array(&fields, HAM_FCC_EN_FIELDS, HAM_BUFFER_SIZE);
-            if(error != HAM_OK)
-                return HAM_ERROR_MALLOC_FAIL;
+    /* Merge in file order so the output looks the same as a sequential conversion */
+    for(int i = 1; i <= HAM_FCC_FILE_COUNT; i++) {
+        if(fcc_database->files[i].open != HAM_BOOL_YES)
+            continue;
 
-            num_fields = HAM_FCC_EN_FIELDS;
-            sql_stmt = fcc_sqlite->en_stmt;
-            currentline = &fcc_sqlite->en_line;
-            break;
+        ham_sqlite_table_filename(table_filename, sizeof(table_filename), filename, i);
 
-        case HAM_FCC_FILE_HD:
-            error = ham_alloc_string_array(&fields, HAM_FCC_HD_FIELDS, HAM_BUFFER_SIZE);
-            if(error != HAM_OK)
-                return HAM_ERROR_MALLOC_FAIL;
+        if(scheduler.error == HAM_OK && ham_sqlite_merge_table(fcc_sqlite, table_filename, i))
+            scheduler.error = HAM_ERROR_SQLITE_INSERT;
 
-            num_fields = HAM_FCC_HD_FIELDS;
-            sql_stmt = fcc_sqlite->hd_stmt;
-            currentline = &fcc_sqlite->hd_line;
-            break;
+        remove(table_filename);
+    }
 
-        case HAM_FCC_FILE_HS:
-            error = ham_alloc_string_array(&fields, HAM_FCC_HS_FIELDS, HAM_BUFFER_SIZE);
-            if(error != HAM_OK)
-                return HAM_ERROR_MALLOC_FAIL;
+    return scheduler.error;
+}
 
-            num_fields = HAM_FCC_HS_FIELDS;
-            sql_stmt = fcc_sqlite->hs_stmt;
-            currentline = &fcc_sqlite->hs_line;
-            break;
+void ham_sqlite_table_thread_main(void *argument) {
+    ham_table_scheduler *scheduler = argument;
+    int fcc_file, error;
 
-        case HAM_FCC_FILE_CO:
-            error = ham_alloc_string_array(&fields, HAM_FCC_CO_FIELDS, HAM_BUFFER_SIZE);
-            if(error != HAM_OK)
-                return HAM_ERROR_MALLOC_FAIL;
+    for(;;) {
+        ham_mutex_lock(&scheduler->mutex);
+        fcc_file = scheduler->next < scheduler->count && scheduler->error == HAM_OK ?
+                    scheduler->order[scheduler->next++] : 0;
+        ham_mutex_unlock(&scheduler->mutex);
 
-            num_fields = HAM_FCC_CO_FIELDS;
-            sql_stmt = fcc_sqlite->co_stmt;
-            currentline = &fcc_sqlite->co_line;
-            break;
+        if(fcc_file == 0)
+            return;
 
-        case HAM_FCC_FILE_LA:
-            error = ham_alloc_string_array(&fields, HAM_FCC_LA_FIELDS, HAM_BUFFER_SIZE);
-            if(error != HAM_OK)
-                return HAM_ERROR_MALLOC_FAIL;
+        error = ham_sqlite_convert_table(scheduler, fcc_file);
 
-            num_fields = HAM_FCC_LA_FIELDS;
-            sql_stmt = fcc_sqlite->la_stmt;
-            currentline = &fcc_sqlite->la_line;
-            break;
+        if(error != HAM_OK) {
+            ham_mutex_lock(&scheduler->mutex);
+            scheduler->error = error;
+            ham_mutex_unlock(&scheduler->mutex);
+        }
+    }
+}
 
-        case HAM_FCC_FILE_SC:
-            error = ham_alloc_string_array(&fields, HAM_FCC_SC_FIELDS, HAM_BUFFER_SIZE);
+/* Converts one file into its temporary database */
+int ham_sqlite_convert_table(ham_table_scheduler *scheduler, const int fcc_file) {
+    ham_fcc_sqlite *table_sqlite;
+    char table_filename[512];
+    int error;
 
-            if(error != HAM_OK)
-                return HAM_ERROR_MALLOC_FAIL;
-            num_fields = HAM_FCC_SC_FIELDS;
-            sql_stmt = fcc_sqlite->sc_stmt;
-            currentline = &fcc_sqlite->sc_line;
-            break;
+    ham_sqlite_table_filename(table_filename, sizeof(table_filename), scheduler->filename,
+                                fcc_file);
 
-        case HAM_FCC_FILE_SF:
-            error = ham_alloc_string_array(&fields, HAM_FCC_SF_FIELDS, HAM_BUFFER_SIZE);
-            if(error != HAM_OK)
-                return HAM_ERROR_MALLOC_FAIL;
+    /* Left over from an earlier run that did not finish */
+    if(ham_sqlite_reset_file(table_filename))
+        return HAM_ERROR_SQLITE_RESET_FILE;
 
-            num_fields = HAM_FCC_SF_FIELDS;
-            sql_stmt = fcc_sqlite->sf_stmt;
-            currentline = &fcc_sqlite->sf_line;
-            break;
+    if(ham_sqlite_init(&table_sqlite, table_filename, &scheduler->options))
+        return HAM_ERROR_SQLITE_INIT;
 
-        default:
-            return HAM_ERROR_GENERIC;
-    }
+    /* Every table gets the same timestamps, as if it was one conversion */
+    strncpy(table_sqlite->time, scheduler->time, sizeof(table_sqlite->time) - 1);
+    table_sqlite->threads = scheduler->threads;
+    table_sqlite->encode = scheduler->encode;
+    table_sqlite->compact = scheduler->compact;
+    table_sqlite->clustered = scheduler->clustered;
+    table_sqlite->callsign_parts = scheduler->callsign_parts;
 
-    memset(buffer, HAM_NULL_CHAR, HAM_BUFFER_SIZE);
+    error = ham_sqlite_create_tables(table_sqlite);
 
-    while(fgets(buffer, HAM_BUFFER_SIZE, data) != NULL) {
-        (*currentline)++;
+    if(error == HAM_OK)
+        error = ham_sqlite_sql_prepare_stmt(table_sqlite);
 
-        /*
-         * fgets includes the new line at the end of the buffer; we need to replace it with a null
-         * char.
-         */
-         char *endofline = strpbrk(buffer, "\n");
-         if(endofline != NULL) {
-           memset(endofline, HAM_NULL_CHAR, 1);
-         }
+    if(error == HAM_OK && table_sqlite->encode == HAM_BOOL_YES)
+        error = ham_sqlite_encode_prepare(table_sqlite);
 
-         endofline = strpbrk(buffer, "\r");
-         if(endofline != NULL) {
-           memset(endofline, HAM_NULL_CHAR, 1);
-         }
+    if(error == HAM_OK && table_sqlite->encode == HAM_BOOL_YES)
+        error = ham_sqlite_encode_seed(table_sqlite, fcc_file, scheduler->dictionaries[fcc_file]);
 
+    if(error == HAM_OK && table_sqlite->clustered == HAM_BOOL_YES)
+        error = ham_sqlite_cluster_prepare(table_sqlite);
 
+    if(error == HAM_OK)
+        error = ham_sqlite_fcc_convert_file(table_sqlite,
+                                            &scheduler->fcc_database->files[fcc_file], fcc_file);
 
-        error = ham_parse_line_with_delimiter((char **)fields, buffer, num_fields, HAM_DELIMITER);
-        if(error != HAM_OK) {
-            ham_free_string_array(&fields, num_fields, HAM_BUFFER_SIZE);
-            return HAM_ERROR_GENERIC;
-        }
+    if(error == HAM_OK && table_sqlite->clustered == HAM_BOOL_YES)
+        error = ham_sqlite_cluster_finish(table_sqlite);
 
-        ham_sqlite_insert_fields(fcc_sqlite, fields, num_fields, sql_stmt, fcc_file, *currentline);
+    /* The codes go along with the table when it is merged */
+    if(error == HAM_OK && table_sqlite->encode == HAM_BOOL_YES)
+        error = ham_sqlite_encode_finish(table_sqlite);
 
-        memset(buffer, HAM_NULL_CHAR, HAM_BUFFER_SIZE);
-    }
+    ham_mutex_lock(&scheduler->mutex);
+    scheduler->sql_insert_calls += table_sqlite->sql_insert_calls;
+    ham_mutex_unlock(&scheduler->mutex);
 
-    ham_free_string_array(&fields, num_fields, HAM_BUFFER_SIZE);
+    ham_sqlite_sql_finalize_stmt(table_sqlite);
+    ham_sqlite_terminate(table_sqlite);
 
     return error;
 }
 
-int ham_sqlite_insert_fields(ham_fcc_sqlite *fcc_sqlite, char **fields, const int num_fields,
-                                sqlite3_stmt *sql_stmt, const int fcc_file, const int currentline) {
+/*
+ * Copies a table out of its temporary database. The schemas are identical, so SQLite can use its
+ * transfer optimization and copy the records without decoding them. When the output already has
+ * rows, the merged ones are numbered after them instead, which means copying them column by column.
+ */
+int ham_sqlite_merge_table(ham_fcc_sqlite *fcc_sqlite, const char *table_filename,
+                            const int fcc_file) {
+    const char *table = HAM_SQLITE_TABLE_NAMES[fcc_file];
+    char name[HAM_FCC_NAME_SIZE];
+    sqlite3_stmt *sql_stmt;
+    INT64 offset = 0;
+    char *sql;
+    int rc;
+
+    sql = sqlite3_mprintf(HAM_SQLITE_MAX_ID, table);
+    if(sql == NULL)
+        return HAM_ERROR_MALLOC_FAIL;
 
-    int rc = 0;
+    rc = sqlite3_prepare_v2(fcc_sqlite->database, sql, -1, &sql_stmt, NULL);
+    sqlite3_free(sql);
 
-    for(int i = 0; i < num_fields; i++) {
+    if(rc == SQLITE_OK && sqlite3_step(sql_stmt) == SQLITE_ROW)
+        offset = sqlite3_column_int64(sql_stmt, 0);
 
-        if(strlen(fields[i]) == 0)
-            rc = sqlite3_bind_null(sql_stmt, i+1);
-        else
-            rc = sqlite3_bind_text(sql_stmt, i+1, fields[i], -1, SQLITE_TRANSIENT);
+    sqlite3_finalize(sql_stmt);
 
-        if(rc != SQLITE_OK) {
-            fprintf(stderr, "Error (%d): paramater binding failed. * File: %s * Index: %d\n", rc,
-                        FCC_FILENAMES[fcc_file], i);
+    /* A database cannot be attached inside a transaction */
+    sqlite3_exec(fcc_sqlite->database, "END TRANSACTION", NULL, NULL, NULL);
 
-            return HAM_ERROR_GENERIC;
+    sql = sqlite3_mprintf("ATTACH DATABASE %Q AS part", table_filename);
+    rc = sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+    sqlite3_free(sql);
+
+    if(rc == SQLITE_OK) {
+        if(offset == 0) {
+            sql = sqlite3_mprintf("INSERT INTO main.%s SELECT * FROM part.%s", table, table);
+        } else {
+            sql = sqlite3_mprintf("INSERT INTO main.%s SELECT id + %lld", table,
+                                    (long long)offset);
+
+            for(int column = 1; sql != NULL && ham_sqlite_column_name(fcc_file, column, name,
+                    sizeof(name)) == HAM_OK; column++) {
+                if(fcc_sqlite->compact == HAM_BOOL_YES
+                        && column > (int)strlen(HAM_FCC_COLUMN_TYPES[fcc_file]))
+                    break;
+
+                sql = sqlite3_mprintf("%z, %s", sql, name);
+            }
+
+            sql = sqlite3_mprintf("%z FROM part.%s", sql, table);
         }
-    }
 
-    sqlite3_bind_text(sql_stmt, num_fields + 1, fcc_sqlite->time, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(sql_stmt, num_fields + 2, fcc_sqlite->time, -1, SQLITE_TRANSIENT);
+        rc = sql != NULL ? sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL) : SQLITE_NOMEM;
+        sqlite3_free(sql);
 
-    rc = sqlite3_step(sql_stmt);
+        /* The table thread started from the output's codes, so its own only add to them */
+        for(int field = 0; rc == SQLITE_OK && fcc_sqlite->encode == HAM_BOOL_YES
+                && HAM_FCC_COLUMN_TYPES[fcc_file][field] != HAM_NULL_CHAR; field++) {
+            if(HAM_FCC_COLUMN_TYPES[fcc_file][field] != HAM_VALUE_CODE
+                    || ham_sqlite_column_name(fcc_file, field + 1, name, sizeof(name)))
+                continue;
 
-    sqlite3_clear_bindings(sql_stmt);
-    sqlite3_reset(sql_stmt);
+            sql = sqlite3_mprintf(HAM_SQLITE_CODE_MERGE, HAM_SQLITE_TABLE_NAMES[fcc_file], name,
+                                    HAM_SQLITE_TABLE_NAMES[fcc_file], name);
+            rc = sqlite3_exec(fcc_sqlite->database, sql, NULL, NULL, NULL);
+            sqlite3_free(sql);
+        }
 
-    if(rc != SQLITE_DONE)
-    {
-        fprintf(stderr, "Error (%d): Message: %s - Failed to insert record. File: %s; Line: %u\n", rc,
-                    sqlite3_errmsg(fcc_sqlite->database), FCC_FILENAMES[fcc_file], currentline);
+        /* The callsign parts are written along with the AM records */
+        if(rc == SQLITE_OK && fcc_file == HAM_FCC_FILE_AM
+                && fcc_sqlite->callsign_parts == HAM_BOOL_YES)
+            rc = sqlite3_exec(fcc_sqlite->database, "INSERT INTO main.callsign_parts "
+                                "SELECT * FROM part.callsign_parts", NULL, NULL, NULL);
 
-        return HAM_ERROR_SQLITE_INSERT;
+        if(rc != SQLITE_OK)
+            fprintf(stderr, "Error (%d): Message: %s - Failed to merge %s\n", rc,
+                    sqlite3_errmsg(fcc_sqlite->database), FCC_FILENAMES[fcc_file]);
+
+        sqlite3_exec(fcc_sqlite->database, "DETACH DATABASE part", NULL, NULL, NULL);
     }
 
-    fcc_sqlite->sql_insert_calls++;
+    sqlite3_exec(fcc_sqlite->database, "BEGIN TRANSACTION", NULL, NULL, NULL);
 
-    return HAM_OK;
+    return rc == SQLITE_OK ? HAM_OK : HAM_ERROR_SQLITE_INSERT;
 }
@@ -30,6 +30,10 @@
     #define LIBHAMDATA_API extern
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
 #define INT64 int64_t
 
 /* Return code */
@@ -39,6 +43,10 @@
 #define HAM_ERROR_MALLOC_FAIL 101
 #define HAM_ERROR_OPEN_FILE 102
 #define HAM_ERROR_DIR_TOO_LONG 103
+#define HAM_ERROR_BAD_ARCHIVE 104
+#define HAM_ERROR_NOT_FOUND 105
+#define HAM_ERROR_BAD_INDEX 106
+#define HAM_ERROR_BAD_COLUMNS 107
 
 #define HAM_ERROR_SQLITE_RESET_FILE 201
 #define HAM_ERROR_SQLITE_INIT 202
@@ -46,6 +54,7 @@
 #define HAM_ERROR_SQLITE_CREATE_TABLES 204
 #define HAM_ERROR_SQLITE_INSERT 205
 #define HAM_ERROR_SQLITE_PREPARE_STMT 206
+#define HAM_ERROR_SQLITE_CREATE_INDEXES 207
 
 /* Generic bool */
 #define HAM_BOOL_NO 0
@@ -54,7 +63,173 @@
 /* FCC Database structure */
 typedef struct ham_fcc_database ham_fcc_database;
 
-typedef struct ham_fcc_lengths ham_fcc_lengths;
+/*
+ * Source of FCC data that is read front to back once, such as a pipe or a download. Returns the
+ * number of bytes put in buffer, 0 at the end of the data, or -1 on an error. It may be called on
+ * a conversion thread, but never from two threads at once.
+ */
+typedef INT64 (*ham_fcc_read_callback)(void *context, char *buffer, size_t size);
+
+/* Where SQLite keeps temporary tables and sorts; the temp_store option */
+#define HAM_TEMP_STORE_DEFAULT 0
+#define HAM_TEMP_STORE_FILE 1
+#define HAM_TEMP_STORE_MEMORY 2
+
+/* Smallest memory_budget a conversion takes */
+#define HAM_MIN_MEMORY_BUDGET (16 * 1024 * 1024)
+
+/*
+ * Conversion options. Always fill them in with ham_fcc_convert_options_init first, so options
+ * added later keep their defaults.
+ */
+typedef struct ham_fcc_convert_options {
+    /* Threads to use. 0, the default, uses one per processor. */
+    int threads;
+
+    /*
+     * Convert each record type into its own temporary database at the same time and merge them
+     * into the output at the end. Off by default.
+     */
+    int parallel_tables;
+
+    /*
+     * Apply a daily transaction file (e.g. l_am_MMDDYY.zip) to an existing database instead of
+     * loading a full one. Every license in the file has all of its old rows, in all the tables,
+     * replaced by the new ones, inside a single transaction. Off by default; parallel_tables does
+     * not apply.
+     */
+    int update;
+
+    /*
+     * Build the lookup indexes on the callsign, unique_system_identifier, frn and license_status
+     * columns once the data is loaded, and report how long each took. On by default.
+     */
+    int indexes;
+
+    /*
+     * Encoded schema. Code columns with a few distinct values, such as operator_class,
+     * license_status, state and the Y/N flags, hold integer codes, with a lookup table per column
+     * and a <table>_decoded view per table that shows the values. Off by default. An update must
+     * use the same setting as the database it updates.
+     */
+    int encode;
+
+    /*
+     * Compact schema. The ids are plain rowids instead of AUTOINCREMENT, and the rows have no
+     * created_at and updated_at; the import time is kept once in the ham_metadata table, as
+     * imported_at, or updated_at after an update. Off by default. An update must use the same
+     * setting as the database it updates.
+     */
+    int compact;
+
+    /*
+     * Clustered layout. The tables are WITHOUT ROWID with the key (unique_system_identifier, id),
+     * so the rows of a license are stored together. The id is the order the rows were loaded in.
+     * Rows are fed in key order; those that are not are sorted in at the end. Off by default. An
+     * update must use the same setting as the database it updates.
+     */
+    int clustered;
+
+    /*
+     * Build a licenses table with one row per license: callsign, status, grant and expiry dates,
+     * operator class, and the licensee's name and address. It is joined out of the AM, EN and HD
+     * files in a single pass after the load, so it needs files that can be read again; a stream
+     * is skipped. Off by default.
+     */
+    int licenses;
+
+    /*
+     * Path of a callsign index file to write once the data is loaded, for ham_fcc_index_open.
+     * NULL, the default, writes none.
+     */
+    const char *callsign_index;
+
+    /*
+     * Fill a callsign_parts table with the prefix, call area digit, suffix and format of every
+     * callsign and previous callsign of the AM file, for prefix and pattern searches. Off by
+     * default.
+     */
+    int callsign_parts;
+
+    /*
+     * Build entities_search, an FTS5 index over entity_name, first_name, last_name,
+     * street_address and city of the entities, folded for case and diacritics. An update keeps
+     * an existing one up to date. Needs SQLite with FTS5. Off by default.
+     */
+    int name_search;
+
+    /*
+     * Build the whole database, indexes included, in memory, and write it to the output file in
+     * one sequential pass with VACUUM INTO once the conversion succeeds. The file is only replaced
+     * then, so a failed conversion leaves it as it was; an update starts from a copy of it. Needs
+     * memory for the whole database. The per table databases of parallel_tables are still files.
+     * Off by default.
+     */
+    int in_memory;
+
+    /*
+     * SQLite settings, applied to the output database before anything is written. A size of 0 or
+     * a NULL mode leaves SQLite's own default. The defaults were chosen by timing full loads.
+     *
+     * page_size          Bytes per page of a new database. 4096 by default.
+     * cache_size         Page cache in KiB while loading. 65536 (64 MiB) by default.
+     * index_cache_size   Page cache in KiB while the indexes are built, so their sorts stay in
+     *                    memory. 262144 (256 MiB) by default.
+     * mmap_size          Bytes of the database file SQLite may memory map. 0, none, by default;
+     *                    -1 leaves SQLite's default.
+     * temp_store         HAM_TEMP_STORE_*, where temporary tables and sorts are kept.
+     *                    HAM_TEMP_STORE_DEFAULT, SQLite's own, by default; the index builds were
+     *                    slower with their sorts in memory.
+     * journal_mode       "DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL" or "OFF". "MEMORY" by
+     *                    default; "OFF" leaves nothing to roll a failed update back with.
+     * synchronous        "OFF", "NORMAL", "FULL" or "EXTRA". "OFF" by default, as the output is
+     *                    written in one go and can be rebuilt from the FCC files.
+     */
+    int page_size;
+    int cache_size;
+    int index_cache_size;
+    INT64 mmap_size;
+    int temp_store;
+    const char *journal_mode;
+    const char *synchronous;
+
+    /*
+     * Bytes of a file the pipeline reader hands a parser at a time, and so the size of the
+     * batches a sink gets in append_rows. 262144 (256 KiB) by default, at least 4096.
+     */
+    size_t chunk_size;
+
+    /*
+     * Commit the load every commit_rows records or commit_bytes bytes of records, whichever comes
+     * first, so a transaction never holds more than one batch. 0, the default, for both loads
+     * everything in one transaction. An update is always one transaction, so a daily file is
+     * still applied completely or not at all.
+     *
+     * A load of files in batches also keeps a checkpoint per file in the ham_checkpoints table,
+     * committed with each batch: the byte offset and line the next batch starts at. The table is
+     * dropped once the conversion succeeds. Not for an update, nor with parallel_tables,
+     * clustered or in_memory, whose rows only reach the output at the end. A MEMORY journal
+     * goes to a file instead, so a conversion that dies leaves the output at its last commit.
+     */
+    INT64 commit_rows;
+    INT64 commit_bytes;
+
+    /*
+     * Continue a conversion that died from the checkpoints in the output file, with the same
+     * files and options. Each file is read from the offset of its last commit, and the files it
+     * had finished are skipped. Off by default.
+     */
+    int resume;
+
+    /*
+     * Bytes of memory the conversion may use, or 0, the default, for no limit. At least
+     * HAM_MIN_MEMORY_BUDGET. The page caches are cut down to fit, SQLite gets a hard heap limit
+     * so it fails with an out of memory error rather than going over, a MEMORY journal and
+     * temp store go to files, and the pages of the input files are given back once they are
+     * converted. The heap limit is process wide while the conversion runs. Not with in_memory.
+     */
+    INT64 memory_budget;
+} ham_fcc_convert_options;
 
 /*
  * Initializer and terminator.
@@ -65,7 +240,198 @@ typedef struct ham_fcc_lengths ham_fcc_lengths;
 LIBHAMDATA_API int ham_fcc_database_init(ham_fcc_database **database, char *directory);
 LIBHAMDATA_API int ham_fcc_terminate(ham_fcc_database *database);
 
+/*
+ * Same as ham_fcc_database_init, but reads the files out of an FCC zip archive (e.g. l_amat.zip)
+ * without extracting it. HAM_ERROR_BAD_ARCHIVE is returned if the archive cannot be read.
+ */
+LIBHAMDATA_API int ham_fcc_database_init_zip(ham_fcc_database **database, const char *path);
+
+/*
+ * Streaming input. ham_fcc_database_init_streams creates a database without any files, and each
+ * record type is then added from a stream or a callback. The name is the file's, e.g. "AM.dat", or
+ * just the record type, "AM". Record types that are not added are skipped by the conversion. The
+ * streams are never seeked, and they are not closed by ham_fcc_terminate.
+ */
+LIBHAMDATA_API int ham_fcc_database_init_streams(ham_fcc_database **database);
+LIBHAMDATA_API int ham_fcc_database_add_stream(ham_fcc_database *database, const char *name,
+                                                FILE *stream);
+LIBHAMDATA_API int ham_fcc_database_add_callback(ham_fcc_database *database, const char *name,
+                                                    ham_fcc_read_callback read, void *context);
+
+/* ham_fcc_read_callback that reads from a FILE * */
+LIBHAMDATA_API INT64 ham_fcc_read_file(void *stream, char *buffer, size_t size);
+
 /* Conversion functions */
+LIBHAMDATA_API void ham_fcc_convert_options_init(ham_fcc_convert_options *options);
 LIBHAMDATA_API int ham_fcc_to_sqlite(const ham_fcc_database *fcc_database, const char *filename);
+LIBHAMDATA_API int ham_fcc_to_sqlite_ex(const ham_fcc_database *fcc_database, const char *filename,
+                                        const ham_fcc_convert_options *options);
+
+/*
+ * Converts one stream holding every record type, read once with constant memory. It can be a tar
+ * archive of the .dat files, or the files concatenated, in which case each record goes to the table
+ * of its record type field. parallel_tables does not apply to a single stream.
+ */
+LIBHAMDATA_API int ham_fcc_stream_to_sqlite(ham_fcc_read_callback read, void *context,
+                                            const char *filename,
+                                            const ham_fcc_convert_options *options);
+
+/*
+ * Callsign index. A file written by the conversion (see callsign_index) that answers lookups by
+ * callsign without SQLite. It is memory mapped, so opening it reads nothing up front, and a lookup
+ * allocates nothing. When a callsign belongs to several licenses, the index holds an active one,
+ * or else the one that expires last.
+ */
+typedef struct ham_fcc_index ham_fcc_index;
+
+typedef struct ham_fcc_index_record {
+    INT64 unique_system_identifier;
+
+    /* YYYYMMDD, or 0 if the license has none */
+    int32_t expired_date;
+
+    /* The codes of the FCC files, e.g. 'E' and 'A', or '\0' when blank */
+    char operator_class;
+    char license_status;
+} ham_fcc_index_record;
+
+/*
+ * HAM_ERROR_OPEN_FILE if the file cannot be opened, HAM_ERROR_BAD_INDEX if it is not an index
+ * written on a machine of the same byte order.
+ */
+LIBHAMDATA_API int ham_fcc_index_open(ham_fcc_index **index, const char *path);
+
+/* Case insensitive. HAM_OK with the record filled in, or HAM_ERROR_NOT_FOUND. */
+LIBHAMDATA_API int ham_fcc_index_lookup(const ham_fcc_index *index, const char *callsign,
+                                        ham_fcc_index_record *record);
+LIBHAMDATA_API void ham_fcc_index_close(ham_fcc_index *index);
+
+/*
+ * Columnar snapshot. ham_fcc_to_columns writes one file per record type into a directory that
+ * already exists, named after its table, e.g. amateurs.hamcol. Each column is stored on its own
+ * in a layout that is scanned in place:
+ *
+ * HAM_COLUMN_INT64    INT64 per row; HAM_COLUMN_NULL_INT64 when blank or not a number
+ * HAM_COLUMN_DATE     int32_t YYYYMMDD per row; 0 when blank or not a date
+ * HAM_COLUMN_STRING   uint32_t offsets, rows + 1 of them; the value of row r is heap[offsets[r]]
+ *                     up to heap[offsets[r + 1]]
+ * HAM_COLUMN_CODE     uint16_t code per row, 0 when blank; the value of code c is
+ *                     heap[dictionary[c - 1]] up to heap[dictionary[c]]
+ *
+ * Strings are not null terminated. The files are in the byte order of the machine that wrote them.
+ */
+#define HAM_COLUMN_INT64 1
+#define HAM_COLUMN_DATE 2
+#define HAM_COLUMN_STRING 3
+#define HAM_COLUMN_CODE 4
+
+#define HAM_COLUMN_NULL_INT64 INT64_MIN
+
+typedef struct ham_fcc_columns ham_fcc_columns;
+
+typedef struct ham_fcc_column {
+    const char *name;
+    int type;
+    uint64_t rows;
+
+    /* The per row array, of the type's width */
+    const void *values;
+
+    /* Strings of a string column, or the values of a code column */
+    const char *heap;
+    uint64_t heap_size;
+
+    /* Offsets of the values of a code column in the heap, dictionary_count + 1 of them */
+    const uint32_t *dictionary;
+    uint32_t dictionary_count;
+} ham_fcc_column;
+
+LIBHAMDATA_API int ham_fcc_to_columns(const ham_fcc_database *fcc_database, const char *directory);
+
+/*
+ * HAM_ERROR_OPEN_FILE if the file cannot be opened, HAM_ERROR_BAD_COLUMNS if it is not a snapshot
+ * written on a machine of the same byte order.
+ */
+LIBHAMDATA_API int ham_fcc_columns_open(ham_fcc_columns **columns, const char *path);
+LIBHAMDATA_API uint64_t ham_fcc_columns_rows(const ham_fcc_columns *columns);
+LIBHAMDATA_API int ham_fcc_columns_count(const ham_fcc_columns *columns);
+
+/* A column by its position or by its name. HAM_ERROR_NOT_FOUND if there is none. */
+LIBHAMDATA_API int ham_fcc_columns_get(const ham_fcc_columns *columns, int index,
+                                        ham_fcc_column *column);
+LIBHAMDATA_API int ham_fcc_columns_find(const ham_fcc_columns *columns, const char *name,
+                                        ham_fcc_column *column);
+
+/* The value of a row of a string column, or of a code of a code column. NULL if there is none. */
+LIBHAMDATA_API const char *ham_fcc_column_string(const ham_fcc_column *column, uint64_t row,
+                                                    size_t *length);
+LIBHAMDATA_API const char *ham_fcc_column_code(const ham_fcc_column *column, uint32_t code,
+                                                size_t *length);
+LIBHAMDATA_API void ham_fcc_columns_close(ham_fcc_columns *columns);
+
+/*
+ * Output sinks. ham_fcc_to_sink reads and parses each record type through the same pipeline as
+ * the SQLite conversion and hands the rows to the sink as field views, table by table:
+ * begin_table, append_rows for each batch of rows in file order, then end_table. Any callback
+ * can stop the conversion by returning something other than HAM_OK, which ham_fcc_to_sink then
+ * returns. The callbacks are always called from the thread that called ham_fcc_to_sink.
+ */
+
+/* A field of a record. It points into the mapping or read buffer and is not null terminated. */
+typedef struct ham_field {
+    const char *data;
+    size_t length;
+} ham_field;
+
+typedef struct ham_fcc_sink_table {
+    /* Table of the record type, e.g. amateurs, and the record type, e.g. AM */
+    const char *name;
+    const char *record_type;
+
+    /* One column per field of the record, with its name and HAM_COLUMN_* type */
+    int num_columns;
+    const char *const *column_names;
+    const int *column_types;
+} ham_fcc_sink_table;
+
+typedef struct ham_fcc_sink {
+    void *context;
+
+    int (*begin_table)(void *context, const ham_fcc_sink_table *table);
+
+    /*
+     * rows * num_columns fields, a row after the other. Blank fields have a length of 0. The
+     * fields are only valid during the call.
+     */
+    int (*append_rows)(void *context, const ham_field *fields, int rows);
+
+    int (*end_table)(void *context);
+
+    /* Frees the context, including a table that was begun and never ended. May be NULL. */
+    void (*close)(void *context);
+} ham_fcc_sink;
+
+/* Only the threads option applies */
+LIBHAMDATA_API int ham_fcc_to_sink(const ham_fcc_database *fcc_database, ham_fcc_sink *sink,
+                                    const ham_fcc_convert_options *options);
+LIBHAMDATA_API void ham_fcc_sink_close(ham_fcc_sink *sink);
+
+/*
+ * Arrow IPC stream writer. Each table is written to <table>.arrows in a directory that already
+ * exists, as record batches of up to HAM_ARROW_BATCH_ROWS rows. Integer columns are int64, dates
+ * are date32, and text and code columns are utf8. A field that is not valid UTF-8 is taken to be
+ * Latin-1 and converted. Blank fields, and integers and dates that do not parse, are null.
+ */
+#define HAM_ARROW_BATCH_ROWS 65536
+
+LIBHAMDATA_API int ham_fcc_arrow_sink_open(ham_fcc_sink *sink, const char *directory);
+
+/*
+ * PostgreSQL binary COPY writer. Each table is written to <table>.pgcopy in a directory that
+ * already exists, with the same column types as the Arrow writer: bigint, date and text. The
+ * directory also gets load.sql, which creates the tables and copies the files in from psql when
+ * run in that directory.
+ */
+LIBHAMDATA_API int ham_fcc_pgcopy_sink_open(ham_fcc_sink *sink, const char *directory);
 
 #endif /* _LIBHANDATA_H_ */